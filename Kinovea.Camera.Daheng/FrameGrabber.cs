@@ -49,7 +49,6 @@ namespace Kinovea.Camera.Daheng
         private Averager dataRateAverager = new Averager(0.02);
         private const double megabyte = 1024 * 1024;
         private int incomingBufferSize = 0;
-        private byte[] incomingBuffer;
 
         private IGXDevice device;
         private IGXFeatureControl featureControl;
@@ -86,7 +85,6 @@ namespace Kinovea.Camera.Daheng
             height = (int)featureControl.GetIntFeature("Height").GetValue();
             ImageFormat format = DahengHelper.ConvertImageFormat(currentStreamFormat);
             incomingBufferSize = ImageFormatHelper.ComputeBufferSize(width, height, format);
-            incomingBuffer = new byte[incomingBufferSize];
 
             int outgoingBufferSize = ImageFormatHelper.ComputeBufferSize(width, height, format);
             bool topDown = DahengHelper.IsTopDown(currentStreamFormat);
@@ -329,32 +327,30 @@ namespace Kinovea.Camera.Daheng
 
         }
 
-        private unsafe void FillRGB24(IntPtr buffer)
+        private void FillRGB24(IntPtr buffer)
         {
-            fixed (byte* p = incomingBuffer)
-            {
-                IntPtr ptrDst = (IntPtr)p;
-                NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), width * 3 * height);
-            }
+            ComputeDataRate(incomingBufferSize);
+
+            // The SDK buffer is valid until we return, the pipeline copies it straight into its slot.
+            if (FrameProduced != null)
+                FrameProduced(this, new FrameProducedEventArgs(dst => CopyFrame(buffer, dst, width * 3 * height), incomingBufferSize));
+        }
 
+        private void FillY800(IntPtr buffer)
+        {
             ComputeDataRate(incomingBufferSize);
 
             if (FrameProduced != null)
-                FrameProduced(this, new FrameProducedEventArgs(incomingBuffer, incomingBufferSize));
+                FrameProduced(this, new FrameProducedEventArgs(dst => CopyFrame(buffer, dst, width * height), incomingBufferSize));
         }
 
-        private unsafe void FillY800(IntPtr buffer)
+        private unsafe void CopyFrame(IntPtr src, byte[] dst, int length)
         {
-            fixed (byte* p = incomingBuffer)
+            fixed (byte* p = dst)
             {
                 IntPtr ptrDst = (IntPtr)p;
-                NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), width * height);
+                NativeMethods.memcpy(ptrDst.ToPointer(), src.ToPointer(), length);
             }
-
-            ComputeDataRate(incomingBufferSize);
-
-            if (FrameProduced != null)
-                FrameProduced(this, new FrameProducedEventArgs(incomingBuffer, incomingBufferSize));
         }
     }
 }
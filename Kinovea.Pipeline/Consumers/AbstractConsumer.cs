@@ -4,6 +4,7 @@ using System.Linq;
 using System.Text;
 using System.Threading;
 using Kinovea.Pipeline.MemoryLayout;
+using Kinovea.Pipeline.WaitStrategies;
 using Kinovea.Services;
 
 namespace Kinovea.Pipeline.Consumers
@@ -33,6 +34,15 @@ namespace Kinovea.Pipeline.Consumers
         {
             get { return null; }
         }
+
+        /// <summary>
+        /// How the consumer thread waits for the next frame. Must be set before the thread is activated.
+        /// </summary>
+        public IWaitStrategy WaitStrategy
+        {
+            get { return waitStrategy; }
+            set { waitStrategy = value ?? new SpinThenParkWaitStrategy(); }
+        }
         
         // Synchronization
         private CacheLineStorageBool started = new CacheLineStorageBool(false); 
@@ -41,6 +51,8 @@ namespace Kinovea.Pipeline.Consumers
         private CacheLineStorageBool active = new CacheLineStorageBool(false);
         private CacheLineStorageBool deactivateAsked = new CacheLineStorageBool(false);
         private CacheLineStorageLong consumerPosition = new CacheLineStorageLong(-1); 
+        private IWaitStrategy waitStrategy = new SpinThenParkWaitStrategy();
+        private const int waitTimeout = 100;    // Max time in a wait before checking for deactivation.
         
         // Frame memory storage
         private RingBuffer buffer;
@@ -122,7 +134,8 @@ namespace Kinovea.Pipeline.Consumers
             while(!deactivateAsked.Data)
             {
                 // Wait until at least the next frame is available, but if more than one is available consume everything in batch.
-                long readable = buffer.WaitFor(next);
+                // If the producer stalls the wait times out without any new frame, so we get a chance to check for deactivation.
+                long readable = buffer.WaitFor(next, waitStrategy, waitTimeout);
 
                 while (next <= readable)
                 {
@@ -132,7 +145,7 @@ namespace Kinovea.Pipeline.Consumers
                 }
 
                 // Update our current position so the producer knows not to wrap.
-                consumerPosition.Data = next - 1;
+                consumerPosition.Data = GetReleasedPosition(next - 1);
             }
 
             active.Data = false;
@@ -151,6 +164,24 @@ namespace Kinovea.Pipeline.Consumers
         {
         }
 
+        /// <summary>
+        /// Returns the last position whose slot the producer may overwrite.
+        /// Consumers that still reference entries after ProcessEntry returns must report a lower position than the last one processed.
+        /// </summary>
+        protected virtual long GetReleasedPosition(long processedPosition)
+        {
+            return processedPosition;
+        }
+
+        /// <summary>
+        /// Returns true if this consumer is the only one reading the entry at this position.
+        /// During ProcessEntry the consumer may then take the buffer of the entry by swapping it instead of copying it.
+        /// </summary>
+        protected bool OwnsEntry(long position)
+        {
+            return buffer != null && buffer.IsExclusive(position, this);
+        }
+
         protected abstract void ProcessEntry(long position, Frame entry);
     }
 }
@@ -27,12 +27,29 @@ namespace Kinovea.Pipeline
 {
     public class FrameProducedEventArgs : EventArgs
     {
+        /// <summary>
+        /// The frame bytes, owned by the producer. Null if the frame is provided through the writer.
+        /// </summary>
         public readonly byte[] Buffer;
         public readonly int PayloadLength;
+
+        /// <summary>
+        /// Writes the frame bytes straight into the destination buffer, which is at least PayloadLength long.
+        /// Lets the producer fill the pipeline slot from its own memory without an intermediate buffer.
+        /// Only valid during the event, null if the frame is provided in Buffer.
+        /// </summary>
+        public readonly Action<byte[]> Writer;
+
         public FrameProducedEventArgs(byte[] buffer, int payloadLength)
         {
             this.Buffer = buffer;
             this.PayloadLength = payloadLength;
         }
+
+        public FrameProducedEventArgs(Action<byte[]> writer, int payloadLength)
+        {
+            this.Writer = writer;
+            this.PayloadLength = payloadLength;
+        }
     }
 }
\ No newline at end of file
@@ -28,5 +28,24 @@ namespace Kinovea.Pipeline
             System.Buffer.BlockCopy(source.Buffer, 0, this.Buffer, 0, source.PayloadLength);
             this.PayloadLength = source.PayloadLength;
         }
+
+        /// <summary>
+        /// Exchange the buffers of the two frames without copying the bytes.
+        /// Only done if the buffers have the same size, returns false otherwise.
+        /// The caller must be the only one referencing both frames.
+        /// </summary>
+        public bool Swap(Frame other)
+        {
+            if (other == this || other.Buffer.Length != this.Buffer.Length)
+                return false;
+
+            byte[] buffer = other.Buffer;
+            int payloadLength = other.PayloadLength;
+            other.Buffer = this.Buffer;
+            other.PayloadLength = this.PayloadLength;
+            this.Buffer = buffer;
+            this.PayloadLength = payloadLength;
+            return true;
+        }
     }
 }
@@ -162,20 +162,26 @@ namespace Kinovea.Pipeline
             }
             else
             {
-                WriteSlot(e.Buffer, e.PayloadLength, entry);
+                WriteSlot(e, entry);
             }
         }
 
-        private void WriteSlot(byte[] bytes, int payloadLength, Frame entry)
+        private void WriteSlot(FrameProducedEventArgs e, Frame entry)
         {
             //-------------------------
             // Runs in producer thread.
             //-------------------------
 
             // The slot is writeable, let's stuff it with camera bytes.
+            // Producers providing a writer fill the slot directly, saving a copy.
+            int payloadLength = e.PayloadLength;
             if (payloadLength <= entry.Buffer.Length)
             {
-                Buffer.BlockCopy(bytes, 0, entry.Buffer, 0, payloadLength);
+                if (e.Writer != null)
+                    e.Writer(entry.Buffer);
+                else
+                    Buffer.BlockCopy(e.Buffer, 0, entry.Buffer, 0, payloadLength);
+
                 entry.PayloadLength = payloadLength;
             }
             else
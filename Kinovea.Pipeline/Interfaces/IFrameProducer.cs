@@ -11,6 +11,7 @@ namespace Kinovea.Pipeline
         /// The camera received a new frame.
         /// The event is called from within the grabbing thread and the frame bytes are owned by grabbing.
         /// The event handler should make a copy of the bytes, push them to a queue and return as soon as possible.
+        /// Producers may provide a writer instead of a buffer, to fill the destination directly.
         /// </summary>
         event EventHandler<FrameProducedEventArgs> FrameProduced;
     }
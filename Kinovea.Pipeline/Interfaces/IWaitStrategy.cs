@@ -0,0 +1,21 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Pipeline
+{
+    /// <summary>
+    /// How a consumer waits for the producer to publish the next frame.
+    /// Trades CPU usage for wakeup latency.
+    /// </summary>
+    public interface IWaitStrategy
+    {
+        /// <summary>
+        /// Waits until the position is published, then returns the current producer position.
+        /// Gives up after the timeout in milliseconds and returns the producer position anyway, which may then be lower than the asked position.
+        /// This lets the consumer check whether it has been deactivated while the producer is stalled.
+        /// </summary>
+        long WaitFor(long position, RingBuffer buffer, int timeout);
+    }
+}
@@ -40,6 +40,8 @@ namespace Kinovea.Pipeline
         private CacheLineStorageLong producerPosition = new CacheLineStorageLong(-1); // Last position written to by the producer.
         private BenchmarkMode benchmarkMode;
         private bool allocated;
+        private object lockerCommit = new object();
+        private int parkedConsumers;                // Number of consumers blocked in Park().
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         public RingBuffer(int capacity, int bufferSize)
@@ -144,6 +146,15 @@ namespace Kinovea.Pipeline
             // The producer has finished stuffing the bytes in the Frame.
             // Mark the position as available for reading.
             producerPosition.Data = producerPosition.Data + 1;
+
+            // Wake up the consumers parked waiting for this frame. The lock is only taken if someone is parked.
+            // The barrier keeps the read of the counter after the write of the position, see Park().
+            Thread.MemoryBarrier();
+            if (Volatile.Read(ref parkedConsumers) > 0)
+            {
+                lock (lockerCommit)
+                    Monitor.PulseAll(lockerCommit);
+            }
         }
 
         private void WaitForReaders(long position)
@@ -189,27 +200,68 @@ namespace Kinovea.Pipeline
         }
         #endregion
 
+        #region Ownership
+        /// <summary>
+        /// Returns true if no other active consumer still needs the entry at this position.
+        /// The owner may then keep the buffer of the entry for itself by swapping it with one of its own frames,
+        /// instead of copying the bytes. The entry must not be read after the owner releases the position.
+        /// </summary>
+        public bool IsExclusive(long position, IFrameConsumer owner)
+        {
+            //---------------------------
+            // Runs in a consumer thread.
+            //---------------------------
+
+            // The other consumers hold the entry until they publish a position past it.
+            // Consumers that never read slots (display) always report they are up to date.
+            if (consumers == null || position > producerPosition.Data)
+                return false;
+
+            return consumers.All(c => c == owner || !c.Active || c.ConsumerPosition >= position);
+        }
+        #endregion
+
         #region Consumer barrier
-        public long WaitFor(long position)
+        public long WaitFor(long position, IWaitStrategy strategy, int timeout)
         {
             //---------------------------
             // Runs in a consumer thread.
             //---------------------------
 
-            // In the case of a fast consumer, this method will Yield the consumer thread until the asked position is written.
+            // In the case of a fast consumer, the strategy decides how to wait until the asked position is written.
             // In the case of a slow consumer, this method will return instantly with the current producer position,
             // this way the consumer can consume all the frames up to the current position on its own, in a tight loop.
-            // Thread context switch via Sleep() is not critical here, because it can only happen when the consumer is 
-            // faster than the producer anyway, so it should have time to catch-up later on.
-            while (position > producerPosition.Data)
+            if (position <= producerPosition.Data)
+                return producerPosition.Data;
+
+            return strategy.WaitFor(position, this, timeout);
+        }
+
+        /// <summary>
+        /// Blocks the calling consumer until the producer commits a frame or the timeout in milliseconds elapses.
+        /// Returns immediately if the position has already been published.
+        /// </summary>
+        public void Park(long position, int timeout)
+        {
+            //---------------------------
+            // Runs in a consumer thread.
+            //---------------------------
+            lock (lockerCommit)
             {
-                //Thread.Yield(); // Only in .NET 4.0
-                Thread.Sleep(0);
+                // The counter is incremented before checking the position and the producer writes the position before checking the counter.
+                // Either we see the new position or the producer sees us parked and pulses once we are waiting.
+                Interlocked.Increment(ref parkedConsumers);
+                try
+                {
+                    if (position > producerPosition.Data)
+                        Monitor.Wait(lockerCommit, timeout);
+                }
+                finally
+                {
+                    Interlocked.Decrement(ref parkedConsumers);
+                }
             }
-            
-            return producerPosition.Data;
         }
-
         #endregion
     }
 }
@@ -0,0 +1,29 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Base class for wait strategies, provides the timeout bookkeeping.
+    /// </summary>
+    public abstract class AbstractWaitStrategy : IWaitStrategy
+    {
+        public abstract long WaitFor(long position, RingBuffer buffer, int timeout);
+
+        /// <summary>
+        /// Returns the Stopwatch timestamp after which the wait should be abandoned.
+        /// </summary>
+        protected static long GetDeadline(int timeout)
+        {
+            return Stopwatch.GetTimestamp() + (long)timeout * Stopwatch.Frequency / 1000;
+        }
+
+        protected static bool Expired(long deadline)
+        {
+            return Stopwatch.GetTimestamp() >= deadline;
+        }
+    }
+}
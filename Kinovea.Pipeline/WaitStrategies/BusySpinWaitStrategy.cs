@@ -0,0 +1,34 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spins on the producer position without ever giving the core back.
+    /// Lowest wakeup latency, burns a full core for each consumer. 
+    /// Only makes sense when there are more cores than busy threads.
+    /// </summary>
+    public class BusySpinWaitStrategy : AbstractWaitStrategy
+    {
+        // Reading the clock is cheap but not free, only check the timeout once in a while.
+        private const int checkInterval = 1024;
+
+        public override long WaitFor(long position, RingBuffer buffer, int timeout)
+        {
+            long deadline = GetDeadline(timeout);
+            int iterations = 0;
+            while (position > buffer.ProducerPosition)
+            {
+                Thread.SpinWait(1);
+
+                if (++iterations % checkInterval == 0 && Expired(deadline))
+                    break;
+            }
+
+            return buffer.ProducerPosition;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spins briefly in case the frame is about to land, then blocks until the producer commits.
+    /// Costs almost no CPU when the consumer is faster than the camera, at the price of a thread wakeup per frame.
+    /// </summary>
+    public class SpinThenParkWaitStrategy : AbstractWaitStrategy
+    {
+        public override long WaitFor(long position, RingBuffer buffer, int timeout)
+        {
+            SpinWait spinner = new SpinWait();
+            while (position > buffer.ProducerPosition)
+            {
+                if (!spinner.NextSpinWillYield)
+                {
+                    spinner.SpinOnce();
+                    continue;
+                }
+
+                // The producer is slower than us, sleep until the next commit.
+                buffer.Park(position, timeout);
+                break;
+            }
+
+            return buffer.ProducerPosition;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Sleeps for a fixed interval between checks of the producer position.
+    /// Does not need the producer to signal anything. 
+    /// The wakeup latency is at least the interval and depends on the resolution of the system timer.
+    /// </summary>
+    public class TimedParkWaitStrategy : AbstractWaitStrategy
+    {
+        private int interval;
+
+        public TimedParkWaitStrategy(int interval = 1)
+        {
+            this.interval = Math.Max(interval, 1);
+        }
+
+        public override long WaitFor(long position, RingBuffer buffer, int timeout)
+        {
+            long deadline = GetDeadline(timeout);
+            while (position > buffer.ProducerPosition)
+            {
+                Thread.Sleep(interval);
+
+                if (Expired(deadline))
+                    break;
+            }
+
+            return buffer.ProducerPosition;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spins for a short while then gives the rest of the time slice to any other ready thread, in a loop.
+    /// Low wakeup latency, but the core is still reported busy when there is nothing else to run.
+    /// </summary>
+    public class YieldingWaitStrategy : AbstractWaitStrategy
+    {
+        private const int spinIterations = 100;
+
+        public override long WaitFor(long position, RingBuffer buffer, int timeout)
+        {
+            long deadline = GetDeadline(timeout);
+            int iterations = 0;
+            while (position > buffer.ProducerPosition)
+            {
+                if (iterations < spinIterations)
+                {
+                    iterations++;
+                    Thread.SpinWait(1);
+                    continue;
+                }
+
+                // Sleep(0) rather than Yield() so threads waiting on other cores can run too.
+                Thread.Sleep(0);
+
+                if (Expired(deadline))
+                    break;
+            }
+
+            return buffer.ProducerPosition;
+        }
+    }
+}
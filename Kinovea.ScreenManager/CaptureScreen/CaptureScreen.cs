@@ -1317,12 +1317,13 @@ namespace Kinovea.ScreenManager
             
             if (recordingMode == CaptureRecordingMode.Camera)
             {
-                consumerDisplay.ConsumeOne();
-                Frame freshFrame = consumerDisplay.Frame;
+                // The fresh frame is copied straight from the pipe into the delay buffer.
+                Frame freshFrame = consumerDisplay.Borrow();
                 if (freshFrame == null)
                     return;
 
                 delayer.Push(freshFrame);
+                consumerDisplay.Release();
             }
 
             // Get the displayed frame.
@@ -1984,6 +1985,7 @@ namespace Kinovea.ScreenManager
             log.DebugFormat("Manual scheduled recording: saving delay buffer content.");
 
             MJPEGWriter writer = new MJPEGWriter();
+            writer.Encoder = PreferencesManager.CapturePreferences.RecordingEncoderSettings;
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(imageDescriptor.Width, imageDescriptor.Height);
 
@@ -2225,7 +2227,8 @@ namespace Kinovea.ScreenManager
             // FIXME: get the size of ring buffer from outside.
             availableMemory -= (imageDescriptor.BufferSize * 8);
 
-            if (!delayer.NeedsReallocation(imageDescriptor, availableMemory))
+            bool compress = PreferencesManager.CapturePreferences.DelayCompression;
+            if (!delayer.NeedsReallocation(imageDescriptor, availableMemory, compress))
             {
                 // Make sure the delay UI agrees with the framerate.
                 UpdateDelayMaxAge();
@@ -2256,7 +2259,7 @@ namespace Kinovea.ScreenManager
                 }
             }
 
-            delayer.AllocateBuffers(imageDescriptor, availableMemory);
+            delayer.AllocateBuffers(imageDescriptor, availableMemory, compress);
 
             if ((recordingMode == CaptureRecordingMode.Delay || recordingMode == CaptureRecordingMode.Scheduled) && consumerDelayer != null)
                 consumerDelayer.Activate();
@@ -93,6 +93,11 @@ namespace Kinovea.ScreenManager
                 writer.Dispose();
 
             writer = new MJPEGWriter();
+            writer.Encoder = PreferencesManager.CapturePreferences.RecordingEncoderSettings;
+
+            // Frames are passed straight from the delay buffer without a copy, see ProcessEntry.
+            // Parallel encoders would queue the buffer reference itself while the slot is overwritten, the writer must stay synchronous.
+            writer.EncoderThreads = 1;
 
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(delayerImageDescriptor.Width, delayerImageDescriptor.Height);
@@ -153,7 +158,8 @@ namespace Kinovea.ScreenManager
             // During recording we extract frames from the delayer on that very same thread, 
             // and for the display it's not critical that the images be broken. (less critical than switching context each frame).
             // As this mode is tailored for delay scenario, in all likelihood the display is not going to be reading the frame we are writing to.
-            bool pushed = delayer.Push(entry);
+            // When nobody else reads the pipe we take the bytes of the entry instead of copying them.
+            bool pushed = delayer.Push(entry, OwnsEntry(position));
             if (!pushed)
             {
                 // Very critical error. Most likely cross thread access to the same frame.
@@ -172,9 +178,10 @@ namespace Kinovea.ScreenManager
                 // Extract a bitmap from delayer at right delay and convert it into a frame for the writer.
                 // Note that we do not go through the delay compositer. We only support "normal" delay here.
                 // Compositers (e.g: quadrants with different ages) are only supported in display.
-                bool copied = delayer.GetStrong(age, delayedFrame);
-                if (copied)
-                    writer.SaveFrame(delayerImageDescriptor.Format, delayedFrame.Buffer, delayedFrame.PayloadLength, delayerImageDescriptor.TopDown);
+                // The writer encodes synchronously on this thread, the thread pushing to the delayer, so it can read the slot in place.
+                Frame frame = delayer.Borrow(age, delayedFrame);
+                if (frame != null)
+                    writer.SaveFrame(delayerImageDescriptor.Format, frame.Buffer, frame.PayloadLength, delayerImageDescriptor.TopDown);
             }
 
             Ellapsed = stopwatch.ElapsedMilliseconds - then;
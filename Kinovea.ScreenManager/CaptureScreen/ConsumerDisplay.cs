@@ -32,22 +32,19 @@ namespace Kinovea.ScreenManager
         {
             get 
             {
-                // Always report that we are up to date so we never clog the pipe.
-                return buffer.ProducerPosition;
+                // Report that we are up to date so we never clog the pipe,
+                // except while we borrow a slot, so the producer doesn't overwrite it under our feet.
+                long borrowed = Interlocked.Read(ref borrowedPosition);
+                return borrowed >= 0 ? borrowed - 1 : buffer.ProducerPosition;
             }
         }
 
-        public Frame Frame
-        {
-            get { return frame; }
-        }
-
         public long Ellapsed { get; private set; }
 
         private RingBuffer buffer;
         private ImageDescriptor imageDescriptor;
-        private Frame frame;
         private bool allocated;
+        private long borrowedPosition = -1;
         private Stopwatch stopwatch = new Stopwatch();
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
@@ -88,10 +85,6 @@ namespace Kinovea.ScreenManager
             try
             {
                 this.imageDescriptor = imageDescriptor;
-                int bufferSize = ImageFormatHelper.ComputeBufferSize(imageDescriptor.Width, imageDescriptor.Height, imageDescriptor.Format);
-                frame = new Frame(bufferSize);
-                GC.Collect();
-
                 allocated = true;
             }
             catch (Exception e)
@@ -102,29 +95,36 @@ namespace Kinovea.ScreenManager
         }
 
         /// <summary>
-        /// Consume a single frame and return immediately.
-        /// Publish the Bitmap in Bitmap property.
-        /// Returns immediately if no frame are available in the pipe.
+        /// Borrow the latest frame from the pipe, without copy, or return null if no frame is available.
+        /// The slot is kept out of the reach of the producer until Release is called, which should happen as soon as possible.
         /// This should be called after the main thread received a notification of a frame event from the camera.
         /// </summary>
-        public void ConsumeOne()
+        public Frame Borrow()
         {
             // We only consume a single frame to avoid slowing down the chain.
             // Dropping frames is not critical for display.
             // Always consume the very latest frame.
+            RingBuffer buffer = this.buffer;
+            if (!allocated || buffer == null || buffer.ProducerPosition < 0)
+                return null;
 
-            if (!allocated || buffer.ProducerPosition < 0)
-                return;
-
-            long then = stopwatch.ElapsedMilliseconds;
+            stopwatch.Restart();
 
+            // The producer would have to go around the whole ring between the read of its position
+            // and the publication of ours to overwrite this slot.
             long next = buffer.ProducerPosition;
-            
-            Frame entry = buffer.GetEntry(next);
-            if (allocated)
-                frame.Import(entry);
+            Interlocked.Exchange(ref borrowedPosition, next);
 
-            Ellapsed = stopwatch.ElapsedMilliseconds - then;
+            return buffer.GetEntry(next);
+        }
+
+        /// <summary>
+        /// Give the borrowed slot back to the producer.
+        /// </summary>
+        public void Release()
+        {
+            Interlocked.Exchange(ref borrowedPosition, -1);
+            Ellapsed = stopwatch.ElapsedMilliseconds;
         }
     }
 }
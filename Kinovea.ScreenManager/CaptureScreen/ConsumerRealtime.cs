@@ -29,6 +29,7 @@ namespace Kinovea.ScreenManager
         private MJPEGWriter writer;
         private bool recording;
         private string shortId;
+        private long firstPosition = -1;
         private Stopwatch stopwatch = new Stopwatch();
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
@@ -56,6 +57,8 @@ namespace Kinovea.ScreenManager
                 writer.Dispose();
 
             writer = new MJPEGWriter();
+            writer.EncoderThreads = GetEncoderThreads();
+            writer.Encoder = PreferencesManager.CapturePreferences.RecordingEncoderSettings;
             
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(imageDescriptor.Width, imageDescriptor.Height);
@@ -73,6 +76,12 @@ namespace Kinovea.ScreenManager
             return result;
         }
 
+        protected override void BeforeActivate()
+        {
+            firstPosition = -1;
+            base.BeforeActivate();
+        }
+
         protected override void AfterDeactivate()
         {
             if (recording)
@@ -92,11 +101,34 @@ namespace Kinovea.ScreenManager
             if (writer == null)
                 return;
 
+            if (firstPosition < 0)
+                firstPosition = position;
+
             long then = stopwatch.ElapsedMilliseconds;
 
             writer.SaveFrame(imageDescriptor.Format, entry.Buffer, entry.PayloadLength, imageDescriptor.TopDown);
 
             Ellapsed = stopwatch.ElapsedMilliseconds - then;
         }
+
+        protected override long GetReleasedPosition(long processedPosition)
+        {
+            // With parallel encoding the writer may still be reading the slots after SaveFrame returns.
+            // Every entry since activation went to the writer, in order.
+            if (writer == null || firstPosition < 0)
+                return processedPosition;
+
+            return firstPosition + writer.FramesReleased - 1;
+        }
+
+        private int GetEncoderThreads()
+        {
+            int threads = PreferencesManager.CapturePreferences.RecordingEncoderThreads;
+            if (threads > 0)
+                return threads;
+
+            // Automatic: leave room for the camera, display and delay threads.
+            return Math.Max(1, Math.Min(4, Environment.ProcessorCount / 2));
+        }
     }
 }
@@ -0,0 +1,351 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Kinovea.Pipeline;
+using Kinovea.Services;
+using Kinovea.Services.TurboJpeg;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// JPEG compression of the frames stored in the delay buffer.
+    /// Frames are compressed by a small pool of worker threads into fixed size slots,
+    /// and decompressed back to the original layout when they are read.
+    /// When all the workers are busy the frame is compressed on the calling thread instead, so no frame is ever dropped.
+    /// </summary>
+    public class DelayCompressor : IDisposable
+    {
+        #region Properties
+        /// <summary>
+        /// Size in bytes of the slots receiving the compressed frames.
+        /// </summary>
+        public int SlotSize
+        {
+            get { return slotSize; }
+        }
+
+        /// <summary>
+        /// Memory used by the uncompressed frames waiting for a worker.
+        /// </summary>
+        public long StagingMemory
+        {
+            get { return (long)stagingCount * bufferSize; }
+        }
+
+        /// <summary>
+        /// Average size of the uncompressed frames over the size of the compressed frames.
+        /// </summary>
+        public double CompressionRatio
+        {
+            get
+            {
+                long compressed = Interlocked.Read(ref compressedBytes);
+                return compressed > 0 ? (double)Interlocked.Read(ref rawBytes) / compressed : 0;
+            }
+        }
+
+        /// <summary>
+        /// Average time to compress one frame, in milliseconds.
+        /// </summary>
+        public double EncodeLatency
+        {
+            get
+            {
+                long frames = Interlocked.Read(ref encodedFrames);
+                return frames > 0 ? (double)Interlocked.Read(ref encodeTicks) * 1000 / Stopwatch.Frequency / frames : 0;
+            }
+        }
+
+        /// <summary>
+        /// Number of frames that could not fit their slot even at the fallback quality.
+        /// </summary>
+        public long Failures
+        {
+            get { return Interlocked.Read(ref failures); }
+        }
+        #endregion
+
+        #region Members
+        // Slots are sized for this ratio. Frames that don't fit are compressed again at the fallback quality.
+        private const int targetRatio = 6;
+        private const int fallbackQuality = 50;
+        private const int maxWorkers = 4;
+
+        private readonly int width;
+        private readonly int height;
+        private readonly int pitch;
+        private readonly int bufferSize;
+        private readonly int slotSize;
+        private readonly int quality;
+        private readonly int stagingCount;
+        private readonly TJPF pixelFormat;
+        private readonly TJSAMP subsampling;
+        private readonly Action<int> compressed;
+
+        private readonly List<Thread> workers = new List<Thread>();
+        private readonly BlockingCollection<Job> jobs = new BlockingCollection<Job>();
+        private readonly ConcurrentQueue<Frame> staging = new ConcurrentQueue<Frame>();
+        private int pendingJobs;
+        private Encoder inlineEncoder;
+        private IntPtr decompressor;
+
+        private long encodedFrames;
+        private long encodeTicks;
+        private long rawBytes;
+        private long compressedBytes;
+        private long failures;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+        #endregion
+
+        /// <summary>
+        /// Whether frames of this format can be compressed.
+        /// </summary>
+        public static bool Supports(ImageFormat format)
+        {
+            return format == ImageFormat.RGB24 || format == ImageFormat.RGB32 || format == ImageFormat.Y800;
+        }
+
+        /// <summary>
+        /// Computes the size of the slots for this image format without allocating anything.
+        /// </summary>
+        public static int ComputeSlotSize(int bufferSize)
+        {
+            return Math.Max(bufferSize / targetRatio, 1);
+        }
+
+        /// <summary>
+        /// Computes the memory used outside the slots: the staging frames and the decompression buffer of the reader.
+        /// </summary>
+        public static long ComputeOverhead(int bufferSize)
+        {
+            return (long)(ComputeWorkerCount() * 2 + 1) * bufferSize;
+        }
+
+        /// <summary>
+        /// Creates the compressor and starts the workers.
+        /// The callback is called on the compressing thread once the slot is filled, with the position of the frame.
+        /// </summary>
+        public DelayCompressor(ImageDescriptor imageDescriptor, int quality, int maxStaging, Action<int> compressed)
+        {
+            this.width = imageDescriptor.Width;
+            this.height = imageDescriptor.Height;
+            this.bufferSize = ImageFormatHelper.ComputeBufferSize(width, height, imageDescriptor.Format);
+            this.slotSize = ComputeSlotSize(bufferSize);
+            this.quality = quality;
+            this.compressed = compressed;
+
+            switch (imageDescriptor.Format)
+            {
+                case ImageFormat.RGB32:
+                    pixelFormat = TJPF.TJPF_BGRX;
+                    subsampling = TJSAMP.TJSAMP_420;
+                    pitch = width * 4;
+                    break;
+                case ImageFormat.Y800:
+                    pixelFormat = TJPF.TJPF_GRAY;
+                    subsampling = TJSAMP.TJSAMP_GRAY;
+                    pitch = width;
+                    break;
+                case ImageFormat.RGB24:
+                default:
+                    pixelFormat = TJPF.TJPF_BGR;
+                    subsampling = TJSAMP.TJSAMP_420;
+                    pitch = width * 3;
+                    break;
+            }
+
+            inlineEncoder = new Encoder(width, height, subsampling);
+            decompressor = tjnet.tjInitDecompress();
+
+            // Two frames in flight per worker, capped by the reserve of the delay buffer.
+            // This only bounds the memory, the distance between the writer and the readers is bounded by the delayer itself.
+            int workerCount = ComputeWorkerCount();
+            stagingCount = Math.Max(1, Math.Min(workerCount * 2, maxStaging));
+            for (int i = 0; i < stagingCount; i++)
+                staging.Enqueue(new Frame(bufferSize));
+
+            for (int i = 0; i < workerCount; i++)
+            {
+                Thread worker = new Thread(Work) { IsBackground = true, Name = "DelayCompressor-" + i };
+                workers.Add(worker);
+                worker.Start();
+            }
+
+            log.DebugFormat("Delay compression: {0} workers, {1} staging frames, slots of {2} KB.", workerCount, stagingCount, slotSize / 1024);
+        }
+
+        /// <summary>
+        /// Compresses the frame into the slot.
+        /// Hands the frame to a worker and returns immediately if one is available, compresses it on the calling thread otherwise.
+        /// If exchange is true the source buffer is swapped with a staging one instead of being copied.
+        /// </summary>
+        public void Push(Frame src, Frame slot, int position, bool exchange)
+        {
+            Frame copy;
+            if (!jobs.IsAddingCompleted && staging.TryDequeue(out copy))
+            {
+                if (!exchange || !copy.Swap(src))
+                    copy.Import(src);
+
+                Interlocked.Increment(ref pendingJobs);
+                jobs.Add(new Job(copy, slot, position));
+                return;
+            }
+
+            Compress(inlineEncoder, src, slot);
+            compressed(position);
+        }
+
+        /// <summary>
+        /// Waits until all the frames pushed so far have been compressed.
+        /// </summary>
+        public void Drain()
+        {
+            SpinWait spinner = new SpinWait();
+            while (Volatile.Read(ref pendingJobs) > 0)
+                spinner.SpinOnce();
+        }
+
+        /// <summary>
+        /// Decompresses the slot into a buffer laid out like the original frame.
+        /// Not thread safe, calls must be serialized by the caller.
+        /// </summary>
+        public bool Decompress(Frame slot, byte[] dst)
+        {
+            if (slot.PayloadLength <= 0 || dst.Length < bufferSize)
+                return false;
+
+            IntPtr result = tjnet.tjDecompress2(decompressor, slot.Buffer, (uint)slot.PayloadLength, dst, width, pitch, height, pixelFormat, TJFLAG.TJFLAG_FASTDCT);
+            return result == IntPtr.Zero;
+        }
+
+        /// <summary>
+        /// Writes the compression statistics to the log.
+        /// </summary>
+        public void LogStats()
+        {
+            log.DebugFormat("Delay compression: {0} frames, ratio: {1:0.0}:1, encode latency: {2:0.00} ms, failures: {3}.",
+                Interlocked.Read(ref encodedFrames), CompressionRatio, EncodeLatency, Failures);
+        }
+
+        public void Dispose()
+        {
+            jobs.CompleteAdding();
+            foreach (Thread worker in workers)
+                worker.Join();
+
+            workers.Clear();
+            jobs.Dispose();
+
+            inlineEncoder.Dispose();
+            tjnet.tjDestroy(decompressor);
+            decompressor = IntPtr.Zero;
+        }
+
+        private static int ComputeWorkerCount()
+        {
+            return Math.Max(1, Math.Min(Environment.ProcessorCount / 2, maxWorkers));
+        }
+
+        private void Work()
+        {
+            using (Encoder encoder = new Encoder(width, height, subsampling))
+            {
+                foreach (Job job in jobs.GetConsumingEnumerable())
+                {
+                    Compress(encoder, job.Source, job.Slot);
+                    staging.Enqueue(job.Source);
+                    compressed(job.Position);
+                    Interlocked.Decrement(ref pendingJobs);
+                }
+            }
+        }
+
+        private void Compress(Encoder encoder, Frame src, Frame slot)
+        {
+            long then = Stopwatch.GetTimestamp();
+
+            int length = encoder.Compress(src.Buffer, width, pitch, height, pixelFormat, quality, slot.Buffer);
+            if (length < 0)
+                length = encoder.Compress(src.Buffer, width, pitch, height, pixelFormat, fallbackQuality, slot.Buffer);
+
+            if (length < 0)
+            {
+                // The slot is marked empty and readers will skip it.
+                Interlocked.Increment(ref failures);
+                slot.PayloadLength = 0;
+            }
+            else
+            {
+                slot.PayloadLength = length;
+                Interlocked.Add(ref compressedBytes, length);
+                Interlocked.Add(ref rawBytes, bufferSize);
+            }
+
+            Interlocked.Add(ref encodeTicks, Stopwatch.GetTimestamp() - then);
+            Interlocked.Increment(ref encodedFrames);
+        }
+
+        private struct Job
+        {
+            public readonly Frame Source;
+            public readonly Frame Slot;
+            public readonly int Position;
+
+            public Job(Frame source, Frame slot, int position)
+            {
+                this.Source = source;
+                this.Slot = slot;
+                this.Position = position;
+            }
+        }
+
+        /// <summary>
+        /// A TurboJPEG compressor with a destination buffer large enough for any frame, so it never reallocates.
+        /// Owned by a single thread.
+        /// </summary>
+        private class Encoder : IDisposable
+        {
+            private IntPtr handle;
+            private IntPtr buffer;
+            private uint capacity;
+            private TJSAMP subsampling;
+
+            public Encoder(int width, int height, TJSAMP subsampling)
+            {
+                this.subsampling = subsampling;
+                handle = tjnet.tjInitCompress();
+                capacity = tjnet.tjBufSize(width, height, subsampling);
+                buffer = tjnet.tjAlloc((int)capacity);
+            }
+
+            /// <summary>
+            /// Compresses the image into the destination array. Returns the length of the JPEG or -1 if it doesn't fit.
+            /// </summary>
+            public int Compress(byte[] src, int width, int pitch, int height, TJPF pixelFormat, int quality, byte[] dst)
+            {
+                IntPtr jpegBuf = buffer;
+                uint jpegSize = capacity;
+                int result = tjnet.tjCompress2(handle, src, width, pitch, height, pixelFormat, ref jpegBuf, ref jpegSize,
+                    subsampling, quality, TJFLAG.TJFLAG_FASTDCT | TJFLAG.TJFLAG_NOREALLOC);
+
+                if (result != 0 || jpegSize > dst.Length)
+                    return -1;
+
+                Marshal.Copy(jpegBuf, dst, 0, (int)jpegSize);
+                return (int)jpegSize;
+            }
+
+            public void Dispose()
+            {
+                tjnet.tjFree(buffer);
+                tjnet.tjDestroy(handle);
+                buffer = IntPtr.Zero;
+                handle = IntPtr.Zero;
+            }
+        }
+    }
+}
@@ -9,6 +9,7 @@ using System.Drawing.Imaging;
 using System.Diagnostics;
 using System.Threading;
 using Kinovea.Services;
+using Kinovea.Video.FFMpeg;
 
 namespace Kinovea.ScreenManager
 {
@@ -31,6 +32,30 @@ namespace Kinovea.ScreenManager
         {
             get { return currentPosition; }
         }
+
+        /// <summary>
+        /// Whether the frames are stored JPEG-compressed.
+        /// </summary>
+        public bool Compressed
+        {
+            get { return compressor != null; }
+        }
+
+        /// <summary>
+        /// Average compression ratio of the stored frames, or 0 if frames are not compressed.
+        /// </summary>
+        public double CompressionRatio
+        {
+            get { return compressor != null ? compressor.CompressionRatio : 0; }
+        }
+
+        /// <summary>
+        /// Average time to compress a frame in milliseconds, or 0 if frames are not compressed.
+        /// </summary>
+        public double EncodeLatency
+        {
+            get { return compressor != null ? compressor.EncodeLatency : 0; }
+        }
         #endregion
 
         #region Members
@@ -40,12 +65,18 @@ namespace Kinovea.ScreenManager
         private int reserveCapacity = 8;    // Number of frames kept unreachable to clients.
         private int fullCapacity = 12;      // Total number of frames kept.
         private int currentPosition = -1;   // Freshest absolute position written to and available to consumers.
+        private int pushedPosition = -1;    // Freshest absolute position pushed, may still be compressing.
         private int triggerPosition = -1;
         private bool allocated;
+        private bool compressionAsked;
         private long availableMemory;
         private ImageDescriptor imageDescriptor;
         int pitch;
         byte[] tempJpeg;
+        private Bitmap unoriented;          // Scratch image for frames that need to be rotated or mirrored before display.
+        private DelayCompressor compressor; // Null unless frames are stored compressed.
+        private int[] slotPositions;        // Absolute position held by each slot once compressed.
+        private byte[] decompressed;        // Scratch buffer for decompressed frames going to display.
         private Stopwatch stopwatch = new Stopwatch();
         private object lockerFrame = new object();
         private object lockerPosition = new object();
@@ -55,15 +86,22 @@ namespace Kinovea.ScreenManager
         #region Public methods
         /// <summary>
         /// Attempt to preallocate the circular buffer for as many images as possible that fits in available memory.
+        /// If compression is asked and supported by the image format, the frames are stored as JPEG in smaller slots.
         /// </summary>
-        public bool AllocateBuffers(ImageDescriptor imageDescriptor, long availableMemory)
+        public bool AllocateBuffers(ImageDescriptor imageDescriptor, long availableMemory, bool compress)
         {
-            if (!NeedsReallocation(imageDescriptor, availableMemory))
+            if (!NeedsReallocation(imageDescriptor, availableMemory, compress))
                 return true;
 
-            int targetCapacity = (int)(availableMemory / imageDescriptor.BufferSize);
+            int bufferSize = ImageFormatHelper.ComputeBufferSize(imageDescriptor.Width, imageDescriptor.Height, imageDescriptor.Format);
+            bool useCompression = UseCompression(imageDescriptor, compress);
+            int slotSize = useCompression ? DelayCompressor.ComputeSlotSize(bufferSize) : imageDescriptor.BufferSize;
+            long slotMemory = useCompression ? availableMemory - DelayCompressor.ComputeOverhead(bufferSize) : availableMemory;
+            slotMemory = Math.Max(slotMemory, 0);
+
+            int targetCapacity = (int)(slotMemory / slotSize);
 
-            bool memoryPressure = minCapacity * imageDescriptor.BufferSize > availableMemory;
+            bool memoryPressure = minCapacity * slotSize > slotMemory;
             if (memoryPressure)
             {
                 // The user explicitly asked to not use enough memory. We try to honor the request by lowering the min levels.
@@ -79,12 +117,21 @@ namespace Kinovea.ScreenManager
                 targetCapacity = Math.Max(targetCapacity, minCapacity);
             }
             
-            bool compatible = ImageDescriptor.Compatible(this.imageDescriptor, imageDescriptor);
+            bool compatible = ImageDescriptor.Compatible(this.imageDescriptor, imageDescriptor) && Compressed == useCompression;
+
+            // Slots are about to move, let the pending compressions land first.
+            if (compatible && compressor != null)
+                compressor.Drain();
+
             if (compatible && targetCapacity <= fullCapacity)
             {
                 FreeSome(targetCapacity);
                 this.fullCapacity = frames.Count;
                 this.availableMemory = availableMemory;
+                this.compressionAsked = compress;
+                if (compressor != null)
+                    ResizeSlotPositions();
+
                 return true;
             }
             
@@ -95,13 +142,11 @@ namespace Kinovea.ScreenManager
             frames.Capacity = targetCapacity;
             log.DebugFormat("Allocating {0} frames.", targetCapacity - fullCapacity);
 
-            int bufferSize = ImageFormatHelper.ComputeBufferSize(imageDescriptor.Width, imageDescriptor.Height, imageDescriptor.Format);
-
             try
             {
                 for (int i = fullCapacity; i < targetCapacity; i++)
                 {
-                    Frame slot = new Frame(bufferSize);
+                    Frame slot = new Frame(useCompression ? slotSize : bufferSize);
                     frames.Add(slot);
                 }
             }
@@ -122,21 +167,33 @@ namespace Kinovea.ScreenManager
                 this.fullCapacity = frames.Count;
                 this.availableMemory = availableMemory;
                 this.imageDescriptor = imageDescriptor;
+                this.compressionAsked = compress;
+
+                if (useCompression)
+                {
+                    ResizeSlotPositions();
+                    if (compressor == null)
+                    {
+                        int quality = PreferencesManager.CapturePreferences.DelayCompressionQuality;
+                        compressor = new DelayCompressor(imageDescriptor, quality, reserveCapacity - 1, Compressed_Completed);
+                        decompressed = new byte[bufferSize];
+                    }
+                }
 
                 // Better do the GC now to push everything to gen2 and LOH rather than taking a hit later during normal streaming operations.
                 GC.Collect(2);
             }
 
-            log.DebugFormat("Allocated delay buffer: {0} ms. Total: {1} frames.", stopwatch.ElapsedMilliseconds, fullCapacity);
+            log.DebugFormat("Allocated delay buffer: {0} ms. Total: {1} frames{2}.", stopwatch.ElapsedMilliseconds, fullCapacity, Compressed ? " (compressed)" : "");
             return allocated;
         }
 
         /// <summary>
         /// Returns true if the delayer needs to allocate or reallocate memory.
         /// </summary>
-        public bool NeedsReallocation(ImageDescriptor imageDescriptor, long availableMemory)
+        public bool NeedsReallocation(ImageDescriptor imageDescriptor, long availableMemory, bool compress)
         {
-            return !allocated || !ImageDescriptor.Compatible(this.imageDescriptor, imageDescriptor) || this.availableMemory != availableMemory;
+            return !allocated || !ImageDescriptor.Compatible(this.imageDescriptor, imageDescriptor) || this.availableMemory != availableMemory || this.compressionAsked != compress;
         }
 
         /// <summary>
@@ -144,6 +201,16 @@ namespace Kinovea.ScreenManager
         /// Copies the content into a pre-allocated slot.
         /// </summary>
         public bool Push(Frame src)
+        {
+            return Push(src, false);
+        }
+
+        /// <summary>
+        /// Push a single frame to the buffer.
+        /// If exchange is true the caller gives up the source frame: its buffer is swapped with the one of the slot
+        /// instead of being copied, and the source frame comes back with stale content.
+        /// </summary>
+        public bool Push(Frame src, bool exchange)
         {
             //-----------------------------------------
             // Runs in UI thread in mode Camera.
@@ -152,13 +219,18 @@ namespace Kinovea.ScreenManager
             if (!allocated)
                 return false;
 
+            if (compressor != null)
+                return PushCompressed(src, exchange);
+
             int nextPosition = currentPosition + 1;
             int index = nextPosition % fullCapacity;
             bool pushed = false;
 
             try
             {
-                frames[index].Import(src);
+                if (!exchange || !frames[index].Swap(src))
+                    frames[index].Import(src);
+
                 pushed = true;
             }
             catch
@@ -173,6 +245,64 @@ namespace Kinovea.ScreenManager
             return pushed;
         }
 
+        /// <summary>
+        /// Push a single frame to the buffer, compressing it into a pre-allocated slot.
+        /// The frame only becomes available to consumers once it and all the frames before it are compressed.
+        /// </summary>
+        private bool PushCompressed(Frame src, bool exchange)
+        {
+            WaitForReaders();
+
+            int nextPosition = pushedPosition + 1;
+            pushedPosition = nextPosition;
+
+            try
+            {
+                compressor.Push(src, frames[nextPosition % fullCapacity], nextPosition, exchange);
+                return true;
+            }
+            catch
+            {
+                log.ErrorFormat("Failed to push frame to delay buffer.");
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Waits until the writer is less than the reserve capacity ahead of the published position.
+        /// Frames complete out of order, if one worker stalls the published position stops moving while the other
+        /// workers keep landing frames. Past the reserve the next slots are still readable by consumers.
+        /// </summary>
+        private void WaitForReaders()
+        {
+            SpinWait spinner = new SpinWait();
+            while (true)
+            {
+                int published;
+                lock (lockerPosition)
+                    published = currentPosition;
+
+                if (pushedPosition - published < reserveCapacity - 1)
+                    break;
+
+                spinner.SpinOnce();
+            }
+        }
+
+        /// <summary>
+        /// Called on the compressing thread once the frame at this position has been stored.
+        /// </summary>
+        private void Compressed_Completed(int position)
+        {
+            // Frames may complete out of order, only publish the contiguous run.
+            lock (lockerPosition)
+            {
+                slotPositions[position % fullCapacity] = position;
+                while (slotPositions[(currentPosition + 1) % fullCapacity] == currentPosition + 1)
+                    currentPosition++;
+            }
+        }
+
         /// <summary>
         /// Get the frame from `age` frames ago, wait for it if necessary, copy it into the passed buffer.
         /// </summary>
@@ -190,12 +320,38 @@ namespace Kinovea.ScreenManager
             // taken the lock on the image, we wait for it.
             lock (lockerFrame)
             {
-                dst.Import(frame);
+                if (compressor == null)
+                {
+                    dst.Import(frame);
+                }
+                else
+                {
+                    if (!compressor.Decompress(frame, dst.Buffer))
+                        return false;
+
+                    dst.PayloadLength = ImageFormatHelper.ComputeBufferSize(imageDescriptor.Width, imageDescriptor.Height, imageDescriptor.Format);
+                }
             }
 
             return true;
         }
 
+        /// <summary>
+        /// Get the frame from `age` frames ago for reading, without copying it when possible.
+        /// Stored frames are returned as is, compressed frames are decompressed into the passed buffer.
+        /// Must be called on the thread pushing the frames, which can't overwrite the slot while the caller reads it.
+        /// </summary>
+        public Frame Borrow(int age, Frame scratch)
+        {
+            //-----------------------------------------------
+            // Runs in the consumer thread, during recording.
+            //-----------------------------------------------
+            if (compressor != null)
+                return GetStrong(age, scratch) ? scratch : null;
+
+            return Get(age, out _);
+        }
+
         /// <summary>
         /// Get the frame from `age` frames ago as an RGB24 Bitmap, correctly oriented. Do not wait for it and returns null if it's not available. 
         /// The out target parameter provides the actual frame position we got, or a negative number if we are not ready yet. This can be used
@@ -220,51 +376,51 @@ namespace Kinovea.ScreenManager
                     if (frame == null)
                         return null;
 
+                    byte[] buffer = frame.Buffer;
+                    if (compressor != null)
+                    {
+                        if (!compressor.Decompress(frame, decompressed))
+                            return null;
+
+                        buffer = decompressed;
+                    }
+
                     // Returns a newly allocated RGB24 bitmap.
                     // TODO: maybe get a pre-allocated bitmap from caller.
-                    copy = new Bitmap(imageDescriptor.Width, imageDescriptor.Height, PixelFormat.Format24bppRgb);
+                    Size size = ImageRotator.GetRotatedSize(rect.Size, rotation);
+                    copy = new Bitmap(size.Width, size.Height, PixelFormat.Format24bppRgb);
+
+                    // If the image must be rotated or mirrored we fill the scratch image and
+                    // rotate from there into the final one, otherwise we fill the final one directly.
+                    bool oriented = rotation == ImageRotation.Rotate0 && !mirror;
+                    if (!oriented && (unoriented == null || unoriented.Size != rect.Size))
+                    {
+                        if (unoriented != null)
+                            unoriented.Dispose();
+
+                        unoriented = new Bitmap(rect.Width, rect.Height, PixelFormat.Format24bppRgb);
+                    }
+
+                    Bitmap fillTarget = oriented ? copy : unoriented;
 
                     switch (imageDescriptor.Format)
                     {
                         case Kinovea.Services.ImageFormat.RGB24:
-                            BitmapHelper.FillFromRGB24(copy, rect, imageDescriptor.TopDown, frame.Buffer);
+                            BitmapHelper.FillFromRGB24(fillTarget, rect, imageDescriptor.TopDown, buffer);
                             break;
                         case Kinovea.Services.ImageFormat.RGB32:
-                            BitmapHelper.FillFromRGB32(copy, rect, imageDescriptor.TopDown, frame.Buffer);
+                            BitmapHelper.FillFromRGB32(fillTarget, rect, imageDescriptor.TopDown, buffer);
                             break;
                         case Kinovea.Services.ImageFormat.Y800:
-                            BitmapHelper.FillFromY800(copy, rect, imageDescriptor.TopDown, frame.Buffer);
+                            BitmapHelper.FillFromY800(fillTarget, rect, imageDescriptor.TopDown, buffer);
                             break;
                         case Kinovea.Services.ImageFormat.JPEG:
-                            BitmapHelper.FillFromJPEG(copy, rect, tempJpeg, frame.Buffer, frame.PayloadLength, pitch);
+                            BitmapHelper.FillFromJPEG(fillTarget, rect, tempJpeg, frame.Buffer, frame.PayloadLength, pitch);
                             break;
                     }
 
-                    switch (rotation)
-                    {
-                        case ImageRotation.Rotate90:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate90FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate90FlipNone);
-                            break;
-                        case ImageRotation.Rotate180:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate180FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate180FlipNone);
-                            break;
-                        case ImageRotation.Rotate270:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate270FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate270FlipNone);
-                            break;
-                        default:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.RotateNoneFlipX);
-                            break;
-                    }
+                    if (!oriented)
+                        ImageRotator.Rotate(unoriented, copy, rotation, mirror);
                 }
                 catch
                 {
@@ -373,6 +529,14 @@ namespace Kinovea.ScreenManager
 
             log.DebugFormat("Freeing {0} frames.", fullCapacity);
 
+            if (compressor != null)
+            {
+                // Stops the workers, they may still be writing to the slots.
+                compressor.LogStats();
+                compressor.Dispose();
+                compressor = null;
+            }
+
             frames.Clear();
             GC.Collect(2);
 
@@ -387,8 +551,44 @@ namespace Kinovea.ScreenManager
             fullCapacity = 0;
             rect = Rectangle.Empty;
             imageDescriptor = ImageDescriptor.Invalid;
+
+            if (unoriented != null)
+            {
+                unoriented.Dispose();
+                unoriented = null;
+            }
             availableMemory = 0;
             currentPosition = -1;
+            pushedPosition = -1;
+            compressionAsked = false;
+            slotPositions = null;
+            decompressed = null;
+        }
+
+        /// <summary>
+        /// Returns true if the frames should be stored compressed.
+        /// Frames coming from the camera already compressed are stored as is.
+        /// </summary>
+        private bool UseCompression(ImageDescriptor imageDescriptor, bool compress)
+        {
+            return compress && DelayCompressor.Supports(imageDescriptor.Format);
+        }
+
+        /// <summary>
+        /// Matches the slot positions to the current capacity.
+        /// Slots are considered empty until the next frame lands on them.
+        /// </summary>
+        private void ResizeSlotPositions()
+        {
+            int[] positions = new int[fullCapacity];
+            for (int i = 0; i < positions.Length; i++)
+                positions[i] = -1;
+
+            lock (lockerPosition)
+            {
+                slotPositions = positions;
+                pushedPosition = currentPosition;
+            }
         }
 
         private void FreeSome(int targetCapacity)
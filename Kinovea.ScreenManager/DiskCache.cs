@@ -0,0 +1,182 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+using Kinovea.Services;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Storage shared by the disk caches: one file per entry in a sub folder of the application cache directory.
+    /// Entries are named after a hash of their identity, written atomically, and evicted least recently used first.
+    /// The format of the entries is up to the caller. Errors are logged and reported as failures.
+    /// </summary>
+    public class DiskCache
+    {
+        private string name;
+        private string folder;
+        private string extension;
+        private long maxBytes;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <param name="name">Name of the cache in the log.</param>
+        /// <param name="folder">Sub folder of the application cache directory.</param>
+        /// <param name="extension">Extension of the entry files, including the dot.</param>
+        /// <param name="maxBytes">Total size above which entries are evicted.</param>
+        public DiskCache(string name, string folder, string extension, long maxBytes)
+        {
+            this.name = name;
+            this.folder = folder;
+            this.extension = extension;
+            this.maxBytes = maxBytes;
+        }
+
+        /// <summary>
+        /// Returns the path of the entry for this identity, or null if there is no cache directory.
+        /// The identity is hashed as is, the caller is responsible for normalizing it.
+        /// </summary>
+        public string GetEntryPath(string identity)
+        {
+            string directory = GetDirectory();
+            if (directory == null || string.IsNullOrEmpty(identity))
+                return null;
+
+            using (MD5 md5 = MD5.Create())
+            {
+                byte[] hash = md5.ComputeHash(Encoding.UTF8.GetBytes(identity));
+                string entryName = BitConverter.ToString(hash).Replace("-", "").ToLowerInvariant();
+                return Path.Combine(directory, entryName + extension);
+            }
+        }
+
+        /// <summary>
+        /// Writes the entry and replaces any previous one.
+        /// The content goes to a temporary file first, so a concurrent reader never sees a partial entry.
+        /// The label identifies the entry in the log. Returns true if the entry was written.
+        /// </summary>
+        public bool Write(string entryPath, string label, Action<BinaryWriter> write)
+        {
+            string tempPath = entryPath + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            try
+            {
+                Directory.CreateDirectory(Path.GetDirectoryName(entryPath));
+
+                using (FileStream stream = new FileStream(tempPath, FileMode.Create, FileAccess.Write, FileShare.None, 65536))
+                using (BinaryWriter w = new BinaryWriter(stream))
+                    write(w);
+
+                if (File.Exists(entryPath))
+                    File.Replace(tempPath, entryPath, null);
+                else
+                    File.Move(tempPath, entryPath);
+
+                return true;
+            }
+            catch (Exception e)
+            {
+                log.DebugFormat("{0}: the entry for {1} could not be written. {2}", name, label, e.Message);
+
+                try
+                {
+                    if (File.Exists(tempPath))
+                        File.Delete(tempPath);
+                }
+                catch (IOException)
+                {
+                }
+
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Marks the entry as recently used.
+        /// </summary>
+        public void Touch(string entryPath)
+        {
+            try
+            {
+                File.SetLastWriteTimeUtc(entryPath, DateTime.UtcNow);
+            }
+            catch (Exception e)
+            {
+                log.DebugFormat("{0}: the entry {1} could not be touched. {2}", name, Path.GetFileName(entryPath), e.Message);
+            }
+        }
+
+        /// <summary>
+        /// Evicts the least recently used entries if the cache is over its size limit.
+        /// Goes down to three quarters of the limit so this doesn't run after every new entry.
+        /// </summary>
+        public void Trim()
+        {
+            string directory = GetDirectory();
+            if (directory == null || !Directory.Exists(directory))
+                return;
+
+            try
+            {
+                FileInfo[] entries = new DirectoryInfo(directory).GetFiles("*" + extension);
+                long total = entries.Sum(e => e.Length);
+                if (total <= maxBytes)
+                    return;
+
+                Array.Sort(entries, (a, b) => a.LastWriteTimeUtc.CompareTo(b.LastWriteTimeUtc));
+
+                int evicted = 0;
+                foreach (FileInfo entry in entries)
+                {
+                    if (total <= maxBytes / 4 * 3)
+                        break;
+
+                    try
+                    {
+                        long length = entry.Length;
+                        entry.Delete();
+                        total -= length;
+                        evicted++;
+                    }
+                    catch (IOException)
+                    {
+                    }
+                }
+
+                log.DebugFormat("{0}: evicted {1} entries.", name, evicted);
+            }
+            catch (Exception e)
+            {
+                log.DebugFormat("{0}: could not be trimmed. {1}", name, e.Message);
+            }
+        }
+
+        private string GetDirectory()
+        {
+            if (string.IsNullOrEmpty(Software.CacheDirectory))
+                return null;
+
+            return Path.Combine(Software.CacheDirectory, folder);
+        }
+    }
+}
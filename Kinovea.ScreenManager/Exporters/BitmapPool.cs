@@ -0,0 +1,85 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Threading;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// A fixed set of bitmaps recycled between the stages of an export.
+    /// Acquire blocks until another stage releases a bitmap, this is what bounds the number of frames in flight.
+    /// </summary>
+    public class BitmapPool : IDisposable
+    {
+        public int Capacity
+        {
+            get { return bitmaps.Count; }
+        }
+
+        private List<Bitmap> bitmaps = new List<Bitmap>();
+        private BlockingCollection<Bitmap> available;
+
+        public BitmapPool(int capacity, int width, int height, PixelFormat pixelFormat)
+        {
+            available = new BlockingCollection<Bitmap>(capacity);
+            for (int i = 0; i < capacity; i++)
+            {
+                Bitmap bitmap = new Bitmap(width, height, pixelFormat);
+                bitmaps.Add(bitmap);
+                available.Add(bitmap);
+            }
+        }
+
+        /// <summary>
+        /// Take a bitmap from the pool, waiting for one to be released if necessary.
+        /// Throws OperationCanceledException if the token is cancelled while waiting.
+        /// </summary>
+        public Bitmap Acquire(CancellationToken token)
+        {
+            return available.Take(token);
+        }
+
+        /// <summary>
+        /// Give a bitmap back to the pool. The content is not cleared.
+        /// </summary>
+        public void Release(Bitmap bitmap)
+        {
+            available.Add(bitmap);
+        }
+
+        /// <summary>
+        /// Dispose all the bitmaps, including those not released. 
+        /// Must only be called once the stages using the pool have stopped.
+        /// </summary>
+        public void Dispose()
+        {
+            available.Dispose();
+            foreach (Bitmap bitmap in bitmaps)
+                bitmap.Dispose();
+
+            bitmaps.Clear();
+        }
+    }
+}
@@ -0,0 +1,221 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Runtime.ExceptionServices;
+using System.Threading;
+
+using Kinovea.Services;
+using Kinovea.Video;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Pipelined export of the frames of a video: decode → render → caller.
+    /// Decoding and rendering of the annotations run on their own threads while the caller encodes or saves the previous images.
+    /// The stages exchange bitmaps from fixed pools through bounded queues so only a few frames are in flight at any time.
+    /// Rendering stays on a single thread and in order since it moves the trackable drawings along the timeline.
+    /// </summary>
+    public class ExportPipeline
+    {
+        /// <summary>
+        /// Number of frames waiting between two stages.
+        /// </summary>
+        public const int QueueCapacity = 2;
+
+        /// <summary>
+        /// Number of bitmaps owned by a stage: the queued ones, plus one in the producer and one in the consumer.
+        /// </summary>
+        public const int PoolCapacity = QueueCapacity + 2;
+
+        private class ExportFrame
+        {
+            public Bitmap Image;
+            public long Timestamp;
+            public int RepeatCount;
+        }
+
+        private IEnumerable<VideoFrame> frames;
+        private ImageRetriever imageRetriever;
+        private Func<bool, int> getRepeatCount;
+
+        private CancellationTokenSource cancellation;
+        private BlockingCollection<ExportFrame> decodedQueue;
+        private BlockingCollection<ExportFrame> renderedQueue;
+        private BitmapPool decodedPool;
+        private BitmapPool renderedPool;
+        private Exception stageError;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <summary>
+        /// frames: the source frames, enumerated on the decoding thread. Their images may be overwritten by the next frame.
+        /// imageRetriever: paints a frame and its annotations into an output bitmap, returns true if on a keyframe.
+        /// getRepeatCount: number of times each output image is yielded, based on whether it is on a keyframe.
+        /// </summary>
+        public ExportPipeline(IEnumerable<VideoFrame> frames, ImageRetriever imageRetriever, Func<bool, int> getRepeatCount)
+        {
+            this.frames = frames;
+            this.imageRetriever = imageRetriever;
+            this.getRepeatCount = getRepeatCount;
+        }
+
+        /// <summary>
+        /// Lazily enumerates the rendered images. The input timestamp is stored in the Tag of each bitmap.
+        /// A yielded bitmap is only valid until the next iteration, the caller should do its own copy if needed.
+        /// Stopping the enumeration early stops the pipeline.
+        /// An error in the decoding or rendering stage is rethrown at the end of the enumeration.
+        /// </summary>
+        public IEnumerable<Bitmap> Enumerate()
+        {
+            cancellation = new CancellationTokenSource();
+            stageError = null;
+            decodedQueue = new BlockingCollection<ExportFrame>(QueueCapacity);
+            renderedQueue = new BlockingCollection<ExportFrame>(QueueCapacity);
+
+            Thread decodeThread = new Thread(Decode) { IsBackground = true, Name = "ExportDecode" };
+            Thread renderThread = new Thread(Render) { IsBackground = true, Name = "ExportRender" };
+            decodeThread.Start();
+            renderThread.Start();
+
+            try
+            {
+                foreach (ExportFrame frame in renderedQueue.GetConsumingEnumerable())
+                {
+                    // Store the input timestamp in the bitmap, this may be used by the caller to build a file name for image exports.
+                    frame.Image.Tag = frame.Timestamp;
+
+                    for (int i = 0; i < frame.RepeatCount; i++)
+                        yield return frame.Image;
+
+                    renderedPool.Release(frame.Image);
+                }
+            }
+            finally
+            {
+                // Unblock the stages in case the caller stopped before the end.
+                cancellation.Cancel();
+                decodeThread.Join();
+                renderThread.Join();
+
+                if (decodedPool != null)
+                    decodedPool.Dispose();
+
+                if (renderedPool != null)
+                    renderedPool.Dispose();
+
+                decodedQueue.Dispose();
+                renderedQueue.Dispose();
+                cancellation.Dispose();
+            }
+
+            // Only reached when the caller consumed everything, the stages have joined at this point.
+            // A stage that failed has stopped the enumeration early, don't let the caller take it for a complete export.
+            if (stageError != null)
+                ExceptionDispatchInfo.Capture(stageError).Throw();
+        }
+
+        /// <summary>
+        /// Decoding stage. Copies each source frame into a bitmap of the pool, 
+        /// the reader is then free to decode the next frame into its own buffer.
+        /// </summary>
+        private void Decode()
+        {
+            CancellationToken token = cancellation.Token;
+            int count = 0;
+            try
+            {
+                foreach (VideoFrame vf in frames)
+                {
+                    if (vf == null)
+                    {
+                        log.Error("Working zone enumerator yield null.");
+                        break;
+                    }
+
+                    log.DebugFormat("Enumerated frame [{0}]: {1}", count, vf.Timestamp);
+                    count++;
+
+                    if (decodedPool == null)
+                        decodedPool = new BitmapPool(PoolCapacity, vf.Image.Width, vf.Image.Height, vf.Image.PixelFormat);
+
+                    Bitmap image = decodedPool.Acquire(token);
+                    BitmapHelper.Copy(vf.Image, image, new Rectangle(0, 0, image.Width, image.Height));
+                    decodedQueue.Add(new ExportFrame { Image = image, Timestamp = vf.Timestamp }, token);
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while decoding frames for export. {0}", e);
+                Interlocked.CompareExchange(ref stageError, e, null);
+            }
+            finally
+            {
+                decodedQueue.CompleteAdding();
+            }
+        }
+
+        /// <summary>
+        /// Rendering stage. Paints the frame and the annotations into a bitmap of the output pool.
+        /// </summary>
+        private void Render()
+        {
+            CancellationToken token = cancellation.Token;
+            try
+            {
+                foreach (ExportFrame decoded in decodedQueue.GetConsumingEnumerable(token))
+                {
+                    if (renderedPool == null)
+                        renderedPool = new BitmapPool(PoolCapacity, decoded.Image.Width, decoded.Image.Height, decoded.Image.PixelFormat);
+
+                    Bitmap output = renderedPool.Acquire(token);
+                    bool onKeyframe = imageRetriever(new VideoFrame(decoded.Timestamp, decoded.Image), output);
+                    decodedPool.Release(decoded.Image);
+
+                    ExportFrame rendered = new ExportFrame
+                    {
+                        Image = output,
+                        Timestamp = decoded.Timestamp,
+                        RepeatCount = getRepeatCount(onKeyframe)
+                    };
+
+                    renderedQueue.Add(rendered, token);
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while rendering frames for export. {0}", e);
+                Interlocked.CompareExchange(ref stageError, e, null);
+            }
+            finally
+            {
+                renderedQueue.CompleteAdding();
+            }
+        }
+    }
+}
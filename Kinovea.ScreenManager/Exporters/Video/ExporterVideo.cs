@@ -6,6 +6,8 @@ using System.Drawing;
 using System.Linq;
 using System.Text;
 using System.Threading.Tasks;
+using System.Windows.Forms;
+using Kinovea.ScreenManager.Languages;
 using Kinovea.Video;
 using Kinovea.Services;
 using Kinovea.Video.FFMpeg;
@@ -24,6 +26,8 @@ namespace Kinovea.ScreenManager
         private FormProgressBar formProgressBar = new FormProgressBar(true);
         private PlayerScreen player;
         private SaveResult saveResult;
+        private bool streamCopy;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         public ExporterVideo()
         {
@@ -40,6 +44,7 @@ namespace Kinovea.ScreenManager
         {
             // Setup global variables we'll use from inside the background thread.
             this.player = player;
+            streamCopy = PrepareStreamCopy(settings);
 
             // Start the background worker.
             formProgressBar.Reset();
@@ -61,16 +66,79 @@ namespace Kinovea.ScreenManager
 
             player.view.BeforeExportVideo();
 
-            // Get the image enumerator.
             player.FrameServer.VideoReader.BeforeFrameEnumeration();
+            string formatString = FilesystemHelper.GetFormatStringPlayback(s.File);
+
+            // Nothing to paint or transform: copy the compressed frames instead of decoding and re-encoding them.
+            if (streamCopy)
+            {
+                log.Debug("Exporting by copying the video stream.");
+                VideoReaderFFMpeg reader = player.FrameServer.VideoReader as VideoReaderFFMpeg;
+                saveResult = reader.CopySection(s, formatString, worker);
+                return;
+            }
+
+            // Get the image enumerator.
             IEnumerable<Bitmap> images = player.FrameServer.EnumerateImages(s);
 
             // Export loop.
             VideoFileWriter w = new VideoFileWriter();
-            string formatString = FilesystemHelper.GetFormatStringPlayback(s.File);
+            w.Encoder = PreferencesManager.PlayerPreferences.ExportEncoderSettings;
             saveResult = w.Save(s, player.FrameServer.VideoReader.Info, formatString, images, worker);
         }
 
+        /// <summary>
+        /// Whether to export by copying the compressed frames. This runs on the UI thread before the export starts.
+        /// The copy must start on a keyframe, and with B-frames end just before one. When the section doesn't fall
+        /// on these boundaries the user may extend it to them, otherwise the exact section is re-encoded.
+        /// </summary>
+        private bool PrepareStreamCopy(SavingSettings s)
+        {
+            VideoReaderFFMpeg reader = player.FrameServer.VideoReader as VideoReaderFFMpeg;
+            string formatString = FilesystemHelper.GetFormatStringPlayback(s.File);
+            if (reader == null || !CanCopyStream(s) || !reader.CanCopySection(s.Section, formatString))
+                return false;
+
+            VideoSection copySection = reader.GetCopySection(s.Section);
+            if (copySection == s.Section)
+                return true;
+
+            double interval = reader.Info.AverageTimeStampsPerFrame;
+            int before = (int)Math.Round((s.Section.Start - copySection.Start) / interval);
+            int after = (int)Math.Round((copySection.End - s.Section.End) / interval);
+            string text = string.Format(ScreenManagerLang.dlgExportCopyStream_Text, before, after);
+            DialogResult result = MessageBox.Show(text, ScreenManagerLang.dlgExportCopyStream_Title, MessageBoxButtons.YesNo, MessageBoxIcon.Question);
+            if (result != DialogResult.Yes)
+                return false;
+
+            log.DebugFormat("Section extended to the keyframes for the stream copy: {0}.", copySection);
+            s.Section = copySection;
+            s.TotalFrameCount += before + after;
+            return true;
+        }
+
+        /// <summary>
+        /// Whether the output would be the same frames as the input, at the original frame rate.
+        /// </summary>
+        private bool CanCopyStream(SavingSettings s)
+        {
+            Metadata metadata = player.FrameServer.Metadata;
+            VideoInfo info = player.FrameServer.VideoReader.Info;
+
+            bool sameFrames = !s.KeyframesOnly && !s.HasDuplicatedKeyframes && s.Duplication == 1 && s.InputIntervalTimestamps == 0;
+            bool sameFramerate = Math.Abs(s.OutputIntervalMilliseconds - info.FrameIntervalMilliseconds) < 0.001;
+            bool noAnnotations = !metadata.HasVisibleData;
+            bool noFilters = metadata.ActiveVideoFilterType == VideoFilterType.None &&
+                metadata.ImageAspect == ImageAspectRatio.Auto &&
+                metadata.ImageRotation == ImageRotation.Rotate0 &&
+                !metadata.Mirrored &&
+                metadata.Demosaicing == Demosaicing.None &&
+                !metadata.Deinterlacing &&
+                metadata.StabilizationTrack == Guid.Empty;
+
+            return sameFrames && sameFramerate && noAnnotations && noFilters;
+        }
+
         private void Worker_ProgressChanged(object sender, ProgressChangedEventArgs e)
         {
             // This runs in the UI thread.
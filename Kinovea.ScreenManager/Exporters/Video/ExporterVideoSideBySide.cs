@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Linq;
 using System.Text;
@@ -38,10 +39,16 @@ namespace Kinovea.ScreenManager
         private Stopwatch stopwatch = new Stopwatch();
 
         // Temporary variables filled for each output frame.
-        private Bitmap bmpComposite;
+        private Size compositeSize;
         private Bitmap bmpLeft;
         private Bitmap bmpRight;
 
+        // Composition runs ahead of encoding on its own thread.
+        private CancellationTokenSource cancellation;
+        private BlockingCollection<Bitmap> composedQueue;
+        private BitmapPool compositePool;
+        private Exception composeError;
+
         private VideoFileWriter videoFileWriter = new VideoFileWriter();
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
@@ -104,19 +111,16 @@ namespace Kinovea.ScreenManager
             // Prepare temporary bitmaps we'll use throughout.
             PrepareBitmaps();
 
-            // Get first frame outside the loop to set up the saving context.
-            long currentTime = 0;
-            PaintCompositeImage(currentTime);
-            
-            log.DebugFormat("Composite size: {0}.", bmpComposite.Size);
+            log.DebugFormat("Composite size: {0}.", compositeSize);
 
             VideoInfo info = new VideoInfo
             {
-                ReferenceSize = bmpComposite.Size
+                ReferenceSize = compositeSize
             };
 
             string formatString = FilesystemHelper.GetFormatStringPlayback(filePath);
 
+            videoFileWriter.Encoder = PreferencesManager.PlayerPreferences.ExportEncoderSettings;
             SaveResult result = videoFileWriter.OpenSavingContext(filePath, info, formatString, fileFrameInterval);
 
             if (result != SaveResult.Success)
@@ -125,25 +129,49 @@ namespace Kinovea.ScreenManager
                 return;
             }
 
-            videoFileWriter.SaveFrame(bmpComposite);
-            
-            while (currentTime < commonTimeline.LastTime && !cancelled)
+            // Paint the next composites while the current one is being encoded.
+            cancellation = new CancellationTokenSource();
+            composeError = null;
+            composedQueue = new BlockingCollection<Bitmap>(ExportPipeline.QueueCapacity);
+            compositePool = new BitmapPool(ExportPipeline.PoolCapacity, compositeSize.Width, compositeSize.Height, bmpLeft.PixelFormat);
+            Thread composeThread = new Thread(Compose) { IsBackground = true, Name = "ExportCompose" };
+            composeThread.Start();
+
+            try
             {
-                stopwatch.Restart();
+                foreach (Bitmap composite in composedQueue.GetConsumingEnumerable())
+                {
+                    stopwatch.Restart();
 
-                currentTime += commonTimeline.FrameTime;
+                    if (worker.CancellationPending)
+                    {
+                        threadResult = 1;
+                        cancelled = true;
+                        break;
+                    }
 
-                if (worker.CancellationPending)
-                {
-                    threadResult = 1;
-                    cancelled = true;
-                    break;
+                    long currentTime = (long)composite.Tag;
+                    videoFileWriter.SaveFrame(composite);
+                    compositePool.Release(composite);
+
+                    int percent = (int)((double)currentTime * 100 / commonTimeline.LastTime);
+                    worker.ReportProgress(percent);
                 }
+            }
+            finally
+            {
+                cancellation.Cancel();
+                composeThread.Join();
+                compositePool.Dispose();
+                composedQueue.Dispose();
+                cancellation.Dispose();
+            }
 
-                PaintCompositeImage(currentTime);
-                videoFileWriter.SaveFrame(bmpComposite);
-                int percent = (int)((double)currentTime * 100 / commonTimeline.LastTime);
-                worker.ReportProgress(percent);
+            // A failed composition ends the queue early, don't close the file as if it was complete.
+            if (composeError != null)
+            {
+                e.Result = 2;
+                return;
             }
 
             if (!cancelled)
@@ -152,6 +180,43 @@ namespace Kinovea.ScreenManager
             e.Result = threadResult;
         }
 
+        /// <summary>
+        /// Composition stage. Moves both players along the common timeline and paints the composites.
+        /// The time of the composite is stored in its Tag.
+        /// </summary>
+        private void Compose()
+        {
+            CancellationToken token = cancellation.Token;
+            try
+            {
+                long currentTime = 0;
+                while (true)
+                {
+                    Bitmap composite = compositePool.Acquire(token);
+                    PaintCompositeImage(currentTime, composite);
+                    composite.Tag = currentTime;
+                    composedQueue.Add(composite, token);
+
+                    if (currentTime >= commonTimeline.LastTime)
+                        break;
+
+                    currentTime += commonTimeline.FrameTime;
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while painting the composite images. {0}", e);
+                composeError = e;
+            }
+            finally
+            {
+                composedQueue.CompleteAdding();
+            }
+        }
+
         /// <summary>
         /// Create the temporary bitmaps we'll use to gather the frames and paint the composite.
         /// </summary>
@@ -159,14 +224,13 @@ namespace Kinovea.ScreenManager
         {
             Size sizeLeft = leftPlayer.FrameServer.VideoReader.Info.ReferenceSize;
             Size sizeRight = rightPlayer.FrameServer.VideoReader.Info.ReferenceSize;
-            Size sizeComp = ImageHelper.GetSideBySideCompositeSize(sizeLeft, sizeRight, true, merging, horizontal);
+            compositeSize = ImageHelper.GetSideBySideCompositeSize(sizeLeft, sizeRight, true, merging, horizontal);
 
             bmpLeft = new Bitmap(sizeLeft.Width, sizeLeft.Height, PixelFormat.Format24bppRgb);
             bmpRight = new Bitmap(sizeRight.Width, sizeRight.Height, PixelFormat.Format24bppRgb);
-            bmpComposite = new Bitmap(sizeComp.Width, sizeComp.Height, bmpLeft.PixelFormat);
         }
 
-        private void PaintCompositeImage(long currentTime)
+        private void PaintCompositeImage(long currentTime, Bitmap bmpComposite)
         {
             GotoTime(leftPlayer, currentTime);
             GotoTime(rightPlayer, currentTime);
@@ -180,8 +244,8 @@ namespace Kinovea.ScreenManager
             }
             else
             {
-                Graphics g = Graphics.FromImage(bmpComposite);
-                g.DrawImage(bmpLeft, Point.Empty);
+                using (Graphics g = Graphics.FromImage(bmpComposite))
+                    g.DrawImage(bmpLeft, Point.Empty);
             }
         }
 
@@ -204,7 +268,6 @@ namespace Kinovea.ScreenManager
         {
             bmpLeft.Dispose();
             bmpRight.Dispose();
-            bmpComposite.Dispose();
 
             formProgressBar.Close();
             formProgressBar.Dispose();
@@ -225,10 +288,19 @@ namespace Kinovea.ScreenManager
             try
             {
                 if (cancelled)
+                {
+                    log.Debug("Video saving cancelled.");
                     DeleteTemporaryFile(filePath);
+                }
 
                 if (!cancelled && (int)e.Result != 1 && videoFileWriter != null)
                     videoFileWriter.CloseSavingContext((int)e.Result == 0);
+
+                if (composeError != null)
+                {
+                    DeleteTemporaryFile(filePath);
+                    leftPlayer.FrameServer.ReportError(SaveResult.UnknownError);
+                }
             }
             catch (Exception exception)
             {
@@ -249,7 +321,7 @@ namespace Kinovea.ScreenManager
 
         private void DeleteTemporaryFile(string filename)
         {
-            log.Debug("Video saving cancelled. Deleting file.");
+            log.Debug("Deleting the partial video file.");
             if (!File.Exists(filename))
                 return;
 
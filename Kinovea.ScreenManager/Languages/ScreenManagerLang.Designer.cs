@@ -834,6 +834,26 @@ namespace Kinovea.ScreenManager.Languages {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to The section can be exported much faster without re-encoding if it is extended to the surrounding keyframes: {0} frames at the start and {1} frames at the end.
+        ///
+        ///Extend the section? Choose No to re-encode the exact section..
+        /// </summary>
+        public static string dlgExportCopyStream_Text {
+            get {
+                return ResourceManager.GetString("dlgExportCopyStream_Text", resourceCulture);
+            }
+        }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to Fast export.
+        /// </summary>
+        public static string dlgExportCopyStream_Title {
+            get {
+                return ResourceManager.GetString("dlgExportCopyStream_Title", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Save the data as a spreadsheet document.
         /// </summary>
@@ -4686,6 +4706,15 @@ namespace Kinovea.ScreenManager.Languages {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Coarse-to-fine search.
+        /// </summary>
+        public static string tracking_CoarseToFine {
+            get {
+                return ResourceManager.GetString("tracking_CoarseToFine", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Delete end of track.
         /// </summary>
@@ -4776,6 +4805,24 @@ namespace Kinovea.ScreenManager.Languages {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Track to the end of the working zone.
+        /// </summary>
+        public static string tracking_TrackWorkingZone {
+            get {
+                return ResourceManager.GetString("tracking_TrackWorkingZone", resourceCulture);
+            }
+        }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to An error occurred while tracking. The tracks were left unchanged..
+        /// </summary>
+        public static string tracking_TrackWorkingZoneError {
+            get {
+                return ResourceManager.GetString("tracking_TrackWorkingZoneError", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Annotation file name.
         /// </summary>
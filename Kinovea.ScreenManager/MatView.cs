@@ -0,0 +1,123 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Drawing;
+using System.Drawing.Imaging;
+using OpenCvSharp;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// An OpenCV Mat wrapping the pixels of a Bitmap in place, without copying them.
+    /// The bitmap stays locked for reading until the view is disposed, so views should be short lived.
+    /// The Mat has the same layout as the one returned by BitmapConverter.ToMat, formats that can't be wrapped are copied.
+    /// </summary>
+    public sealed class MatView : IDisposable
+    {
+        /// <summary>
+        /// The Mat header over the bitmap pixels. Must not be used after the view is disposed.
+        /// </summary>
+        public Mat Mat
+        {
+            get { return mat; }
+        }
+
+        private Bitmap bitmap;
+        private BitmapData bitmapData;
+        private Mat mat;
+
+        public MatView(Bitmap bitmap)
+        {
+            MatType type;
+            if (!TryGetMatType(bitmap.PixelFormat, out type))
+            {
+                mat = OpenCvSharp.Extensions.BitmapConverter.ToMat(bitmap);
+                return;
+            }
+
+            // Locking a bitmap in its own pixel format gives access to its memory directly.
+            Rectangle rect = new Rectangle(0, 0, bitmap.Width, bitmap.Height);
+            BitmapData data = bitmap.LockBits(rect, ImageLockMode.ReadOnly, bitmap.PixelFormat);
+            if (data.Stride < 0)
+            {
+                // Bottom-up bitmap, OpenCV needs the rows in increasing addresses.
+                bitmap.UnlockBits(data);
+                mat = OpenCvSharp.Extensions.BitmapConverter.ToMat(bitmap);
+                return;
+            }
+
+            this.bitmap = bitmap;
+            this.bitmapData = data;
+            mat = new Mat(bitmap.Height, bitmap.Width, type, data.Scan0, data.Stride);
+        }
+
+        /// <summary>
+        /// Returns a new grayscale Mat of the bitmap, converted straight from the bitmap pixels.
+        /// </summary>
+        public static Mat ToGray(Bitmap bitmap)
+        {
+            using (MatView view = new MatView(bitmap))
+            {
+                Mat gray = new Mat();
+                if (view.Mat.Channels() == 1)
+                    view.Mat.CopyTo(gray);
+                else
+                    Cv2.CvtColor(view.Mat, gray, ColorConversionCodes.BGR2GRAY, 0);
+
+                return gray;
+            }
+        }
+
+        public void Dispose()
+        {
+            if (mat != null)
+            {
+                mat.Dispose();
+                mat = null;
+            }
+
+            if (bitmapData != null)
+            {
+                bitmap.UnlockBits(bitmapData);
+                bitmapData = null;
+                bitmap = null;
+            }
+        }
+
+        private static bool TryGetMatType(PixelFormat format, out MatType type)
+        {
+            // Only the formats whose memory layout is the one BitmapConverter.ToMat produces.
+            switch (format)
+            {
+                case PixelFormat.Format24bppRgb:
+                    type = MatType.CV_8UC3;
+                    return true;
+                case PixelFormat.Format32bppArgb:
+                case PixelFormat.Format32bppPArgb:
+                    type = MatType.CV_8UC4;
+                    return true;
+                default:
+                    type = MatType.CV_8UC1;
+                    return false;
+            }
+        }
+    }
+}
@@ -0,0 +1,407 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Disk cache of the features, descriptors and raw matches computed by the camera motion estimation.
+    /// There is one entry per video file, feature type, number of features per frame, mask and image size.
+    /// Frames are stored by timestamp so any working zone inside the cached one is a hit, and only the missing frames are computed.
+    /// Each frame carries a fingerprint of its pixels, frames that changed (image filters, rotation) are not reused.
+    /// The total size is bounded, the least recently used entries are evicted first. Errors are logged and treated as cache misses.
+    /// </summary>
+    public static class CameraFeatureCache
+    {
+        /// <summary>
+        /// Identity of an entry.
+        /// </summary>
+        public class Key
+        {
+            public string Path;
+            public long Length;
+            public long LastWriteTicks;
+            public CameraMotionFeatureType FeatureType;
+            public int FeaturesPerFrame;
+            public int MaskHash;
+            public Size ImageSize;
+        }
+
+        /// <summary>
+        /// Raw matches from a frame to the next one, before the distance threshold filter.
+        /// </summary>
+        public class PairMatches
+        {
+            public long Next;
+            public OpenCvSharp.DMatch[] Matches;
+        }
+
+        /// <summary>
+        /// Content of an entry. The lists are indexed by frame.
+        /// Matches are keyed on the timestamp of their first frame, they are only valid for the matching mode they were computed with.
+        /// </summary>
+        public class Entry
+        {
+            public List<long> Timestamps = new List<long>();
+            public List<int> Fingerprints = new List<int>();
+            public List<OpenCvSharp.KeyPoint[]> Keypoints = new List<OpenCvSharp.KeyPoint[]>();
+            public List<OpenCvSharp.Mat> Descriptors = new List<OpenCvSharp.Mat>();
+            public bool RatioTest;
+            public Dictionary<long, PairMatches> Matches = new Dictionary<long, PairMatches>();
+        }
+
+        private const int magic = 0x4643564B; // "KVCF"
+        private const int version = 1;
+        private const long maxCacheBytes = 1024L * 1024 * 1024;
+        private const string extension = ".kcf";
+        private const int fingerprintGrid = 16;
+        private static readonly DiskCache cache = new DiskCache("Camera feature cache", "CameraMotion", extension, maxCacheBytes);
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <summary>
+        /// Returns the key for the video file and settings, or null if the file is not available.
+        /// </summary>
+        public static Key GetKey(string path, CameraMotionFeatureType featureType, int featuresPerFrame, int maskHash, Size imageSize)
+        {
+            if (string.IsNullOrEmpty(path) || !File.Exists(path))
+                return null;
+
+            FileInfo file = new FileInfo(path);
+            return new Key()
+            {
+                Path = file.FullName,
+                Length = file.Length,
+                LastWriteTicks = file.LastWriteTimeUtc.Ticks,
+                FeatureType = featureType,
+                FeaturesPerFrame = featuresPerFrame,
+                MaskHash = maskHash,
+                ImageSize = imageSize
+            };
+        }
+
+        /// <summary>
+        /// Returns the cached entry, or null if there is no valid entry for this key.
+        /// The caller owns the descriptors.
+        /// </summary>
+        public static Entry Load(Key key)
+        {
+            string entryPath = GetEntryPath(key);
+            if (entryPath == null || !File.Exists(entryPath))
+                return null;
+
+            Entry entry = new Entry();
+            try
+            {
+                using (FileStream stream = new FileStream(entryPath, FileMode.Open, FileAccess.Read, FileShare.Read))
+                using (BinaryReader r = new BinaryReader(stream))
+                {
+                    if (r.ReadInt32() != magic || r.ReadInt32() != version)
+                        return null;
+
+                    bool match = string.Equals(r.ReadString(), key.Path, StringComparison.OrdinalIgnoreCase) &&
+                        r.ReadInt64() == key.Length &&
+                        r.ReadInt64() == key.LastWriteTicks &&
+                        r.ReadInt32() == (int)key.FeatureType &&
+                        r.ReadInt32() == key.FeaturesPerFrame &&
+                        r.ReadInt32() == key.MaskHash &&
+                        r.ReadInt32() == key.ImageSize.Width &&
+                        r.ReadInt32() == key.ImageSize.Height;
+
+                    if (!match)
+                        return null;
+
+                    int count = r.ReadInt32();
+                    for (int i = 0; i < count; i++)
+                    {
+                        entry.Timestamps.Add(r.ReadInt64());
+                        entry.Fingerprints.Add(r.ReadInt32());
+                        entry.Keypoints.Add(ReadKeypoints(r));
+                        entry.Descriptors.Add(ReadDescriptors(r));
+                    }
+
+                    entry.RatioTest = r.ReadBoolean();
+                    int pairs = r.ReadInt32();
+                    for (int i = 0; i < pairs; i++)
+                    {
+                        long timestamp = r.ReadInt64();
+                        PairMatches pm = new PairMatches();
+                        pm.Next = r.ReadInt64();
+                        pm.Matches = ReadMatches(r);
+                        entry.Matches[timestamp] = pm;
+                    }
+                }
+
+                cache.Touch(entryPath);
+                return entry;
+            }
+            catch (Exception e)
+            {
+                log.DebugFormat("Camera feature cache: the entry for {0} could not be read. {1}", Path.GetFileName(key.Path), e.Message);
+                entry.Descriptors.ForEach(d => d.Dispose());
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// Stores the entry, replacing any previous entry for this key.
+        /// Returns true if an entry was written.
+        /// </summary>
+        public static bool Save(Key key, Entry entry)
+        {
+            if (entry == null || entry.Timestamps.Count == 0)
+                return false;
+
+            string entryPath = GetEntryPath(key);
+            if (entryPath == null)
+                return false;
+
+            return cache.Write(entryPath, Path.GetFileName(key.Path), w =>
+            {
+                w.Write(magic);
+                w.Write(version);
+                w.Write(key.Path);
+                w.Write(key.Length);
+                w.Write(key.LastWriteTicks);
+                w.Write((int)key.FeatureType);
+                w.Write(key.FeaturesPerFrame);
+                w.Write(key.MaskHash);
+                w.Write(key.ImageSize.Width);
+                w.Write(key.ImageSize.Height);
+
+                w.Write(entry.Timestamps.Count);
+                for (int i = 0; i < entry.Timestamps.Count; i++)
+                {
+                    w.Write(entry.Timestamps[i]);
+                    w.Write(entry.Fingerprints[i]);
+                    WriteKeypoints(w, entry.Keypoints[i]);
+                    WriteDescriptors(w, entry.Descriptors[i]);
+                }
+
+                w.Write(entry.RatioTest);
+                w.Write(entry.Matches.Count);
+                foreach (var pair in entry.Matches)
+                {
+                    w.Write(pair.Key);
+                    w.Write(pair.Value.Next);
+                    WriteMatches(w, pair.Value.Matches);
+                }
+            });
+        }
+
+        /// <summary>
+        /// Evicts the least recently used entries if the cache is over its size limit.
+        /// </summary>
+        public static void Trim()
+        {
+            cache.Trim();
+        }
+
+        /// <summary>
+        /// Hash of a sparse grid of pixels, to detect frames whose content is not the one the features were computed on.
+        /// </summary>
+        public static int Fingerprint(Bitmap image)
+        {
+            int bytesPerPixel = Image.GetPixelFormatSize(image.PixelFormat) / 8;
+            if (bytesPerPixel == 0)
+                return 0;
+
+            Rectangle rect = new Rectangle(0, 0, image.Width, image.Height);
+            BitmapData data = image.LockBits(rect, ImageLockMode.ReadOnly, image.PixelFormat);
+            uint hash = 2166136261;
+            try
+            {
+                for (int gy = 0; gy < fingerprintGrid; gy++)
+                {
+                    int y = (image.Height - 1) * gy / (fingerprintGrid - 1);
+                    for (int gx = 0; gx < fingerprintGrid; gx++)
+                    {
+                        int x = (image.Width - 1) * gx / (fingerprintGrid - 1);
+                        IntPtr pixel = data.Scan0 + y * data.Stride + x * bytesPerPixel;
+                        for (int b = 0; b < bytesPerPixel; b++)
+                            hash = (hash ^ Marshal.ReadByte(pixel, b)) * 16777619;
+                    }
+                }
+            }
+            finally
+            {
+                image.UnlockBits(data);
+            }
+
+            return (int)hash;
+        }
+
+        /// <summary>
+        /// Hash of all the pixels of the mask, zero if there is no mask.
+        /// </summary>
+        public static int HashMask(Bitmap mask)
+        {
+            if (mask == null)
+                return 0;
+
+            Rectangle rect = new Rectangle(0, 0, mask.Width, mask.Height);
+            BitmapData data = mask.LockBits(rect, ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
+            uint hash = 2166136261;
+            try
+            {
+                byte[] row = new byte[mask.Width * 4];
+                for (int y = 0; y < mask.Height; y++)
+                {
+                    Marshal.Copy(data.Scan0 + y * data.Stride, row, 0, row.Length);
+                    for (int i = 0; i < row.Length; i++)
+                        hash = (hash ^ row[i]) * 16777619;
+                }
+            }
+            finally
+            {
+                mask.UnlockBits(data);
+            }
+
+            // Zero is reserved for no mask.
+            return hash == 0 ? 1 : (int)hash;
+        }
+
+        private static void WriteKeypoints(BinaryWriter w, OpenCvSharp.KeyPoint[] keypoints)
+        {
+            w.Write(keypoints.Length);
+            foreach (var kp in keypoints)
+            {
+                w.Write(kp.Pt.X);
+                w.Write(kp.Pt.Y);
+                w.Write(kp.Size);
+                w.Write(kp.Angle);
+                w.Write(kp.Response);
+                w.Write(kp.Octave);
+                w.Write(kp.ClassId);
+            }
+        }
+
+        private static OpenCvSharp.KeyPoint[] ReadKeypoints(BinaryReader r)
+        {
+            int count = r.ReadInt32();
+            var keypoints = new OpenCvSharp.KeyPoint[count];
+            for (int i = 0; i < count; i++)
+            {
+                var pt = new OpenCvSharp.Point2f(r.ReadSingle(), r.ReadSingle());
+                float size = r.ReadSingle();
+                float angle = r.ReadSingle();
+                float response = r.ReadSingle();
+                int octave = r.ReadInt32();
+                int classId = r.ReadInt32();
+                keypoints[i] = new OpenCvSharp.KeyPoint(pt, size, angle, response, octave, classId);
+            }
+
+            return keypoints;
+        }
+
+        private static void WriteDescriptors(BinaryWriter w, OpenCvSharp.Mat descriptors)
+        {
+            int rows = descriptors.Rows;
+            int cols = descriptors.Cols;
+            int type = descriptors.Type();
+            w.Write(rows);
+            w.Write(cols);
+            w.Write(type);
+            if (rows == 0 || cols == 0)
+                return;
+
+            OpenCvSharp.Mat continuous = descriptors.IsContinuous() ? descriptors : descriptors.Clone();
+            int count = rows * cols;
+            bool packed = false;
+            if (type == (int)OpenCvSharp.MatType.CV_32FC1)
+            {
+                // SIFT descriptors are floats but their values are whole numbers in 0..255, store them as bytes.
+                float[] values = new float[count];
+                Marshal.Copy(continuous.Data, values, 0, count);
+                packed = values.All(v => v >= 0 && v <= 255 && v == Math.Floor(v));
+                w.Write(packed);
+                if (packed)
+                    w.Write(values.Select(v => (byte)v).ToArray());
+            }
+            else
+            {
+                w.Write(packed);
+            }
+
+            if (!packed)
+            {
+                byte[] bytes = new byte[count * (int)continuous.ElemSize()];
+                Marshal.Copy(continuous.Data, bytes, 0, bytes.Length);
+                w.Write(bytes);
+            }
+
+            if (continuous != descriptors)
+                continuous.Dispose();
+        }
+
+        private static OpenCvSharp.Mat ReadDescriptors(BinaryReader r)
+        {
+            int rows = r.ReadInt32();
+            int cols = r.ReadInt32();
+            int type = r.ReadInt32();
+            if (rows == 0 || cols == 0)
+                return new OpenCvSharp.Mat();
+
+            OpenCvSharp.Mat descriptors = new OpenCvSharp.Mat(rows, cols, (OpenCvSharp.MatType)type);
+            int count = rows * cols;
+            bool packed = r.ReadBoolean();
+            if (packed)
+            {
+                byte[] bytes = ReadExactly(r, count);
+                float[] values = bytes.Select(b => (float)b).ToArray();
+                Marshal.Copy(values, 0, descriptors.Data, count);
+            }
+            else
+            {
+                byte[] bytes = ReadExactly(r, count * (int)descriptors.ElemSize());
+                Marshal.Copy(bytes, 0, descriptors.Data, bytes.Length);
+            }
+
+            return descriptors;
+        }
+
+        private static void WriteMatches(BinaryWriter w, OpenCvSharp.DMatch[] matches)
+        {
+            w.Write(matches.Length);
+            foreach (var m in matches)
+            {
+                w.Write(m.QueryIdx);
+                w.Write(m.TrainIdx);
+                w.Write(m.ImgIdx);
+                w.Write(m.Distance);
+            }
+        }
+
+        private static OpenCvSharp.DMatch[] ReadMatches(BinaryReader r)
+        {
+            int count = r.ReadInt32();
+            var matches = new OpenCvSharp.DMatch[count];
+            for (int i = 0; i < count; i++)
+                matches[i] = new OpenCvSharp.DMatch(r.ReadInt32(), r.ReadInt32(), r.ReadInt32(), r.ReadSingle());
+
+            return matches;
+        }
+
+        private static byte[] ReadExactly(BinaryReader r, int length)
+        {
+            byte[] bytes = r.ReadBytes(length);
+            if (bytes.Length != length)
+                throw new EndOfStreamException();
+
+            return bytes;
+        }
+
+        private static string GetEntryPath(Key key)
+        {
+            if (key == null)
+                return null;
+
+            // Entries are named after a hash of the full path and the settings. Paths are case insensitive on Windows.
+            string identity = string.Format("{0}|{1}|{2}|{3}|{4}x{5}", key.Path.ToUpperInvariant(), key.FeatureType, key.FeaturesPerFrame, key.MaskHash, key.ImageSize.Width, key.ImageSize.Height);
+            return cache.GetEntryPath(identity);
+        }
+    }
+}
@@ -48,6 +48,26 @@ namespace Kinovea.ScreenManager
         /// Includes intrinsic parameters and rotation matrix.
         /// </summary>
         public List<OpenCvSharp.Detail.CameraParams> CameraParams { get { return cameraParams; } }
+
+        /// <summary>
+        /// Maximum number of threads used for feature detection and matching.
+        /// Zero or negative to use all the cores.
+        /// </summary>
+        public int MaxDegreeOfParallelism
+        {
+            get { return maxDegreeOfParallelism; }
+            set { maxDegreeOfParallelism = value; }
+        }
+
+        /// <summary>
+        /// Path of the video file the frames come from.
+        /// Identifies the entries of the feature cache, null to disable the cache.
+        /// </summary>
+        public string VideoPath
+        {
+            get { return videoPath; }
+            set { videoPath = value; }
+        }
         #endregion
 
         #region Members
@@ -82,6 +102,18 @@ namespace Kinovea.ScreenManager
 
         // Core parameters
         private CameraMotionParameters parameters;
+        private int maxDegreeOfParallelism = 0;
+
+        // Feature cache.
+        // fingerprints: fingerprint of the image of each frame, parallel to timestamps.
+        // rawMatches: matches before the distance threshold filter, keyed on the timestamp of the first frame of the pair.
+        // cacheDirty: features or matches were computed since the last save.
+        private string videoPath;
+        private CameraFeatureCache.Key cacheKey;
+        private List<int> fingerprints = new List<int>();
+        private Dictionary<long, CameraFeatureCache.PairMatches> rawMatches = new Dictionary<long, CameraFeatureCache.PairMatches>();
+        private bool rawMatchesRatioTest;
+        private bool cacheDirty;
 
         private Stopwatch stopwatch = new Stopwatch();
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
@@ -147,14 +179,16 @@ namespace Kinovea.ScreenManager
             // In "Image Matching across Wide Baselines: From Paper to Practice",  2K features is considered
             // low budget and 8K features is high budget.
             // - Type of features (SIFT, ORB, AKAZE, etc.)
-
-            // TODO: try to run this through a parallel-for if possible.
-            // Do we need frameIndices, keypoints and descriptors to be sequential?
-            // If so, prepare all the tables without the detection and then run the detection in parallel.
+            //
+            // The tables are prepared sequentially and only the detection runs in parallel.
+            // Each thread has its own detector instance.
+            //
+            // Features of frames found in the cache are reused, only the missing frames are computed.
 
             stopwatch.Restart();
             frameIndices.Clear();
             timestamps.Clear();
+            fingerprints.Clear();
             keypoints.Clear();
             descriptors.Clear();
 
@@ -171,62 +205,79 @@ namespace Kinovea.ScreenManager
                 log.DebugFormat("Imported mask. {0} ms.", stopwatch.ElapsedMilliseconds);
             }
 
-            OpenCvSharp.ORB orb = null;
-            OpenCvSharp.Features2D.SIFT sift = null;
-
             int featuresPerFrame = Math.Max(100, parameters.FeaturesPerFrame);
 
-            if (parameters.FeatureType == CameraMotionFeatureType.ORB)
-                orb = OpenCvSharp.ORB.Create(featuresPerFrame);
-            else
-                sift = OpenCvSharp.Features2D.SIFT.Create(featuresPerFrame);
-
-            int frameIndex = 0;
-            for (int i = 0; i < framesContainer.Frames.Count; i++)
+            // Frames to process, in order, without duplicate timestamps.
+            List<VideoFrame> frames = new List<VideoFrame>();
+            foreach (var f in framesContainer.Frames)
             {
-                if (worker.CancellationPending)
-                    break;
-
-                var f = framesContainer.Frames[i];
                 if (frameIndices.ContainsKey(f.Timestamp))
                     continue;
 
-                frameIndices.Add(f.Timestamp, frameIndex);
+                frameIndices.Add(f.Timestamp, frames.Count);
                 timestamps.Add(f.Timestamp);
+                fingerprints.Add(CameraFeatureCache.Fingerprint(f.Image));
+                frames.Add(f);
+            }
 
-                // Convert image to OpenCV and convert to grayscale.
-                var cvImage = OpenCvSharp.Extensions.BitmapConverter.ToMat(f.Image);
-                var cvImageGray = new OpenCvSharp.Mat();
-                OpenCvSharp.Cv2.CvtColor(cvImage, cvImageGray, OpenCvSharp.ColorConversionCodes.BGR2GRAY, 0);
-                cvImage.Dispose();
-
-                // Feature detection & description.
-                var desc = new OpenCvSharp.Mat();
-                OpenCvSharp.KeyPoint[] kp;
-                if (parameters.FeatureType == CameraMotionFeatureType.ORB)
-                    orb.DetectAndCompute(cvImageGray, cvMaskGray, out kp, desc);
-                else
-                    sift.DetectAndCompute(cvImageGray, cvMaskGray, out kp, desc);
+            var frameKeypoints = new OpenCvSharp.KeyPoint[frames.Count][];
+            var frameDescriptors = new OpenCvSharp.Mat[frames.Count];
+            List<int> missing = LoadCachedFeatures(frames, featuresPerFrame, frameKeypoints, frameDescriptors);
+
+            PartitionedExecutor.Run(missing.Count, maxDegreeOfParallelism,
+                () => CreateDetector(featuresPerFrame),
+                (j, detector) =>
+                {
+                    int i = missing[j];
 
-                keypoints.Add(kp);
-                descriptors.Add(desc);
+                    // Convert image to grayscale, straight from the frame pixels.
+                    var cvImageGray = MatView.ToGray(frames[i].Image);
 
-                cvImageGray.Dispose();
+                    // Feature detection & description.
+                    var desc = new OpenCvSharp.Mat();
+                    OpenCvSharp.KeyPoint[] kp;
+                    detector.DetectAndCompute(cvImageGray, cvMaskGray, out kp, desc);
 
-                //log.DebugFormat("Feature detection - Frame [{0}]: {1} features.", keypoints.Count, keypoints[keypoints.Count - 1].Length);
-                frameIndex++;
-                worker.ReportProgress(i + 1, framesContainer.Frames.Count);
+                    frameKeypoints[i] = kp;
+                    frameDescriptors[i] = desc;
+
+                    cvImageGray.Dispose();
+                },
+                worker);
+
+            // After a cancellation only keep the frames from the start without gaps, as if the process had run sequentially.
+            int completed = 0;
+            while (completed < frames.Count && frameDescriptors[completed] != null)
+                completed++;
+
+            for (int i = 0; i < frames.Count; i++)
+            {
+                if (i < completed)
+                {
+                    keypoints.Add(frameKeypoints[i]);
+                    descriptors.Add(frameDescriptors[i]);
+                }
+                else
+                {
+                    frameIndices.Remove(timestamps[i]);
+                    if (frameDescriptors[i] != null)
+                        frameDescriptors[i].Dispose();
+                }
             }
 
-            if (parameters.FeatureType == CameraMotionFeatureType.ORB)
-                orb.Dispose();
-             else
-                sift.Dispose();
+            if (completed < timestamps.Count)
+            {
+                timestamps.RemoveRange(completed, timestamps.Count - completed);
+                fingerprints.RemoveRange(completed, fingerprints.Count - completed);
+            }
 
             if (hasMask)
                 cvMaskGray.Dispose();
 
-            log.DebugFormat("Feature detection: {0} ms.", stopwatch.ElapsedMilliseconds);
+            log.DebugFormat("Feature detection: {0} frames, {1} from cache, {2} ms.", completed, frames.Count - missing.Count, stopwatch.ElapsedMilliseconds);
+
+            if (missing.Any(i => i < completed))
+                cacheDirty = true;
         }
 
         /// <summary>
@@ -263,50 +314,75 @@ namespace Kinovea.ScreenManager
             matches.Clear();
             List<OpenCvSharp.DMatch[]> framesMatches = new List<OpenCvSharp.DMatch[]>();
 
-            // Matching distance: SIFT requires L1 norm.
-            OpenCvSharp.BFMatcher matcher = null;
-            if (parameters.FeatureType == CameraMotionFeatureType.ORB)
-                matcher = new OpenCvSharp.BFMatcher(OpenCvSharp.NormTypes.Hamming, crossCheck: crossCheck);
-            else
-                matcher = new OpenCvSharp.BFMatcher(OpenCvSharp.NormTypes.L1, crossCheck: crossCheck);
+            // Raw matches from the cache or from a previous run are only valid for the same matching strategy.
+            if (rawMatchesRatioTest != parameters.UseDistanceRatioTest)
+            {
+                rawMatches.Clear();
+                rawMatchesRatioTest = parameters.UseDistanceRatioTest;
+            }
 
-            for (int i = 0; i < descriptors.Count - 1; i++)
+            int pairs = descriptors.Count - 1;
+            var pairsMatches = new OpenCvSharp.DMatch[pairs][];
+            List<int> missing = new List<int>();
+            for (int i = 0; i < pairs; i++)
             {
-                if (worker.CancellationPending)
-                    break;
+                CameraFeatureCache.PairMatches pm;
+                if (rawMatches.TryGetValue(timestamps[i], out pm) && pm.Next == timestamps[i + 1])
+                    pairsMatches[i] = pm.Matches;
+                else
+                    missing.Add(i);
+            }
 
-                if (parameters.UseDistanceRatioTest)
+            // Frame pairs are independent, each thread has its own matcher.
+            PartitionedExecutor.Run(missing.Count, maxDegreeOfParallelism,
+                () => CreateMatcher(crossCheck),
+                (j, matcher) =>
                 {
-                    var mm = matcher.KnnMatch(descriptors[i], descriptors[i + 1], 2);
-
-                    // Lowe's ratio test.
-                    List<OpenCvSharp.DMatch> keepers = new List<OpenCvSharp.DMatch>();
-                    foreach (var matches in mm)
+                    int i = missing[j];
+                    if (parameters.UseDistanceRatioTest)
                     {
-                        if (matches.Count() < 2)
-                            continue;
+                        var mm = matcher.KnnMatch(descriptors[i], descriptors[i + 1], 2);
 
-                        // Accept the match only if the nearest neighbor is much closer than
-                        // the second nearest neighbor.
-                        if (matches[0].Distance < (1.0f - r) * matches[1].Distance)
+                        // Lowe's ratio test.
+                        List<OpenCvSharp.DMatch> keepers = new List<OpenCvSharp.DMatch>();
+                        foreach (var matches in mm)
                         {
-                            keepers.Add(matches[0]);
+                            if (matches.Count() < 2)
+                                continue;
+
+                            // Accept the match only if the nearest neighbor is much closer than
+                            // the second nearest neighbor.
+                            if (matches[0].Distance < (1.0f - r) * matches[1].Distance)
+                            {
+                                keepers.Add(matches[0]);
+                            }
                         }
+
+                        pairsMatches[i] = keepers.ToArray();
+                    }
+                    else
+                    {
+                        pairsMatches[i] = matcher.Match(descriptors[i], descriptors[i + 1]);
                     }
+                },
+                worker);
 
-                    framesMatches.Add(keepers.ToArray());
-                }
-                else
+            int completed = 0;
+            while (completed < pairs && pairsMatches[completed] != null)
+                completed++;
+
+            for (int i = 0; i < completed; i++)
+                framesMatches.Add(pairsMatches[i]);
+
+            foreach (int i in missing)
+            {
+                if (pairsMatches[i] != null)
                 {
-                    OpenCvSharp.DMatch[] mm = matcher.Match(descriptors[i], descriptors[i + 1]);
-                    framesMatches.Add(mm);
+                    rawMatches[timestamps[i]] = new CameraFeatureCache.PairMatches() { Next = timestamps[i + 1], Matches = pairsMatches[i] };
+                    cacheDirty = true;
                 }
-
-                worker.ReportProgress(i + 1, descriptors.Count - 1);
             }
 
-            matcher.Dispose();
-
             if (parameters.UseDistanceThreshold)
             {
                 // We know we are tracking a video frame by frame so we can assume the motion vectors to be
@@ -314,7 +390,7 @@ namespace Kinovea.ScreenManager
                 // This will make the job of RANSAC easier.
                 Size imageSize = framesContainer.Frames[0].Image.Size;
                 float distanceThreshold = imageSize.Width * parameters.DistanceThresholdNormalized;
-                for (int i = 0; i < descriptors.Count - 1; i++)
+                for (int i = 0; i < framesMatches.Count; i++)
                 {
                     var srcPoints = framesMatches[i].Select(m => new OpenCvSharp.Point2d(keypoints[i][m.QueryIdx].Pt.X, keypoints[i][m.QueryIdx].Pt.Y)).ToList();
                     var dstPoints = framesMatches[i].Select(m => new OpenCvSharp.Point2d(keypoints[i + 1][m.TrainIdx].Pt.X, keypoints[i + 1][m.TrainIdx].Pt.Y)).ToList();
@@ -327,7 +403,7 @@ namespace Kinovea.ScreenManager
                 matches = framesMatches;
             }
 
-            log.DebugFormat("Feature matching: {0} ms.", stopwatch.ElapsedMilliseconds);
+            log.DebugFormat("Feature matching: {0} pairs, {1} from cache, {2} ms.", completed, pairs - missing.Count, stopwatch.ElapsedMilliseconds);
         }
 
         /// <summary>
@@ -643,11 +719,13 @@ namespace Kinovea.ScreenManager
             FindFeatures(framesContainer, worker);
             if (worker.CancellationPending)
             {
+                SaveCache();
                 log.DebugFormat(cancellationText);
                 return;
             }
 
             MatchFeatures(framesContainer, worker);
+            SaveCache();
             if (worker.CancellationPending)
             {
                 log.DebugFormat(cancellationText);
@@ -835,9 +913,12 @@ namespace Kinovea.ScreenManager
             
             frameIndices.Clear();
             timestamps.Clear();
+            fingerprints.Clear();
             keypoints.Clear();
             descriptors.Clear();
             matches.Clear();
+            rawMatches.Clear();
+            cacheDirty = false;
             inlierStatus.Clear();
             inliers.Clear();
             consecTransforms.Clear();
@@ -1024,9 +1105,152 @@ namespace Kinovea.ScreenManager
                 consecTransforms.Add(homography);
             }
         }
+
+        /// <summary>
+        /// Write the features and raw matches computed since the last save to the cache.
+        /// The existing entry is merged in, so frames cached from a wider working zone are kept.
+        /// </summary>
+        public void SaveCache()
+        {
+            if (!cacheDirty || cacheKey == null || timestamps.Count == 0 || keypoints.Count != timestamps.Count)
+                return;
+
+            cacheDirty = false;
+            Stopwatch saveStopwatch = Stopwatch.StartNew();
+            CameraFeatureCache.Entry entry = new CameraFeatureCache.Entry();
+            entry.Timestamps.AddRange(timestamps);
+            entry.Fingerprints.AddRange(fingerprints);
+            entry.Keypoints.AddRange(keypoints);
+            entry.Descriptors.AddRange(descriptors);
+            entry.RatioTest = rawMatchesRatioTest;
+            foreach (var pair in rawMatches)
+                entry.Matches.Add(pair.Key, pair.Value);
+
+            // Frames of the current run replace the cached ones, cached matches are only kept between frames that were not replaced.
+            int kept = 0;
+            CameraFeatureCache.Entry previous = CameraFeatureCache.Load(cacheKey);
+            if (previous != null)
+            {
+                HashSet<long> current = new HashSet<long>(timestamps);
+                for (int i = 0; i < previous.Timestamps.Count; i++)
+                {
+                    if (current.Contains(previous.Timestamps[i]))
+                        continue;
+
+                    entry.Timestamps.Add(previous.Timestamps[i]);
+                    entry.Fingerprints.Add(previous.Fingerprints[i]);
+                    entry.Keypoints.Add(previous.Keypoints[i]);
+                    entry.Descriptors.Add(previous.Descriptors[i]);
+                    kept++;
+                }
+
+                if (previous.RatioTest == rawMatchesRatioTest)
+                {
+                    foreach (var pair in previous.Matches)
+                    {
+                        if (!current.Contains(pair.Key) && !current.Contains(pair.Value.Next))
+                            entry.Matches[pair.Key] = pair.Value;
+                    }
+                }
+            }
+
+            if (CameraFeatureCache.Save(cacheKey, entry))
+            {
+                log.DebugFormat("Feature cache: saved {0} frames and {1} pairs, {2} frames kept from the previous entry. {3} ms.",
+                    entry.Timestamps.Count, entry.Matches.Count, kept, saveStopwatch.ElapsedMilliseconds);
+                CameraFeatureCache.Trim();
+            }
+
+            if (previous != null)
+                previous.Descriptors.ForEach(d => d.Dispose());
+        }
         #endregion 
 
         #region Private helpers
+
+        /// <summary>
+        /// Fill the features of the frames found in the cache and return the indices of the frames still to compute.
+        /// Also retrieves the cached raw matches between frames that are both reused.
+        /// </summary>
+        private List<int> LoadCachedFeatures(List<VideoFrame> frames, int featuresPerFrame, OpenCvSharp.KeyPoint[][] frameKeypoints, OpenCvSharp.Mat[] frameDescriptors)
+        {
+            rawMatches.Clear();
+            rawMatchesRatioTest = parameters.UseDistanceRatioTest;
+
+            Size imageSize = frames.Count > 0 ? frames[0].Image.Size : Size.Empty;
+            cacheKey = CameraFeatureCache.GetKey(videoPath, parameters.FeatureType, featuresPerFrame, CameraFeatureCache.HashMask(mask), imageSize);
+            CameraFeatureCache.Entry cached = cacheKey == null ? null : CameraFeatureCache.Load(cacheKey);
+
+            List<int> missing = new List<int>();
+            if (cached == null)
+            {
+                for (int i = 0; i < frames.Count; i++)
+                    missing.Add(i);
+
+                return missing;
+            }
+
+            Dictionary<long, int> cachedIndices = new Dictionary<long, int>();
+            for (int i = 0; i < cached.Timestamps.Count; i++)
+                cachedIndices[cached.Timestamps[i]] = i;
+
+            HashSet<long> reused = new HashSet<long>();
+            for (int i = 0; i < frames.Count; i++)
+            {
+                int index;
+                if (cachedIndices.TryGetValue(timestamps[i], out index) && cached.Fingerprints[index] == fingerprints[i])
+                {
+                    frameKeypoints[i] = cached.Keypoints[index];
+                    frameDescriptors[i] = cached.Descriptors[index];
+                    cached.Descriptors[index] = null;
+                    reused.Add(timestamps[i]);
+                }
+                else
+                {
+                    missing.Add(i);
+                }
+            }
+
+            foreach (var desc in cached.Descriptors)
+            {
+                if (desc != null)
+                    desc.Dispose();
+            }
+
+            // Matches index into the keypoints of both frames, they are only valid if neither was recomputed.
+            rawMatchesRatioTest = cached.RatioTest;
+            foreach (var pair in cached.Matches)
+            {
+                if (reused.Contains(pair.Key) && reused.Contains(pair.Value.Next))
+                    rawMatches[pair.Key] = pair.Value;
+            }
+
+            return missing;
+        }
+
+        /// <summary>
+        /// Create a feature detector for the configured feature type.
+        /// </summary>
+        private OpenCvSharp.Feature2D CreateDetector(int featuresPerFrame)
+        {
+            if (parameters.FeatureType == CameraMotionFeatureType.ORB)
+                return OpenCvSharp.ORB.Create(featuresPerFrame);
+            else
+                return OpenCvSharp.Features2D.SIFT.Create(featuresPerFrame);
+        }
+
+        /// <summary>
+        /// Create a brute force matcher for the configured feature type.
+        /// </summary>
+        private OpenCvSharp.BFMatcher CreateMatcher(bool crossCheck)
+        {
+            // Matching distance: SIFT requires L1 norm.
+            if (parameters.FeatureType == CameraMotionFeatureType.ORB)
+                return new OpenCvSharp.BFMatcher(OpenCvSharp.NormTypes.Hamming, crossCheck: crossCheck);
+            else
+                return new OpenCvSharp.BFMatcher(OpenCvSharp.NormTypes.L1, crossCheck: crossCheck);
+        }
+
         private void LogHomography(int index1, int index2, OpenCvSharp.Mat homography)
         {
             double[] m;
@@ -0,0 +1,72 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.ComponentModel;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Runs a per-frame (or per-pair) computation over contiguous ranges of indices on multiple threads.
+    /// Each thread creates its own instance of the state object (detector, matcher), OpenCV algorithms are not shared.
+    /// The body writes its result at its own index so the output order doesn't depend on scheduling.
+    /// </summary>
+    public static class PartitionedExecutor
+    {
+        /// <summary>
+        /// Runs body(i, state) for i in [0, count).
+        /// Progress is reported to the worker as the number of items done, and the loop stops on cancellation.
+        /// Returns the number of items completed from the start without gaps, 
+        /// results after this index must be discarded as some items before them may not have run.
+        /// </summary>
+        public static int Run<TState>(int count, int maxDegreeOfParallelism, Func<TState> init, Action<int, TState> body, BackgroundWorker worker)
+            where TState : IDisposable
+        {
+            if (count <= 0)
+                return 0;
+
+            int degree = maxDegreeOfParallelism > 0 ? maxDegreeOfParallelism : Environment.ProcessorCount;
+            ParallelOptions options = new ParallelOptions() { MaxDegreeOfParallelism = degree };
+
+            // A few ranges per thread to absorb differences in the time per item.
+            int rangeSize = Math.Max(1, count / (degree * 4));
+            var partitioner = Partitioner.Create(0, count, rangeSize);
+
+            bool[] completed = new bool[count];
+            int done = 0;
+
+            Parallel.ForEach(partitioner, options,
+                init,
+                (range, loopState, state) =>
+                {
+                    for (int i = range.Item1; i < range.Item2; i++)
+                    {
+                        if (loopState.IsStopped)
+                            break;
+
+                        if (worker != null && worker.CancellationPending)
+                        {
+                            loopState.Stop();
+                            break;
+                        }
+
+                        body(i, state);
+                        completed[i] = true;
+
+                        int progress = Interlocked.Increment(ref done);
+                        if (worker != null && worker.WorkerReportsProgress)
+                            worker.ReportProgress(progress, count);
+                    }
+
+                    return state;
+                },
+                state => state.Dispose());
+
+            int prefix = 0;
+            while (prefix < count && completed[prefix])
+                prefix++;
+
+            return prefix;
+        }
+    }
+}
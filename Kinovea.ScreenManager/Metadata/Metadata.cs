@@ -1667,8 +1667,11 @@ namespace Kinovea.ScreenManager
         /// </summary>
         public void PerformTracking(VideoFrame videoframe)
         {
-            using (var cvImage = OpenCvSharp.Extensions.BitmapConverter.ToMat(videoframe.Image))
+            // The trackers only read the image, they get a view over the frame pixels rather than a copy.
+            using (MatView view = new MatView(videoframe.Image))
             {
+                var cvImage = view.Mat;
+
                 // Run tracking in parallel.
                 List<DrawingTrack> tt = Tracks();
                 Parallel.ForEach(tt, t =>
@@ -1750,11 +1753,11 @@ namespace Kinovea.ScreenManager
                 return;
 
             // Happens when mouse up and editing a track.
-            using (var cvImage = OpenCvSharp.Extensions.BitmapConverter.ToMat(bitmap))
+            using (MatView view = new MatView(bitmap))
             {
                 DrawingTrack track = hitDrawing as DrawingTrack;
                 if (track != null && (track.Status == TrackStatus.Edit))
-                    track.UpdateTrackPoint(cvImage, imageTransform);
+                    track.UpdateTrackPoint(view.Mat, imageTransform);
             }
         }
         #endregion
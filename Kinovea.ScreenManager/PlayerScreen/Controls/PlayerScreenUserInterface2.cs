@@ -382,6 +382,7 @@ namespace Kinovea.ScreenManager
         private ContextMenuStrip popMenu = new ContextMenuStrip();
         private ToolStripMenuItem mnuTimeOrigin = new ToolStripMenuItem();
         private ToolStripMenuItem mnuDirectTrack = new ToolStripMenuItem();
+        private ToolStripMenuItem mnuTrackWorkingZone = new ToolStripMenuItem();
         private ToolStripMenuItem mnuBackground = new ToolStripMenuItem();
         private ToolStripMenuItem mnuCopyPic = new ToolStripMenuItem();
         private ToolStripMenuItem mnuPastePic = new ToolStripMenuItem();
@@ -1309,6 +1310,7 @@ namespace Kinovea.ScreenManager
             // Background context menu.
             mnuTimeOrigin.Image = Properties.Resources.marker;
             mnuDirectTrack.Image = Properties.Drawings.tracking;
+            mnuTrackWorkingZone.Image = Properties.Drawings.tracking_start;
             mnuBackground.Image = Properties.Resources.shading;
             mnuCopyPic.Image = Properties.Resources.clipboard_block;
             mnuPastePic.Image = Properties.Drawings.paste;
@@ -1330,6 +1332,7 @@ namespace Kinovea.ScreenManager
 
             mnuTimeOrigin.Click += mnuTimeOrigin_Click;
             mnuDirectTrack.Click += mnuDirectTrack_Click;
+            mnuTrackWorkingZone.Click += mnuTrackWorkingZone_Click;
             mnuBackground.Click += mnuBackground_Click;
             mnuCopyPic.Click += (s, e) => { CopyImageToClipboard(); };
             mnuPastePic.Click += mnuPastePic_Click;
@@ -3077,6 +3080,7 @@ namespace Kinovea.ScreenManager
             // Background context menu.
             mnuTimeOrigin.Text = ScreenManagerLang.mnuMarkTimeAsOrigin;
             mnuDirectTrack.Text = ScreenManagerLang.mnuTrackTrajectory;
+            mnuTrackWorkingZone.Text = ScreenManagerLang.tracking_TrackWorkingZone;
             mnuBackground.Text = ScreenManagerLang.PlayerScreenUserInterface_Background;
             mnuPasteDrawing.Text = ScreenManagerLang.mnuPasteDrawing;
             mnuPasteDrawing.ShortcutKeys = HotkeySettingsManager.GetMenuShortcut("PlayerScreen", (int)PlayerScreenCommands.PasteDrawing);
@@ -3462,6 +3466,7 @@ namespace Kinovea.ScreenManager
 
                 mnuTimeOrigin.Enabled = false;
                 mnuDirectTrack.Enabled = false;
+                mnuTrackWorkingZone.Enabled = false;
                 mnuBackground.Enabled = false;
                 mnuPasteDrawing.Enabled = false;
                 mnuPastePic.Enabled = false;
@@ -3573,6 +3578,8 @@ namespace Kinovea.ScreenManager
                     mnuTimeOrigin.Visible = true;
                     mnuDirectTrack.Visible = true;
                     mnuDirectTrack.Enabled = true;
+                    mnuTrackWorkingZone.Visible = true;
+                    mnuTrackWorkingZone.Enabled = m_FrameServer.Metadata.Tracks().Any(t => t.Status == TrackStatus.Edit);
                     mnuBackground.Visible = true;
                     mnuBackground.Enabled = true;
                     mnuPasteDrawing.Visible = true;
@@ -3675,6 +3682,7 @@ namespace Kinovea.ScreenManager
             {
                 mnuTimeOrigin,
                 mnuDirectTrack,
+                mnuTrackWorkingZone,
                 mnuBackground,
                 new ToolStripSeparator(),
                 mnuCopyPic,
@@ -5199,6 +5207,46 @@ namespace Kinovea.ScreenManager
             DrawingAdding?.Invoke(this, new DrawingEventArgs(track, m_FrameServer.Metadata.TrackManager.Id));
         }
 
+        private void mnuTrackWorkingZone_Click(object sender, EventArgs e)
+        {
+            // Track the open tracks until the end of the working zone in one go, outside the play loop.
+            // The frames are decoded by a separate reader, the player stays on the current frame.
+            List<DrawingTrack> tracks = m_FrameServer.Metadata.Tracks().Where(t => t.Status == TrackStatus.Edit).ToList();
+            if (tracks.Count == 0)
+                return;
+
+            VideoSection zone = m_FrameServer.VideoReader.WorkingZone;
+            BatchTracker batchTracker = new BatchTracker(m_FrameServer, tracks, zone.Start, zone.End);
+            formProgressBar2 fpb = new formProgressBar2(true, false, (s, a) => batchTracker.Run(s as BackgroundWorker));
+            fpb.ShowDialog();
+            fpb.Dispose();
+
+            if (batchTracker.Failed)
+            {
+                // The tracks may have stopped at different frames, don't commit a partial batch.
+                batchTracker.Discard();
+                RefreshImage();
+                MessageBox.Show(
+                    ScreenManagerLang.tracking_TrackWorkingZoneError,
+                    ScreenManagerLang.tracking_TrackWorkingZone,
+                    MessageBoxButtons.OK,
+                    MessageBoxIcon.Exclamation);
+                return;
+            }
+
+            batchTracker.Commit();
+
+            // Bring the trackable drawings up to date with the new points at the current frame.
+            long timestamp = m_FrameServer.VideoReader.Current.Timestamp;
+            m_FrameServer.Metadata.BeforeTrackingStep(timestamp);
+            m_FrameServer.Metadata.SyncTrackableDrawings(timestamp);
+            m_FrameServer.Metadata.CameraTrackingStep();
+
+            sidePanelTracking.UpdateContent();
+            UpdateFramesMarkers();
+            RefreshImage();
+        }
+
         private void mnuBackground_Click(object sender, EventArgs e)
         {
             Color memo = m_FrameServer.Metadata.BackgroundColor;
@@ -5799,6 +5847,7 @@ namespace Kinovea.ScreenManager
 
             mnuTimeOrigin.Enabled = enable;
             mnuDirectTrack.Enabled = enable;
+            mnuTrackWorkingZone.Enabled = enable && m_FrameServer.Metadata.Tracks().Any(t => t.Status == TrackStatus.Edit);
             mnuBackground.Enabled = enable;
         }
         private void EnableDisableWorkingZoneControls(bool enable)
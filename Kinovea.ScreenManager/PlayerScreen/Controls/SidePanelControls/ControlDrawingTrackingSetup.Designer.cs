@@ -33,6 +33,7 @@ namespace Kinovea.ScreenManager
       this.grpTracking = new System.Windows.Forms.GroupBox();
       this.btnTrimTrack = new System.Windows.Forms.Button();
       this.btnStartStop = new System.Windows.Forms.Button();
+      this.cbCoarseToFine = new System.Windows.Forms.CheckBox();
       this.nudUpdateThreshold = new System.Windows.Forms.NumericUpDown();
       this.lblUpdateThreshold = new System.Windows.Forms.Label();
       this.nudMatchTreshold = new System.Windows.Forms.NumericUpDown();
@@ -76,6 +77,7 @@ namespace Kinovea.ScreenManager
       this.grpTracking.BackColor = System.Drawing.Color.White;
       this.grpTracking.Controls.Add(this.btnTrimTrack);
       this.grpTracking.Controls.Add(this.btnStartStop);
+      this.grpTracking.Controls.Add(this.cbCoarseToFine);
       this.grpTracking.Controls.Add(this.nudUpdateThreshold);
       this.grpTracking.Controls.Add(this.lblUpdateThreshold);
       this.grpTracking.Controls.Add(this.nudMatchTreshold);
@@ -94,7 +96,7 @@ namespace Kinovea.ScreenManager
       this.grpTracking.Controls.Add(this.lblObjectWindow);
       this.grpTracking.Location = new System.Drawing.Point(0, 276);
       this.grpTracking.Name = "grpTracking";
-      this.grpTracking.Size = new System.Drawing.Size(362, 251);
+      this.grpTracking.Size = new System.Drawing.Size(362, 282);
       this.grpTracking.TabIndex = 54;
       this.grpTracking.TabStop = false;
       this.grpTracking.Text = "Tracking";
@@ -105,7 +107,7 @@ namespace Kinovea.ScreenManager
       this.btnTrimTrack.ForeColor = System.Drawing.Color.Black;
       this.btnTrimTrack.Image = global::Kinovea.ScreenManager.Properties.Drawings.tracking_trim;
       this.btnTrimTrack.ImageAlign = System.Drawing.ContentAlignment.MiddleLeft;
-      this.btnTrimTrack.Location = new System.Drawing.Point(28, 213);
+      this.btnTrimTrack.Location = new System.Drawing.Point(28, 244);
       this.btnTrimTrack.Name = "btnTrimTrack";
       this.btnTrimTrack.Size = new System.Drawing.Size(222, 27);
       this.btnTrimTrack.TabIndex = 68;
@@ -118,7 +120,7 @@ namespace Kinovea.ScreenManager
       this.btnStartStop.Anchor = ((System.Windows.Forms.AnchorStyles)((System.Windows.Forms.AnchorStyles.Bottom | System.Windows.Forms.AnchorStyles.Left)));
       this.btnStartStop.AutoSize = true;
       this.btnStartStop.ForeColor = System.Drawing.Color.Black;
-      this.btnStartStop.Location = new System.Drawing.Point(28, 180);
+      this.btnStartStop.Location = new System.Drawing.Point(28, 211);
       this.btnStartStop.Name = "btnStartStop";
       this.btnStartStop.Size = new System.Drawing.Size(222, 27);
       this.btnStartStop.TabIndex = 67;
@@ -126,6 +128,18 @@ namespace Kinovea.ScreenManager
       this.btnStartStop.UseVisualStyleBackColor = true;
       this.btnStartStop.Click += new System.EventHandler(this.btnStartStop_Click);
       // 
+      // cbCoarseToFine
+      // 
+      this.cbCoarseToFine.AutoSize = true;
+      this.cbCoarseToFine.ForeColor = System.Drawing.SystemColors.ControlText;
+      this.cbCoarseToFine.Location = new System.Drawing.Point(28, 178);
+      this.cbCoarseToFine.Name = "cbCoarseToFine";
+      this.cbCoarseToFine.Size = new System.Drawing.Size(132, 17);
+      this.cbCoarseToFine.TabIndex = 69;
+      this.cbCoarseToFine.Text = "Coarse-to-fine search";
+      this.cbCoarseToFine.UseVisualStyleBackColor = true;
+      this.cbCoarseToFine.CheckedChanged += new System.EventHandler(this.cbCoarseToFine_CheckedChanged);
+      // 
       // nudUpdateThreshold
       // 
       this.nudUpdateThreshold.DecimalPlaces = 2;
@@ -369,7 +383,7 @@ namespace Kinovea.ScreenManager
       this.ForeColor = System.Drawing.Color.Gray;
       this.Margin = new System.Windows.Forms.Padding(3, 5, 3, 5);
       this.Name = "ControlDrawingTrackingSetup";
-      this.Size = new System.Drawing.Size(362, 528);
+      this.Size = new System.Drawing.Size(362, 559);
       this.grpTracking.ResumeLayout(false);
       this.grpTracking.PerformLayout();
       ((System.ComponentModel.ISupportInitialize)(this.nudUpdateThreshold)).EndInit();
@@ -404,5 +418,6 @@ namespace Kinovea.ScreenManager
         private System.Windows.Forms.Label lblUpdateThreshold;
         private System.Windows.Forms.Button btnTrimTrack;
         private System.Windows.Forms.Button btnStartStop;
+        private System.Windows.Forms.CheckBox cbCoarseToFine;
     }
 }
@@ -104,6 +104,7 @@ namespace Kinovea.ScreenManager
             lblObjectWindow.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.tracking_ObjectWindow;
             lblMatchThreshold.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.tracking_MatchThreshold;
             lblUpdateThreshold.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.track_UpdateThreshold;
+            cbCoarseToFine.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.tracking_CoarseToFine;
             btnStartStop.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.tracking_Start;
             btnTrimTrack.Text = Kinovea.ScreenManager.Languages.ScreenManagerLang.tracking_DeleteEndOfTrack;
         }
@@ -310,12 +311,14 @@ namespace Kinovea.ScreenManager
                 nudObjWindowHeight.Value = tp.BlockWindow.Height;
                 nudMatchTreshold.Value = (decimal)tp.SimilarityThreshold;
                 nudUpdateThreshold.Value = (decimal)tp.TemplateUpdateThreshold;
+                cbCoarseToFine.Checked = tp.CoarseToFine;
 
                 bool enableThresholds = tp.TrackingAlgorithm == TrackingAlgorithm.Correlation;
                 lblMatchThreshold.Enabled = enableThresholds;
                 lblUpdateThreshold.Enabled = enableThresholds;
                 nudMatchTreshold.Enabled = enableThresholds;
                 nudUpdateThreshold.Enabled = enableThresholds;
+                cbCoarseToFine.Enabled = enableThresholds;
             }
 
             manualUpdate = false;
@@ -476,6 +479,22 @@ namespace Kinovea.ScreenManager
             RaiseDrawingModified(DrawingAction.TrackingParametersChanged);
         }
 
+        private void cbCoarseToFine_CheckedChanged(object sender, EventArgs e)
+        {
+            if (manualUpdate || track == null)
+                return;
+
+            // Update the data.
+            track.TrackingParameters.CoarseToFine = cbCoarseToFine.Checked;
+            EnsureTracking();
+
+            // Update local UI.
+            viewportController.Refresh();
+
+            // Update other controllers.
+            RaiseDrawingModified(DrawingAction.TrackingParametersChanged);
+        }
+
         private void btnStartStop_Click(object sender, EventArgs e)
         {
             if (track != null)
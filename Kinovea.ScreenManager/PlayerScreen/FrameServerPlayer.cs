@@ -166,7 +166,8 @@ namespace Kinovea.ScreenManager
                         PreferencesManager.PlayerPreferences.AspectRatio, 
                         ImageRotation.Rotate0, 
                         Demosaicing.None, 
-                        PreferencesManager.PlayerPreferences.DeinterlaceByDefault);
+                        PreferencesManager.PlayerPreferences.DeinterlaceByDefault,
+                        PreferencesManager.PlayerPreferences.DecoderThreading);
 
                     return videoReader.Open(filePath);
                 }
@@ -181,6 +182,58 @@ namespace Kinovea.ScreenManager
             }
         }
 
+        /// <summary>
+        /// Open a second reader on the file, with the same image options as the main reader.
+        /// This is used to decode frames in the background without moving the main reader.
+        /// The reader is left in on-demand mode. The caller owns it and must close it.
+        /// Returns null if the file could not be opened.
+        /// </summary>
+        public VideoReader OpenSecondaryReader()
+        {
+            if (videoReader == null || !videoReader.Loaded)
+                return null;
+
+            VideoReader reader = VideoTypeManager.GetVideoReader(videoReader);
+            if (reader == null)
+                return null;
+
+            try
+            {
+                reader.Options = new VideoOptions(
+                    metadata.ImageAspect,
+                    ImageRotation.Rotate0,
+                    metadata.Demosaicing,
+                    metadata.Deinterlacing,
+                    PreferencesManager.PlayerPreferences.DecoderThreading);
+
+                OpenVideoResult result = reader.Open(videoReader.FilePath);
+                if (result != OpenVideoResult.Success)
+                {
+                    log.ErrorFormat("Secondary reader could not open the file. {0}", result);
+                    return null;
+                }
+
+                // The rotation is reset to the one of the file on open.
+                if (reader.CanChangeImageRotation)
+                    reader.ChangeImageRotation(metadata.ImageRotation);
+
+                if (reader.CanStabilize && metadata.StabilizationTrack != Guid.Empty)
+                {
+                    DrawingTrack track = metadata.GetDrawing(metadata.TrackManager.Id, metadata.StabilizationTrack) as DrawingTrack;
+                    if (track != null)
+                        reader.SetStabilizationData(track.GetTimedPoints());
+                }
+
+                return reader;
+            }
+            catch (Exception e)
+            {
+                log.Error("Error while opening the secondary reader.");
+                log.Error(e);
+                return null;
+            }
+        }
+
         /// <summary>
         /// This is called when the screen is about to be emptied, 
         /// we are about to load a new video in the same screen,
@@ -446,54 +499,20 @@ namespace Kinovea.ScreenManager
         /// <summary>
         /// Lazily enumerates the images from the video, for export purposes.
         /// This includes skipping and duplicating frames as needed.
+        /// Decoding and rendering run ahead on their own threads, see ExportPipeline.
         /// This returns an internal bitmap and the caller should do its own copy.
         /// </summary>
         public IEnumerable<Bitmap> EnumerateImages(SavingSettings settings)
         {
-            Bitmap output = null;
-
             if (settings.KeyframesOnly)
             {
                 throw new InvalidProgramException("EnumerateImages should not be called with KeyframesOnly, use EnumerateKeyImages instead.");
             }
 
-            int count = 0;
-            // Enumerates the raw frames from the video.
-            foreach (VideoFrame vf in videoReader.EnumerateFrames(settings.InputIntervalTimestamps))
-            {
-                if (vf == null)
-                {
-                    log.Error("Working zone enumerator yield null.");
-                    
-                    if (output != null)
-                        output.Dispose();
-
-                    yield break;
-                }
-
-                log.DebugFormat("Enumerated frame [{0}]: {1}", count, vf.Timestamp);
-                count++;
-
-                // Initialize the output Bitmap if not done already.
-                if (output == null)
-                    output = new Bitmap(vf.Image.Width, vf.Image.Height, vf.Image.PixelFormat);
-                
-                // Paint the frame + annotations to our bitmap.
-                bool onKeyframe = settings.ImageRetriever(vf, output);
-
-                // Store the input timestamp in the bitmap, this may be used by the caller to build a file name for image exports.
-                output.Tag = vf.Timestamp;
-
-                int repeatCount = (settings.HasDuplicatedKeyframes && onKeyframe) ? settings.DuplicationKeyframes : settings.Duplication;
-                for (int i = 0; i < repeatCount; i++)
-                { 
-                    yield return output;
-                }
-            }
-
-            // End of enumeration.
-            if (output != null)
-                output.Dispose();
+            Func<bool, int> getRepeatCount = onKeyframe => (settings.HasDuplicatedKeyframes && onKeyframe) ? settings.DuplicationKeyframes : settings.Duplication;
+            
+            ExportPipeline pipeline = new ExportPipeline(videoReader.EnumerateFrames(settings.InputIntervalTimestamps), settings.ImageRetriever, getRepeatCount);
+            return pipeline.Enumerate();
         }
 
         /// <summary>
@@ -503,20 +522,27 @@ namespace Kinovea.ScreenManager
         /// </summary>
         public IEnumerable<Bitmap> EnumerateKeyImages(SavingSettings settings)
         {
-            Bitmap output = null;
+            ExportPipeline pipeline = new ExportPipeline(EnumerateKeyframes(settings.Section), settings.ImageRetriever, onKeyframe => 1);
+            return pipeline.Enumerate();
+        }
 
+        /// <summary>
+        /// Moves the reader from key frame to key frame within the section and enumerates the frames.
+        /// </summary>
+        private IEnumerable<VideoFrame> EnumerateKeyframes(VideoSection section)
+        {
             var keyframes = this.metadata.Keyframes;
-            long currentTimestamp = settings.Section.Start;
+            long currentTimestamp = section.Start;
 
             for (int i = 0; i < keyframes.Count; i++)
             {
                 var kf = keyframes[i];
-                if (kf.Timestamp < settings.Section.Start)
+                if (kf.Timestamp < section.Start)
                 {
                     continue;
                 }
 
-                if (kf.Timestamp > settings.Section.End)
+                if (kf.Timestamp > section.End)
                 {
                     break;
                 }
@@ -526,22 +552,8 @@ namespace Kinovea.ScreenManager
                 VideoFrame vf = videoReader.Current;
                 currentTimestamp = vf.Timestamp;
 
-                // Initialize the output Bitmap if not done already.
-                if (output == null)
-                    output = new Bitmap(vf.Image.Width, vf.Image.Height, vf.Image.PixelFormat);
-
-                // Paint the frame + annotations to our bitmap.
-                settings.ImageRetriever(vf, output);
-
-                // Store the input timestamp in the bitmap, this may be used by the caller to build a file name for image exports.
-                output.Tag = vf.Timestamp;
-
-                yield return output;
+                yield return vf;
             }
-
-            // End of enumeration.
-            if (output != null)
-                output.Dispose();
         }
 
         public void ReportError(SaveResult saveResult)
@@ -0,0 +1,194 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Linq;
+
+using Kinovea.Video;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Disk cache of the video summaries shown in the thumbnail viewer.
+    /// An entry is valid while the size and last write time of the file are unchanged. Thumbnails are stored as JPEG.
+    /// The total size is bounded, the least recently used entries are evicted first.
+    /// Called from the summary loader workers, never from the UI thread. Errors are logged and treated as cache misses.
+    /// </summary>
+    public static class SummaryCache
+    {
+        private const int magic = 0x5356564B; // "KVVS"
+        private const int version = 1;
+        private const long jpegQuality = 85;
+        private const long maxCacheBytes = 256L * 1024 * 1024;
+        private const string extension = ".kts";
+        private static readonly DiskCache cache = new DiskCache("Summary cache", "Thumbnails", extension, maxCacheBytes);
+        private static readonly ImageCodecInfo jpegCodec = ImageCodecInfo.GetImageEncoders().FirstOrDefault(c => c.MimeType == "image/jpeg");
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <summary>
+        /// Returns the cached summary of the file, or null if there is no valid entry.
+        /// The summary is named after the filename passed by the caller, not the normalized path.
+        /// The file info must be fresh, it is also the stamp passed to Save on a miss.
+        /// </summary>
+        public static VideoSummary Load(string filename, FileInfo file, Size maxImageSize)
+        {
+            string entryPath = GetEntryPath(file.FullName);
+            if (entryPath == null || !File.Exists(entryPath))
+                return null;
+
+            VideoSummary summary = null;
+            try
+            {
+                using (FileStream stream = new FileStream(entryPath, FileMode.Open, FileAccess.Read, FileShare.Read))
+                using (BinaryReader r = new BinaryReader(stream))
+                {
+                    if (r.ReadInt32() != magic || r.ReadInt32() != version)
+                        return null;
+
+                    bool match = string.Equals(r.ReadString(), file.FullName, StringComparison.OrdinalIgnoreCase) &&
+                        r.ReadInt64() == file.Length &&
+                        r.ReadInt64() == file.LastWriteTimeUtc.Ticks &&
+                        r.ReadInt32() == maxImageSize.Width &&
+                        r.ReadInt32() == maxImageSize.Height;
+
+                    if (!match)
+                        return null;
+
+                    summary = new VideoSummary(filename);
+                    summary.IsImage = r.ReadBoolean();
+                    int width = r.ReadInt32();
+                    int height = r.ReadInt32();
+                    summary.ImageSize = new Size(width, height);
+                    summary.DurationMilliseconds = r.ReadInt64();
+                    summary.Framerate = r.ReadDouble();
+
+                    int count = r.ReadInt32();
+                    for (int i = 0; i < count; i++)
+                    {
+                        int length = r.ReadInt32();
+                        byte[] bytes = r.ReadBytes(length);
+                        if (bytes.Length != length)
+                            throw new EndOfStreamException();
+
+                        summary.Thumbs.Add(Decode(bytes));
+                    }
+                }
+
+                cache.Touch(entryPath);
+                return summary;
+            }
+            catch (Exception e)
+            {
+                log.DebugFormat("Summary cache: the entry for {0} could not be read. {1}", file.Name, e.Message);
+
+                if (summary != null)
+                    summary.Thumbs.ForEach(t => t.Dispose());
+
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// Stores the summary of the file, stamped with the state of the file described by the file info.
+        /// Summaries without thumbnails are not stored, the file may not be readable yet.
+        /// Summaries cut short are not stored either, the next extraction may get all the thumbnails.
+        /// Returns true if an entry was written.
+        /// </summary>
+        public static bool Save(FileInfo file, Size maxImageSize, VideoSummary summary)
+        {
+            if (summary == null || summary.Thumbs == null || summary.Thumbs.Count == 0 || summary.Truncated)
+                return false;
+
+            string entryPath = GetEntryPath(file.FullName);
+            if (entryPath == null)
+                return false;
+
+            return cache.Write(entryPath, file.Name, w =>
+            {
+                w.Write(magic);
+                w.Write(version);
+                w.Write(file.FullName);
+                w.Write(file.Length);
+                w.Write(file.LastWriteTimeUtc.Ticks);
+                w.Write(maxImageSize.Width);
+                w.Write(maxImageSize.Height);
+
+                w.Write(summary.IsImage);
+                w.Write(summary.ImageSize.Width);
+                w.Write(summary.ImageSize.Height);
+                w.Write(summary.DurationMilliseconds);
+                w.Write(summary.Framerate);
+
+                w.Write(summary.Thumbs.Count);
+                foreach (Bitmap thumb in summary.Thumbs)
+                {
+                    byte[] bytes = Encode(thumb);
+                    w.Write(bytes.Length);
+                    w.Write(bytes);
+                }
+            });
+        }
+
+        /// <summary>
+        /// Evicts the least recently used entries if the cache is over its size limit.
+        /// </summary>
+        public static void Trim()
+        {
+            cache.Trim();
+        }
+
+        private static string GetEntryPath(string filename)
+        {
+            // Entries are named after a hash of the full path. Paths are case insensitive on Windows.
+            return string.IsNullOrEmpty(filename) ? null : cache.GetEntryPath(filename.ToUpperInvariant());
+        }
+
+        private static byte[] Encode(Bitmap thumb)
+        {
+            using (MemoryStream stream = new MemoryStream())
+            {
+                if (jpegCodec != null)
+                {
+                    EncoderParameters parameters = new EncoderParameters(1);
+                    parameters.Param[0] = new EncoderParameter(System.Drawing.Imaging.Encoder.Quality, jpegQuality);
+                    thumb.Save(stream, jpegCodec, parameters);
+                }
+                else
+                {
+                    thumb.Save(stream, ImageFormat.Jpeg);
+                }
+
+                return stream.ToArray();
+            }
+        }
+
+        private static Bitmap Decode(byte[] bytes)
+        {
+            // Copy the image so the bitmap doesn't depend on the stream.
+            using (MemoryStream stream = new MemoryStream(bytes))
+            using (Image image = Image.FromStream(stream))
+                return new Bitmap(image);
+        }
+    }
+}
@@ -18,8 +18,10 @@ namespace Kinovea.ScreenManager
 {
 
     /// <summary>
-    /// A summary loader processes a list of files in a background thread to get their summaries.
-    /// Raises individual SummaryLoaded events as the summaries are extracted.
+    /// A summary loader processes a list of files in background threads to get their summaries.
+    /// A small pool of workers, each with its own video readers, picks the files currently visible in the viewer first,
+    /// then the rest of the list in order. Summaries of files that haven't changed come from the SummaryCache.
+    /// Raises individual SummaryLoaded events on the thread that started the loader as the summaries are extracted.
     /// </summary>
     public class SummaryLoader
     {
@@ -31,22 +33,30 @@ namespace Kinovea.ScreenManager
         }
 
         private bool isAlive;
-        private bool cancellationPending;
+        private volatile bool cancellationPending;
         private List<String> filenames;
+        private List<String> pending;
+        private List<String> prioritized = new List<string>();
+        private object locker = new object();
         private Size maxImageSize;
-        private BackgroundWorker bgWorker = new BackgroundWorker();
+        private AsyncOperation asyncOperation;
+        private int activeWorkers;
+        private volatile bool cacheWritten;
+        private int loaded;
         private Stopwatch stopwatch = new Stopwatch();
         private const int thumbnailsToExtract = 4;
+        private const int maxWorkers = 4;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
         
         public SummaryLoader(List<String> filenames, Size maxImageSize)
         {
             this.filenames = filenames;
+            this.pending = new List<string>(filenames);
             this.maxImageSize = maxImageSize;
         }
 
         /// <summary>
-        /// Start the background thread to extract summaries.
+        /// Start the background threads to extract summaries.
         /// </summary>
         public void Run()
         {
@@ -54,86 +64,154 @@ namespace Kinovea.ScreenManager
                 return;
             
             isAlive = true;
-            bgWorker.RunWorkerCompleted += bgWorker_RunWorkerCompleted;
-            bgWorker.ProgressChanged += bgWorker_ProgressChanged;
-            bgWorker.DoWork += bgWorker_DoWork;
-            bgWorker.WorkerSupportsCancellation = true;
-            bgWorker.WorkerReportsProgress = true;
-            bgWorker.RunWorkerAsync(filenames);
+            stopwatch.Restart();
+            asyncOperation = AsyncOperationManager.CreateOperation(null);
+
+            // Each worker mostly waits on file I/O and single threaded decoding.
+            // More than a few of them just fight for the disk.
+            int workers = Math.Min(filenames.Count, Math.Max(1, Math.Min(maxWorkers, Environment.ProcessorCount / 2)));
+            activeWorkers = workers;
+            for (int i = 0; i < workers; i++)
+            {
+                Thread thread = new Thread(Worker);
+                thread.Name = string.Format("SummaryLoader {0}", i);
+                thread.IsBackground = true;
+                thread.Priority = ThreadPriority.BelowNormal;
+                thread.Start();
+            }
         }
 
         /// <summary>
-        /// Cancel the background thread.
+        /// Cancel the background threads. 
+        /// Summaries being extracted are completed but not raised.
         /// </summary>
         public void Cancel()
         {
             cancellationPending = true;
-            bgWorker.CancelAsync();
         }
 
+        /// <summary>
+        /// Sets the files to extract before any other, typically the ones currently visible.
+        /// Replaces the previous set. Files already extracted are ignored.
+        /// </summary>
+        public void Prioritize(List<string> files)
+        {
+            lock (locker)
+                prioritized = new List<string>(files);
+        }
 
-        private void bgWorker_DoWork(object sender, DoWorkEventArgs e)
+        private string NextFile()
         {
-            stopwatch.Restart();
+            lock (locker)
+            {
+                while (prioritized.Count > 0)
+                {
+                    string file = prioritized[0];
+                    prioritized.RemoveAt(0);
+                    if (pending.Remove(file))
+                        return file;
+                }
 
-            // Note: having one background worker per file and running them all in parallel was tested
-            // but it does more harm than good.
-            BackgroundWorker bgWorker = sender as BackgroundWorker;
-            List<string> filenames = e.Argument as List<string>;
-            
-            if(filenames.Count < 1 || bgWorker == null)
-        	{
-        	    e.Result = null;
-        	    return;
-        	}
+                if (pending.Count == 0)
+                    return null;
 
-            for (int i = 0; i<filenames.Count; i++)
+                string next = pending[0];
+                pending.RemoveAt(0);
+                return next;
+            }
+        }
+
+        private void Worker()
+        {
+            // Readers are reused from one file to the next, one per reader type.
+            Dictionary<string, VideoReader> readers = new Dictionary<string, VideoReader>();
+
+            try
             {
-                if(bgWorker.CancellationPending)
+                while (!cancellationPending)
                 {
-                    log.DebugFormat("Cancelled summary loader.");
-                    break;
+                    string filename = NextFile();
+                    if (filename == null)
+                        break;
+
+                    VideoSummary summary = null;
+
+                    try
+                    {
+                        if (string.IsNullOrEmpty(filename))
+                            continue;
+
+                        // Unchanged files are served from the disk cache without opening them.
+                        FileInfo file = new FileInfo(filename);
+                        file.Refresh();
+                        summary = SummaryCache.Load(filename, file, maxImageSize);
+                        if (summary != null)
+                        {
+                            asyncOperation.Post(SummaryPosted, summary);
+                            continue;
+                        }
+
+                        string extension = Path.GetExtension(filename).ToLower();
+                        VideoReader reader;
+                        if (!readers.TryGetValue(extension, out reader))
+                        {
+                            reader = VideoTypeManager.GetVideoReader(extension);
+                            readers.Add(extension, reader);
+                        }
+
+                        if (reader != null)
+                            summary = reader.ExtractSummary(filename, thumbnailsToExtract, maxImageSize);
+
+                        if (SummaryCache.Save(file, maxImageSize, summary))
+                            cacheWritten = true;
+                    }
+                    catch (Exception exp)
+                    {
+                        log.ErrorFormat("Error while extracting video summary for {0}.", filename);
+                        log.Error(exp);
+                    }
+
+                    if (summary == null)
+                        summary = new VideoSummary(filename);
+
+                    asyncOperation.Post(SummaryPosted, summary);
                 }
-                
-                string filename = filenames[i];
-                VideoSummary summary = null;
-               
-                try
+            }
+            finally
+            {
+                foreach (VideoReader reader in readers.Values)
                 {
-                    if(string.IsNullOrEmpty(filename))
-                       continue;
-                    
-                    string extension = Path.GetExtension(filename);
-                    VideoReader reader = VideoTypeManager.GetVideoReader(extension);
-
-        			if(reader != null)
-                        summary = reader.ExtractSummary(filename, thumbnailsToExtract, maxImageSize);
+                    IDisposable disposable = reader as IDisposable;
+                    if (disposable != null)
+                        disposable.Dispose();
                 }
-                catch(Exception exp)
+
+                if (Interlocked.Decrement(ref activeWorkers) == 0)
                 {
-                    log.ErrorFormat("Error while extracting video summary for {0}.", filename);
-                    log.Error(exp);
-                }
+                    if (cacheWritten)
+                        SummaryCache.Trim();
 
-                if (summary == null)
-                    summary = new VideoSummary(filename);
-                
-    			bgWorker.ReportProgress(i, summary);
+                    asyncOperation.PostOperationCompleted(WorkersCompleted, null);
+                }
             }
-
-            log.DebugFormat("{0} video summaries loaded in {1} ms", filenames.Count, stopwatch.ElapsedMilliseconds);
         }
 
-        private void bgWorker_ProgressChanged(object sender, ProgressChangedEventArgs e)
+        private void SummaryPosted(object state)
         {
             if(cancellationPending || SummaryLoaded == null)
                 return;
             
-            SummaryLoaded(this, new SummaryLoadedEventArgs(e.UserState as VideoSummary, e.ProgressPercentage));
+            SummaryLoaded(this, new SummaryLoadedEventArgs(state as VideoSummary, loaded));
+            loaded++;
         }
 
-        private void bgWorker_RunWorkerCompleted(object sender, RunWorkerCompletedEventArgs e)
+        private void WorkersCompleted(object state)
         {
+            if (cancellationPending)
+                log.DebugFormat("Cancelled summary loader.");
+            else
+                log.DebugFormat("{0} video summaries loaded in {1} ms", filenames.Count, stopwatch.ElapsedMilliseconds);
+
             isAlive = false;
         }
     }
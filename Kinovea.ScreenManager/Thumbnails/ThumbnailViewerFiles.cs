@@ -96,6 +96,9 @@ namespace Kinovea.ScreenManager
             this.Hotkeys = HotkeySettingsManager.LoadHotkeys("ThumbnailViewerFiles");
             thumbSize = PreferencesManager.FileExplorerPreferences.ExplorerThumbsSize;
             this.pnlThumbs.ContextMenuStrip = popMenu;
+            this.pnlThumbs.Scroll += pnlThumbs_ViewportChanged;
+            this.pnlThumbs.MouseWheel += pnlThumbs_ViewportChanged;
+            this.pnlThumbs.Resize += pnlThumbs_ViewportChanged;
             BuildContextMenus();
 
             // Remember the current sort axis and direction.
@@ -389,6 +392,7 @@ namespace Kinovea.ScreenManager
             Size maxSize = new Size(432, 360);
             SummaryLoader sl = new SummaryLoader(filesToLoad, maxSize);
             sl.SummaryLoaded += SummaryLoader_SummaryLoaded;
+            sl.Prioritize(GetVisibleFiles());
             loaders.Add(sl);
 
             if (BeforeLoad != null)
@@ -556,6 +560,38 @@ namespace Kinovea.ScreenManager
             }
         }
 
+        /// <summary>
+        /// Files whose thumbnail is at least partially visible in the panel, in display order.
+        /// </summary>
+        private List<string> GetVisibleFiles()
+        {
+            // The bounds of the children of a scrolled panel are relative to its visible area.
+            List<string> visible = new List<string>();
+            Rectangle viewport = pnlThumbs.ClientRectangle;
+            int count = Math.Min(files.Count, thumbnails.Count);
+            for (int i = 0; i < count; i++)
+            {
+                if (thumbnails[i].Visible && viewport.IntersectsWith(thumbnails[i].Bounds))
+                    visible.Add(thumbnails[i].FilePath);
+            }
+
+            return visible;
+        }
+
+        private void pnlThumbs_ViewportChanged(object sender, EventArgs e)
+        {
+            // Extract the thumbnails the user is looking at first.
+            if (loaders.Count == 0)
+                return;
+
+            List<string> visible = GetVisibleFiles();
+            foreach (SummaryLoader loader in loaders)
+            {
+                if (loader.IsAlive)
+                    loader.Prioritize(visible);
+            }
+        }
+
         /// <summary>
         /// One of the summaries was extracted, push it into its thumbnail.
         /// </summary>
@@ -0,0 +1,248 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.ComponentModel;
+using System.Diagnostics;
+using System.Drawing;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+
+using Kinovea.ScreenManager.Languages;
+using Kinovea.Services;
+using Kinovea.Video;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Tracks the open tracks until the end of the working zone, outside the play loop.
+    /// A dedicated reader decodes the frames in sequence on its own thread, a few frames ahead of the trackers.
+    /// Each frame is then passed to all the tracks in parallel, like a tracking step in the play loop.
+    /// The tracks keep the new points on the side, they are only added to the timelines on commit, on the UI thread.
+    /// </summary>
+    public class BatchTracker
+    {
+        /// <summary>
+        /// Number of decoded frames waiting for the trackers.
+        /// </summary>
+        public const int QueueCapacity = 4;
+
+        /// <summary>
+        /// Number of bitmaps in flight: the queued ones, plus one in the decoder and one in the trackers.
+        /// </summary>
+        public const int PoolCapacity = QueueCapacity + 2;
+
+        /// <summary>
+        /// Whether the batch stopped on an error rather than at the end of the zone or on cancellation.
+        /// The tracked points should then be discarded instead of committed.
+        /// </summary>
+        public bool Failed { get; private set; }
+
+        private class BatchFrame
+        {
+            public Bitmap Image;
+            public long Timestamp;
+        }
+
+        private FrameServerPlayer frameServer;
+        private List<DrawingTrack> tracks;
+        private long start;
+        private long end;
+
+        private VideoReader reader;
+        private CancellationTokenSource cancellation;
+        private BlockingCollection<BatchFrame> decodedQueue;
+        private BitmapPool decodedPool;
+        private int tracked;
+        private Stopwatch stopwatch = new Stopwatch();
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <summary>
+        /// Open a batch on the tracks. This must run on the UI thread.
+        /// Tracking resumes from the end of the shortest track, but not before the start timestamp, and stops at the end timestamp.
+        /// </summary>
+        public BatchTracker(FrameServerPlayer frameServer, List<DrawingTrack> tracks, long start, long end)
+        {
+            this.frameServer = frameServer;
+            this.tracks = tracks;
+            this.end = end;
+
+            long first = tracks.Count > 0 ? tracks.Min(t => t.EndTimeStamp) : end;
+            this.start = Math.Max(start, first);
+
+            foreach (DrawingTrack track in tracks)
+                track.BeginBatch();
+        }
+
+        /// <summary>
+        /// Decode and track all the frames.
+        /// This runs in the background worker thread and reports progress as frames are tracked.
+        /// </summary>
+        public void Run(BackgroundWorker worker)
+        {
+            Thread.CurrentThread.Name = "BatchTracking";
+
+            if (tracks.Count == 0 || start >= end)
+                return;
+
+            reader = frameServer.OpenSecondaryReader();
+            if (reader == null)
+            {
+                log.Error("Batch tracking: the video could not be opened.");
+                Failed = true;
+                return;
+            }
+
+            double interval = reader.Info.AverageTimeStampsPerFrame;
+            int total = Math.Max(1, (int)Math.Ceiling((end - start) / interval));
+
+            cancellation = new CancellationTokenSource();
+            decodedQueue = new BlockingCollection<BatchFrame>(QueueCapacity);
+            Thread decodeThread = new Thread(Decode) { IsBackground = true, Name = "BatchTrackingDecode" };
+
+            stopwatch.Restart();
+            decodeThread.Start();
+
+            try
+            {
+                foreach (BatchFrame frame in decodedQueue.GetConsumingEnumerable())
+                {
+                    // The trackers only read the image, they get a view over the pixels of the pooled bitmap.
+                    using (MatView view = new MatView(frame.Image))
+                    {
+                        var cvImage = view.Mat;
+                        Parallel.ForEach(tracks, t => t.PerformBatchTracking(frame.Timestamp, cvImage));
+                    }
+
+                    decodedPool.Release(frame.Image);
+                    tracked++;
+                    worker.ReportProgress(tracked, total);
+
+                    if (worker.CancellationPending)
+                        break;
+                }
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while tracking frames. {0}", e);
+                Failed = true;
+            }
+            finally
+            {
+                cancellation.Cancel();
+                decodeThread.Join();
+
+                if (decodedPool != null)
+                    decodedPool.Dispose();
+
+                decodedQueue.Dispose();
+                cancellation.Dispose();
+
+                reader.Close();
+                IDisposable disposable = reader as IDisposable;
+                if (disposable != null)
+                    disposable.Dispose();
+            }
+
+            log.DebugFormat("Batch tracking: {0} frames in {1} ms.", tracked, stopwatch.ElapsedMilliseconds);
+        }
+
+        /// <summary>
+        /// Add the tracked points to the tracks, as a single undoable step. This must run on the UI thread once Run has returned.
+        /// Whatever was tracked before a cancellation is kept.
+        /// </summary>
+        public void Commit()
+        {
+            Metadata metadata = frameServer.Metadata;
+            HistoryMementoGroup memento = new HistoryMementoGroup(ScreenManagerLang.tracking_TrackWorkingZone);
+            foreach (DrawingTrack track in tracks)
+            {
+                if (track.HasBatchPoints)
+                    memento.Add(new HistoryMementoModifyDrawing(metadata, metadata.TrackManager.Id, track.Id, track.Name, SerializationFilter.Core));
+            }
+
+            if (memento.Count > 0)
+                metadata.HistoryStack.PushNewCommand(memento);
+
+            int added = 0;
+            foreach (DrawingTrack track in tracks)
+                added += track.CommitBatch();
+
+            log.DebugFormat("Batch tracking committed {0} points to {1} tracks.", added, tracks.Count);
+        }
+
+        /// <summary>
+        /// Drop the tracked points, the tracks stay as they were before the batch. This must run on the UI thread once Run has returned.
+        /// </summary>
+        public void Discard()
+        {
+            foreach (DrawingTrack track in tracks)
+                track.DiscardBatch();
+        }
+
+        /// <summary>
+        /// Decoding stage. Copies each frame into a bitmap of the pool so the reader can move on to the next one.
+        /// </summary>
+        private void Decode()
+        {
+            CancellationToken token = cancellation.Token;
+            try
+            {
+                long from = reader.Current != null ? reader.Current.Timestamp : 0;
+                bool hasMore = reader.MoveTo(from, start);
+
+                while (!token.IsCancellationRequested)
+                {
+                    VideoFrame vf = reader.Current;
+                    if (vf == null || vf.Timestamp > end)
+                        break;
+
+                    if (decodedPool == null)
+                        decodedPool = new BitmapPool(PoolCapacity, vf.Image.Width, vf.Image.Height, vf.Image.PixelFormat);
+
+                    Bitmap image = decodedPool.Acquire(token);
+                    BitmapHelper.Copy(vf.Image, image, new Rectangle(0, 0, image.Width, image.Height));
+                    decodedQueue.Add(new BatchFrame { Image = image, Timestamp = vf.Timestamp }, token);
+
+                    // The last move may still have placed a frame, frames that were already tracked are ignored by the tracks.
+                    if (!hasMore)
+                        break;
+
+                    hasMore = reader.MoveNext(0, true);
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while decoding frames for tracking. {0}", e);
+                Failed = true;
+            }
+            finally
+            {
+                decodedQueue.CompleteAdding();
+            }
+        }
+    }
+}
@@ -237,6 +237,13 @@ namespace Kinovea.ScreenManager
         private bool isConfiguring = false;
         private bool lastTrackingFailed = false;
 
+        // Batch tracking.
+        // During a batch the new points are accumulated on the side and only added to the timeline at commit.
+        private List<TimedPoint> batchPositions;
+        private int batchCommitted;
+        private bool batchLastFailed;
+        private bool batchStopped;
+
         // Handle ids
         // -1: no hit.
         // In interactive mode: 0: track, 1: current point on track, 2: main label, 3+: keyframe label.
@@ -845,6 +852,10 @@ namespace Kinovea.ScreenManager
         }
         private void DrawTrackerHelp(Graphics canvas, IImageToViewportTransformer transformer, Color color, double opacity)
         {
+            // The tracker data is being updated by the batch tracking thread.
+            if (batchPositions != null)
+                return;
+
             if (isConfiguring || trackStatus == TrackStatus.Edit)
             {
                 tracker.Draw(canvas, positions[drawPointIndex], transformer, styleData.Color, opacity, isConfiguring);
@@ -1613,19 +1624,8 @@ namespace Kinovea.ScreenManager
                 }
             }
 
-            // Check if the tracker is ready to track.
-            if (!tracker.IsReady(lastTrackedPoint))
-            {
-                // Recreate algorithm-specific data from the last position if we don't have it yet.
-                // The user re-opened the track so the last point is considered reference now.
-                // FIXME: we are associating a template extracted from the current image 
-                // at the location of the match in the previous frame so the template won't be 
-                // correctly aligned with the object of interest.
-                tracker.CreateReferenceTrackPoint(lastTrackedPoint, cvImage);
-            }
-
-            TimedPoint tp = null;
-            bool matched = tracker.TrackStep(positions, current.Timestamp, cvImage, out tp);
+            bool matched;
+            TimedPoint tp = TrackStep(positions, current.Timestamp, cvImage, out matched);
             lastTrackingFailed = !matched;
 
             if (tp == null)
@@ -1656,6 +1656,100 @@ namespace Kinovea.ScreenManager
             return tp;
         }
 
+        /// <summary>
+        /// Start a batch of tracking steps outside the play loop.
+        /// Until the batch is committed the new points are kept on the side, 
+        /// the UI thread keeps drawing the timeline as it was.
+        /// </summary>
+        public void BeginBatch()
+        {
+            batchPositions = new List<TimedPoint>(positions);
+            batchCommitted = positions.Count;
+            batchLastFailed = lastTrackingFailed;
+            batchStopped = false;
+        }
+
+        /// <summary>
+        /// Perform tracking at a frame of the batch.
+        /// Frames must be passed in order. Frames up to the end of the track are ignored.
+        ///
+        /// Threading: this runs in a parallel-for on the batch tracking thread.
+        /// </summary>
+        public void PerformBatchTracking(long timestamp, OpenCvSharp.Mat cvImage)
+        {
+            if (batchPositions == null || batchStopped || batchPositions.Count == 0)
+                return;
+
+            if (timestamp <= batchPositions.Last().T)
+                return;
+
+            bool matched;
+            TimedPoint tp = TrackStep(batchPositions, timestamp, cvImage, out matched);
+            batchLastFailed = !matched;
+
+            if (tp == null)
+            {
+                // Same as stopping the tracking in the play loop, but this is deferred to the commit.
+                batchStopped = true;
+                return;
+            }
+
+            batchPositions.Add(tp);
+        }
+
+        /// <summary>
+        /// Whether the batch has points that are not on the timeline yet.
+        /// </summary>
+        public bool HasBatchPoints
+        {
+            get { return batchPositions != null && batchPositions.Count > batchCommitted; }
+        }
+
+        /// <summary>
+        /// Add the points tracked during the batch to the timeline in one go.
+        /// The caller captures the undo state of the batch, for all the tracks at once.
+        /// Must run on the UI thread. Returns the number of points added.
+        /// </summary>
+        public int CommitBatch()
+        {
+            if (batchPositions == null)
+                return 0;
+
+            int added = batchPositions.Count - batchCommitted;
+            if (added > 0)
+            {
+                for (int i = batchCommitted; i < batchPositions.Count; i++)
+                {
+                    positions.Add(batchPositions[i]);
+                    mapTimestampToIndex.Add(batchPositions[i].T, positions.Count - 1);
+                }
+
+                endTimeStamp = positions.Last().T;
+            }
+
+            lastTrackingFailed = batchLastFailed;
+            bool stopped = batchStopped;
+            batchPositions = null;
+
+            if (stopped)
+                StopTracking();
+
+            return added;
+        }
+
+        /// <summary>
+        /// Drop the points tracked during the batch, the timeline stays as it was before the batch.
+        /// Must run on the UI thread.
+        /// </summary>
+        public void DiscardBatch()
+        {
+            batchPositions = null;
+
+            // The tracker kept internal data for the discarded frames, bring it back in line with the timeline.
+            if (positions.Count > 0)
+                tracker.Trim(positions.Last().T);
+        }
+
         /// <summary>
         /// Get a timed point at the passed timestamp.
         /// If an exact match is not found, returns the closest point.
@@ -1678,6 +1772,30 @@ namespace Kinovea.ScreenManager
             return null;
         }
 
+        /// <summary>
+        /// Match the last point of the timeline in the image.
+        /// Returns the new point, or null if the tracker could not create one.
+        /// </summary>
+        private TimedPoint TrackStep(List<TimedPoint> timeline, long timestamp, OpenCvSharp.Mat cvImage, out bool matched)
+        {
+            TimedPoint lastTrackedPoint = timeline.Last();
+
+            // Check if the tracker is ready to track.
+            if (!tracker.IsReady(lastTrackedPoint))
+            {
+                // Recreate algorithm-specific data from the last position if we don't have it yet.
+                // The user re-opened the track so the last point is considered reference now.
+                // FIXME: we are associating a template extracted from the current image 
+                // at the location of the match in the previous frame so the template won't be 
+                // correctly aligned with the object of interest.
+                tracker.CreateReferenceTrackPoint(lastTrackedPoint, cvImage);
+            }
+
+            TimedPoint tp = null;
+            matched = tracker.TrackStep(timeline, timestamp, cvImage, out tp);
+            return tp;
+        }
+
         /// <summary>
         /// The user manually moved a point that had been previously placed.
         /// Reconstruct tracking data (template) stored in the point, for tracking following points.
@@ -64,6 +64,11 @@ namespace Kinovea.ScreenManager
         private Bitmap mask;
         private OpenCvSharp.Mat cvMaskGray = new OpenCvSharp.Mat();
 
+        // Coarse-to-fine search.
+        // The template is never reduced below this size, the coarse match becomes unreliable on very small templates.
+        private const int minCoarseTemplateSize = 8;
+        private const int maxPyramidLevels = 2;
+
         // Debugging.
         private static readonly bool debugging = false;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
@@ -155,7 +160,7 @@ namespace Kinovea.ScreenManager
             }
             
             // Perform the template matching.
-            TemplateMatchResult result = MatchTemplate(cvImage, lastTemplate.Template, lastTrackPoint.Point);
+            TemplateMatchResult result = MatchTemplate(cvImage, lastTemplate, lastTrackPoint.Point);
 
             bool matched = false;
             currentPoint = null;
@@ -201,7 +206,6 @@ namespace Kinovea.ScreenManager
             // The template is captured at the nearest whole pixel location (rounding).
             // It is important that the matching also uses the same rounding.
             TrackingTemplate trackingTemplate = null;
-            Bitmap bmpTemplate = new Bitmap(parameters.BlockWindow.Width, parameters.BlockWindow.Height, PixelFormat.Format32bppPArgb);
 
             // Template update algorithm:
             // - If the match is "poor" we don't update.
@@ -224,10 +228,7 @@ namespace Kinovea.ScreenManager
                 {
                     // In theory we shouldn't need to copy the template here.
                     // Keep just the reference ones in a timeline structure.
-                    bmpTemplate = BitmapHelper.Copy(prevTemplate.Template);
-                    TrackingSource source = TrackingSource.Auto;
-                    trackingTemplate = new TrackingTemplate(time, point, similarity, bmpTemplate, source);
-
+                    trackingTemplate = prevTemplate.Derive(time, point, similarity, TrackingSource.Auto);
                     updateTemplate = false;
                 }
             }
@@ -236,6 +237,7 @@ namespace Kinovea.ScreenManager
             {
                 // We are establishing a new reference template.    
                 // The way we round or truncate the point coordinates is important and sould be coherent between capture and matching.
+                Bitmap bmpTemplate = new Bitmap(parameters.BlockWindow.Width, parameters.BlockWindow.Height, PixelFormat.Format32bppPArgb);
                 PointF pointAligned = new PointF((int)Math.Round(point.X), (int)Math.Round(point.Y));
 
                 int startX = (int)(pointAligned.X - ((int)(bmpTemplate.Width / 2.0f)));
@@ -422,7 +424,7 @@ namespace Kinovea.ScreenManager
         /// This function returns a TrackResult which is just the location and score.
         /// It is the responsibility of the caller to update the template or not.
         /// </summary>
-        private TemplateMatchResult MatchTemplate(Mat cvImage, Bitmap template, PointF lastPoint)
+        private TemplateMatchResult MatchTemplate(Mat cvImage, TrackingTemplate template, PointF lastPoint)
         {
             TemplateMatchResult result;
 
@@ -446,7 +448,14 @@ namespace Kinovea.ScreenManager
             //log.DebugFormat("srchRect:{0}", srchRect);
 
             srchRect.Intersect(new Rectangle(0, 0, cvImage.Width, cvImage.Height));
-            var cvTemplate = BitmapConverter.ToMat(template);
+
+            // Coarse-to-fine: locate the template on reduced images first, 
+            // then only search the neighborhood of the coarse location at full resolution.
+            if (parameters.CoarseToFine)
+                srchRect = NarrowSearchWindow(cvImage, srchRect, template);
+
+            // The template image is owned by the tracking template and reused across frames.
+            var cvTemplate = template.CvTemplate;
             var cvImageROI = cvImage[srchRect.Y, srchRect.Y + srchRect.Height, srchRect.X, srchRect.X + srchRect.Width];
 
             // Make an ellipse mask to avoid matching on the background.
@@ -576,12 +585,106 @@ namespace Kinovea.ScreenManager
             }
 
             cvImageROI.Dispose();
-            cvTemplate.Dispose();
             cvSimiMap.Dispose();
 
             return result;
         }
 
+        /// <summary>
+        /// Performs the matching on reduced versions of the search window and template, 
+        /// and returns the part of the search window around the best coarse candidate.
+        /// Returns the search window unchanged if it is too small to benefit or if the coarse match is poor.
+        /// </summary>
+        private Rectangle NarrowSearchWindow(Mat cvImage, Rectangle srchRect, TrackingTemplate template)
+        {
+            System.Drawing.Size tmplSize = parameters.BlockWindow;
+            int levels = GetPyramidLevels(tmplSize);
+            if (levels == 0 || srchRect.Width < tmplSize.Width * 2 || srchRect.Height < tmplSize.Height * 2)
+                return srchRect;
+
+            Mat cvTemplateCoarse = template.GetCoarseTemplate(levels);
+            Mat cvImageROI = cvImage[srchRect.Y, srchRect.Y + srchRect.Height, srchRect.X, srchRect.X + srchRect.Width];
+            Mat cvImageCoarse = Reduce(cvImageROI, levels);
+            cvImageROI.Dispose();
+
+            if (cvImageCoarse.Width < cvTemplateCoarse.Width || cvImageCoarse.Height < cvTemplateCoarse.Height)
+            {
+                cvImageCoarse.Dispose();
+                return srchRect;
+            }
+
+            // The mask is not used at this level, the coarse pass only has to find the neighborhood of the object.
+            Mat cvSimiMap = new Mat();
+            Cv2.MatchTemplate(cvImageCoarse, cvTemplateCoarse, cvSimiMap, TemplateMatchModes.CCoeffNormed);
+
+            double min = 0;
+            double max = 0;
+            OpenCvSharp.Point minLoc;
+            OpenCvSharp.Point maxLoc;
+            Cv2.MinMaxLoc(cvSimiMap, out min, out max, out minLoc, out maxLoc);
+
+            cvImageCoarse.Dispose();
+            cvSimiMap.Dispose();
+
+            // Downsampling blurs the object, a poor coarse score doesn't mean the object is lost.
+            // Let the exhaustive search decide.
+            if (double.IsInfinity(max) || double.IsNaN(max) || max < parameters.SimilarityThreshold)
+                return srchRect;
+
+            // Back to full resolution. The coarse location is only known to within one coarse pixel.
+            int scale = 1 << levels;
+            int margin = scale + 1;
+            Rectangle fineRect = new Rectangle(
+                srchRect.X + maxLoc.X * scale - margin,
+                srchRect.Y + maxLoc.Y * scale - margin,
+                tmplSize.Width + 2 * margin,
+                tmplSize.Height + 2 * margin);
+
+            fineRect.Intersect(srchRect);
+            if (fineRect.Width < tmplSize.Width || fineRect.Height < tmplSize.Height)
+                return srchRect;
+
+            return fineRect;
+        }
+
+        /// <summary>
+        /// Returns the number of pyramid levels to use for the coarse search.
+        /// </summary>
+        private static int GetPyramidLevels(System.Drawing.Size tmplSize)
+        {
+            int levels = 0;
+            while (levels < maxPyramidLevels &&
+                (tmplSize.Width >> (levels + 1)) >= minCoarseTemplateSize &&
+                (tmplSize.Height >> (levels + 1)) >= minCoarseTemplateSize)
+            {
+                levels++;
+            }
+
+            return levels;
+        }
+
+        /// <summary>
+        /// Returns a new image reduced by half in each dimension, the passed number of times.
+        /// </summary>
+        public static Mat Reduce(Mat src, int levels)
+        {
+            if (levels <= 0)
+                return src.Clone();
+
+            Mat current = src;
+            for (int i = 0; i < levels; i++)
+            {
+                Mat next = new Mat();
+                Cv2.PyrDown(current, next);
+                if (current != src)
+                    current.Dispose();
+
+                current = next;
+            }
+
+            return current;
+        }
+
         /// <summary>
         /// Computes the center of mass of the similarity scores in the 3x3 neighborhood of the best candidate.
         /// Returns the center of mass as the refined point.
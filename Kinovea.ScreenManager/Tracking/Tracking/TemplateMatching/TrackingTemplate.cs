@@ -59,6 +59,21 @@ namespace Kinovea.ScreenManager
             get { return template; }
         }
 
+        /// <summary>
+        /// Template as an OpenCV image, for the matching.
+        /// Converted from the bitmap on first use and kept for the following frames.
+        /// </summary>
+        public OpenCvSharp.Mat CvTemplate
+        {
+            get
+            {
+                if (cvTemplate == null && template != null)
+                    cvTemplate = OpenCvSharp.Extensions.BitmapConverter.ToMat(template);
+
+                return cvTemplate;
+            }
+        }
+
         /// <summary>
         /// The similarity score of the template with regards to the 
         /// previous reference template.
@@ -101,6 +116,9 @@ namespace Kinovea.ScreenManager
         private float score;
         private Bitmap template;
         private TrackingSource positionningSource;
+        private OpenCvSharp.Mat cvTemplate;
+        private OpenCvSharp.Mat cvTemplateCoarse;
+        private int coarseLevels;
                 
         public TrackingTemplate(long time, PointF location, float score, Bitmap template, TrackingSource positionningSource)
         {
@@ -111,6 +129,43 @@ namespace Kinovea.ScreenManager
             this.positionningSource = positionningSource;
         }
 
+        /// <summary>
+        /// Creates the template of a later frame when the image is not updated.
+        /// The OpenCV images already computed are carried over so they are not converted again.
+        /// </summary>
+        public TrackingTemplate Derive(long time, PointF location, float score, TrackingSource positionningSource)
+        {
+            TrackingTemplate derived = new TrackingTemplate(time, location, score, BitmapHelper.Copy(template), positionningSource);
+
+            if (cvTemplate != null)
+                derived.cvTemplate = cvTemplate.Clone();
+
+            if (cvTemplateCoarse != null)
+            {
+                derived.cvTemplateCoarse = cvTemplateCoarse.Clone();
+                derived.coarseLevels = coarseLevels;
+            }
+
+            return derived;
+        }
+
+        /// <summary>
+        /// Returns the template reduced by the number of pyramid levels, for the coarse search.
+        /// Computed on first use and kept for the following frames.
+        /// </summary>
+        public OpenCvSharp.Mat GetCoarseTemplate(int levels)
+        {
+            if (cvTemplateCoarse != null && coarseLevels == levels)
+                return cvTemplateCoarse;
+
+            if (cvTemplateCoarse != null)
+                cvTemplateCoarse.Dispose();
+
+            cvTemplateCoarse = TrackerTemplateMatching.Reduce(CvTemplate, levels);
+            coarseLevels = levels;
+            return cvTemplateCoarse;
+        }
+
         public void Dispose()
         {
             Dispose(true);
@@ -128,6 +183,12 @@ namespace Kinovea.ScreenManager
             {
                 if (template != null)
                     template.Dispose();
+
+                if (cvTemplate != null)
+                    cvTemplate.Dispose();
+
+                if (cvTemplateCoarse != null)
+                    cvTemplateCoarse.Dispose();
             }
         }
     }
@@ -0,0 +1,50 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Several mementos undone and redone together as a single command.
+    /// </summary>
+    public class HistoryMementoGroup : HistoryMemento
+    {
+        public override string CommandName
+        {
+            get { return commandName; }
+            set { commandName = value; }
+        }
+
+        public int Count
+        {
+            get { return mementos.Count; }
+        }
+
+        private List<HistoryMemento> mementos = new List<HistoryMemento>();
+        private string commandName;
+
+        public HistoryMementoGroup(string commandName)
+        {
+            this.commandName = commandName;
+        }
+
+        public void Add(HistoryMemento memento)
+        {
+            mementos.Add(memento);
+        }
+
+        /// <summary>
+        /// Undo the mementos in the reverse order they were added.
+        /// The redo mementos are grouped in the same order, so redoing also runs in reverse.
+        /// </summary>
+        public override HistoryMemento PerformUndo()
+        {
+            HistoryMementoGroup redoMemento = new HistoryMementoGroup(commandName);
+            for (int i = mementos.Count - 1; i >= 0; i--)
+                redoMemento.mementos.Insert(0, mementos[i].PerformUndo());
+
+            return redoMemento;
+        }
+    }
+}
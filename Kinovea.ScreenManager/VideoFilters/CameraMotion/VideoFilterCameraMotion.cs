@@ -247,6 +247,9 @@ namespace Kinovea.ScreenManager
             this.framesContainer = framesContainer;
             if (framesContainer != null && framesContainer.Frames != null && framesContainer.Frames.Count > 0)
                 frameSize = framesContainer.Frames[0].Image.Size;
+
+            // Features computed on this file in a previous run are reused from the cache.
+            tracker.VideoPath = parentMetadata.VideoPath;
         }
         public void UpdateSize(Size size)
         {
@@ -553,9 +556,11 @@ namespace Kinovea.ScreenManager
                 case CameraMotionStep.FindFeatures:
                     MakeMask();
                     tracker.FindFeatures(framesContainer, worker);
+                    tracker.SaveCache();
                     break;
                 case CameraMotionStep.MatchFeatures:
                     tracker.MatchFeatures(framesContainer, worker);
+                    tracker.SaveCache();
                     break;
                 case CameraMotionStep.FindHomographies:
                     tracker.FindHomographies(framesContainer, worker);
@@ -1125,8 +1130,12 @@ namespace Kinovea.ScreenManager
                 }
             }
 
+            // Remove any previous mask, it is part of the identity of the cached features.
             if (rr.Count == 0)
+            {
+                tracker.SetMask(null);
                 return;
+            }
 
             // Create the mask and send it to the tracker.
             Bitmap mask = new Bitmap(frameSize.Width, frameSize.Height);
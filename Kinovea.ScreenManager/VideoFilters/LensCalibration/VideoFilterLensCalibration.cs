@@ -613,11 +613,8 @@ namespace Kinovea.ScreenManager
                 int index = indices[i];
                 var f = framesContainer.Frames[index];
 
-                // Convert image to OpenCV and convert to grayscale.
-                var cvImage = OpenCvSharp.Extensions.BitmapConverter.ToMat(f.Image);
-                var cvImageGray = new OpenCvSharp.Mat();
-                OpenCvSharp.Cv2.CvtColor(cvImage, cvImageGray, OpenCvSharp.ColorConversionCodes.BGR2GRAY, 0);
-                cvImage.Dispose();
+                // Convert image to grayscale, straight from the frame pixels.
+                var cvImageGray = MatView.ToGray(f.Image);
 
                 // Find checkerboard corners in the image.
                 var corners = new OpenCvSharp.Mat<OpenCvSharp.Point2f>();
@@ -49,7 +49,16 @@ namespace Kinovea.Services.TurboJpeg
             TJFLAG flags
             );
 
-        // tjBufSize
+        /// <summary>
+        /// The maximum size of the buffer (in bytes) required to hold a JPEG image with the given parameters. 
+        /// </summary>
+        /// <param name="width">width (in pixels) of the image </param>
+        /// <param name="height">height (in pixels) of the image </param>
+        /// <param name="jpegSubsamp">the level of chrominance subsampling to be used when generating the JPEG image (see Chrominance subsampling options.) </param>
+        /// <returns>the maximum size of the buffer (in bytes) required to hold the image, or -1 if the arguments are out of bounds. </returns>
+        [DllImport(turbojpeg)]
+        public static extern uint tjBufSize(int width, int height, TJSAMP jpegSubsamp);
+
         // tjBufSizeYUV
         // tjEncodeYUV2
 
@@ -135,7 +144,15 @@ namespace Kinovea.Services.TurboJpeg
         [DllImport(turbojpeg)]
         public static extern int tjDestroy(IntPtr handle);
 
-        // tjAlloc
+        /// <summary>
+        /// Allocate an image buffer for use with TurboJPEG. 
+        /// You should always use this function to allocate the JPEG destination buffer(s) for tjCompress2() and tjTransform() 
+        /// unless you are disabling automatic buffer (re)allocation (by setting TJFLAG_NOREALLOC.)
+        /// </summary>
+        /// <param name="bytes">the number of bytes to allocate </param>
+        /// <returns>a pointer to a newly-allocated buffer with the specified number of bytes. </returns>
+        [DllImport(turbojpeg)]
+        public static extern IntPtr tjAlloc(int bytes);
 
         /// <summary>
         /// Free an image buffer previously allocated by TurboJPEG.
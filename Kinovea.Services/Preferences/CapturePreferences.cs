@@ -58,6 +58,22 @@ namespace Kinovea.Services
             get { BeforeRead(); return memoryBuffer; }
             set { memoryBuffer = value; Save(); }
         }
+        /// <summary>
+        /// Whether frames are stored JPEG-compressed in the delay buffer, for longer delays in the same memory.
+        /// </summary>
+        public bool DelayCompression
+        {
+            get { BeforeRead(); return delayCompression; }
+            set { delayCompression = value; Save(); }
+        }
+        /// <summary>
+        /// JPEG quality of the frames stored in the delay buffer when compression is enabled.
+        /// </summary>
+        public int DelayCompressionQuality
+        {
+            get { BeforeRead(); return delayCompressionQuality; }
+            set { delayCompressionQuality = value; Save(); }
+        }
         public IEnumerable<CameraBlurb> CameraBlurbs
         {
             get { BeforeRead(); return cameraBlurbs.Values.Cast<CameraBlurb>(); }
@@ -72,6 +88,22 @@ namespace Kinovea.Services
             get { BeforeRead(); return saveUncompressedVideo; }
             set { saveUncompressedVideo = value; Save(); }
         }
+        /// <summary>
+        /// Number of threads encoding frames in parallel during real time recording. 0 for automatic.
+        /// </summary>
+        public int RecordingEncoderThreads
+        {
+            get { BeforeRead(); return recordingEncoderThreads; }
+            set { recordingEncoderThreads = value; Save(); }
+        }
+        /// <summary>
+        /// Encoder used for compressed recordings.
+        /// </summary>
+        public EncoderSettings RecordingEncoderSettings
+        {
+            get { BeforeRead(); return recordingEncoderSettings.Clone(); }
+            set { recordingEncoderSettings = value; Save(); }
+        }
         public CaptureAutomationConfiguration CaptureAutomationConfiguration
         {
             get { BeforeRead(); return captureAutomationConfiguration; }
@@ -124,8 +156,12 @@ namespace Kinovea.Services
         private double displaySynchronizationFramerate = 25.0;
         private CaptureRecordingMode recordingMode = CaptureRecordingMode.Delay;
         private bool saveUncompressedVideo;
+        private int recordingEncoderThreads = 0;
+        private EncoderSettings recordingEncoderSettings = new EncoderSettings(EncoderProfile.MJPEG);
         private bool verboseStats = false;
         private int memoryBuffer = 768;
+        private bool delayCompression = false;
+        private int delayCompressionQuality = 90;
         private Dictionary<string, CameraBlurb> cameraBlurbs = new Dictionary<string, CameraBlurb>();
         private PhotofinishConfiguration photofinishConfiguration = new PhotofinishConfiguration();
         private CaptureAutomationConfiguration captureAutomationConfiguration = new CaptureAutomationConfiguration();
@@ -229,8 +265,15 @@ namespace Kinovea.Services
             writer.WriteElementString("CaptureRecordingMode", recordingMode.ToString());
             writer.WriteElementString("VerboseStats", verboseStats ? "true" : "false");
             writer.WriteElementString("SaveUncompressedVideo", saveUncompressedVideo ? "true" : "false");
+            writer.WriteElementString("RecordingEncoderThreads", recordingEncoderThreads.ToString());
+
+            writer.WriteStartElement("RecordingEncoder");
+            recordingEncoderSettings.WriteXml(writer);
+            writer.WriteEndElement();
             
             writer.WriteElementString("MemoryBuffer", memoryBuffer.ToString());
+            writer.WriteElementString("DelayCompression", delayCompression ? "true" : "false");
+            writer.WriteElementString("DelayCompressionQuality", delayCompressionQuality.ToString());
             
             if(cameraBlurbs.Count > 0)
             {
@@ -291,12 +334,24 @@ namespace Kinovea.Services
                     case "SaveUncompressedVideo":
                         saveUncompressedVideo = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
                         break;
+                    case "RecordingEncoderThreads":
+                        recordingEncoderThreads = reader.ReadElementContentAsInt();
+                        break;
+                    case "RecordingEncoder":
+                        recordingEncoderSettings.ReadXml(reader);
+                        break;
                     case "VerboseStats":
                         verboseStats = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
                         break;
                     case "MemoryBuffer":
                         memoryBuffer = reader.ReadElementContentAsInt();
                         break;
+                    case "DelayCompression":
+                        delayCompression = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
+                        break;
+                    case "DelayCompressionQuality":
+                        delayCompressionQuality = reader.ReadElementContentAsInt();
+                        break;
                     case "Cameras":
                         ParseCameras(reader);
                         break;
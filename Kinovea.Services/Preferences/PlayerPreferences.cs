@@ -122,6 +122,11 @@ namespace Kinovea.Services
             get { BeforeRead(); return workingZoneMemory; }
             set { workingZoneMemory = value; Save(); }
         }
+        public DecoderThreading DecoderThreading
+        {
+            get { BeforeRead(); return decoderThreading; }
+            set { decoderThreading = value; Save(); }
+        }
         public bool ShowCacheInTimeline
         {
             get { BeforeRead(); return showCacheInTimeline; }
@@ -228,6 +233,15 @@ namespace Kinovea.Services
             set { cameraMotionParameters = value; Save(); }
         }
 
+        /// <summary>
+        /// Encoder used when exporting videos.
+        /// </summary>
+        public EncoderSettings ExportEncoderSettings
+        {
+            get { BeforeRead(); return exportEncoderSettings.Clone(); }
+            set { exportEncoderSettings = value; Save(); }
+        }
+
         public KeyframePresetsParameters KeyframePresets
         {
             get { BeforeRead(); return keyframePresetsParameters.Clone(); }
@@ -266,6 +280,7 @@ namespace Kinovea.Services
         private bool deinterlaceByDefault;
         private bool interactiveFrameTracker = true;
         private int workingZoneMemory = 768;
+        private DecoderThreading decoderThreading = DecoderThreading.Auto;
         private InfosFading defaultFading = new InfosFading();
         private bool enablePixelFiltering = true;
         private bool drawOnPlay = true;
@@ -286,6 +301,7 @@ namespace Kinovea.Services
         private KinogramParameters kinogramParameters = new KinogramParameters();
         private LensCalibrationParameters lensCalibrationParameters = new LensCalibrationParameters();
         private CameraMotionParameters cameraMotionParameters = new CameraMotionParameters();
+        private EncoderSettings exportEncoderSettings = new EncoderSettings(EncoderProfile.MPEG4);
         private KeyframePresetsParameters keyframePresetsParameters = new KeyframePresetsParameters();
         private bool showCacheInTimeline = false;
         private bool sideBySideHorizontal = true;
@@ -329,6 +345,7 @@ namespace Kinovea.Services
             writer.WriteElementString("DeinterlaceByDefault", XmlHelper.WriteBoolean(deinterlaceByDefault));
             writer.WriteElementString("InteractiveFrameTracker", XmlHelper.WriteBoolean(interactiveFrameTracker));
             writer.WriteElementString("WorkingZoneMemory", workingZoneMemory.ToString());
+            writer.WriteElementString("DecoderThreading", decoderThreading.ToString());
             writer.WriteElementString("ShowCacheInTimeline", XmlHelper.WriteBoolean(showCacheInTimeline));
             writer.WriteElementString("SyncLockSpeed", XmlHelper.WriteBoolean(syncLockSpeed));
             writer.WriteElementString("SyncByMotion", XmlHelper.WriteBoolean(syncByMotion));
@@ -382,6 +399,10 @@ namespace Kinovea.Services
             cameraMotionParameters.WriteXml(writer);
             writer.WriteEndElement();
 
+            writer.WriteStartElement("ExportEncoder");
+            exportEncoderSettings.WriteXml(writer);
+            writer.WriteEndElement();
+
             writer.WriteStartElement("KeyframePresets");
             keyframePresetsParameters.WriteXml(writer);
             writer.WriteEndElement();
@@ -449,6 +470,9 @@ namespace Kinovea.Services
                     case "WorkingZoneMemory":
                         workingZoneMemory = reader.ReadElementContentAsInt();
                         break;
+                    case "DecoderThreading":
+                        decoderThreading = XmlHelper.ParseEnum(reader.ReadElementContentAsString(), DecoderThreading.Auto);
+                        break;
                     case "ShowCacheInTimeline":
                         showCacheInTimeline = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
                         break;
@@ -510,6 +534,9 @@ namespace Kinovea.Services
                     case "CameraMotion":
                         cameraMotionParameters.ReadXml(reader);
                         break;
+                    case "ExportEncoder":
+                        exportEncoderSettings.ReadXml(reader);
+                        break;
                     case "KeyframePresets":
                         keyframePresetsParameters.ReadXml(reader);
                         break;
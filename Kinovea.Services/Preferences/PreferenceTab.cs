@@ -16,6 +16,7 @@ namespace Kinovea.Services
         Player_General,
         Player_Memory,
         Player_Image,
+        Player_Export,
 
         Drawings_General,
         Drawings_Opacity,
@@ -26,6 +27,7 @@ namespace Kinovea.Services
         Capture_General,
         Capture_Memory,
         Capture_Recording,
+        Capture_Compression,
         Capture_Paths,
         Capture_Files,
         Capture_Trigger,
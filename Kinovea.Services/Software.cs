@@ -103,6 +103,12 @@ namespace Kinovea.Services
         /// Directory where auto-save KVA files are stored.
         /// </summary>
         public static string TempDirectory { get; private set; }
+
+        /// <summary>
+        /// Data that can be regenerated from the media files themselves.
+        /// Stream probe results, keyframe indexes, thumbnails.
+        /// </summary>
+        public static string CacheDirectory { get; private set; }
         
         /// <summary>
         /// Collection of settings for cameras.
@@ -140,6 +146,7 @@ namespace Kinovea.Services
 
             PreferencesFile             = Path.Combine(SettingsDirectory, "Preferences.xml");
 
+            CacheDirectory              = Path.Combine(SettingsDirectory, "Cache");
             CameraCalibrationDirectory  = Path.Combine(SettingsDirectory, "CameraCalibration");
             CameraProfilesDirectory     = Path.Combine(SettingsDirectory, "CameraProfiles");
             ColorProfileDirectory       = Path.Combine(SettingsDirectory, "ColorProfiles");
@@ -169,6 +176,7 @@ namespace Kinovea.Services
         /// </summary>
         public static void SanityCheckDirectories()
         {
+            CreateDirectory(CacheDirectory);
             CreateDirectory(CameraCalibrationDirectory);
             CreateDirectory(CameraPluginsDirectory);
             CreateDirectory(CameraProfilesDirectory);
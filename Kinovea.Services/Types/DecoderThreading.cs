@@ -0,0 +1,21 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Kinovea.Services
+{
+    /// <summary>
+    /// Threading model used by the video decoder.
+    /// Frame threading decodes several frames in parallel and adds a delay of one frame per thread.
+    /// Slice threading splits a single frame and only works on files encoded with multiple slices.
+    /// </summary>
+    public enum DecoderThreading
+    {
+        Auto,
+        Frame,
+        Slice,
+        Off
+    }
+}
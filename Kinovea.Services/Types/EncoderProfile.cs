@@ -0,0 +1,30 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Kinovea.Services
+{
+    /// <summary>
+    /// Encoder and encoding mode used when writing videos.
+    /// The intra-only profiles encode every frame independently, for frame-accurate review.
+    /// </summary>
+    public enum EncoderProfile
+    {
+        /// <summary>MPEG-4 part 2 at constant quantizer. Historical export format.</summary>
+        MPEG4,
+        /// <summary>Motion JPEG at constant quantizer. Intra-only. Historical capture format.</summary>
+        MJPEG,
+        /// <summary>H.264 (libx264) at constant rate factor.</summary>
+        H264,
+        /// <summary>H.265 (libx265) at constant rate factor.</summary>
+        H265,
+        /// <summary>H.264 (libx264) at constant rate factor, every frame is a keyframe.</summary>
+        H264Intra,
+        /// <summary>FFV1 lossless. Intra-only.</summary>
+        FFV1,
+        /// <summary>ProRes 422 HQ. Intra-only.</summary>
+        ProRes
+    }
+}
@@ -0,0 +1,124 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+using System.Xml;
+using System.Globalization;
+
+namespace Kinovea.Services
+{
+    /// <summary>
+    /// Encoder profile and its parameters, shared by the video export and the capture recording.
+    /// </summary>
+    public class EncoderSettings
+    {
+        #region Properties
+
+        /// <summary>
+        /// Encoder and encoding mode.
+        /// </summary>
+        public EncoderProfile Profile { get; set; } = EncoderProfile.MPEG4;
+
+        /// <summary>
+        /// Constant rate factor for the H.264 and H.265 profiles. 
+        /// Lower is better quality, 18 is visually lossless for H.264.
+        /// </summary>
+        public int Crf { get; set; } = 18;
+
+        /// <summary>
+        /// Speed preset for the H.264 and H.265 profiles, from "ultrafast" to "veryslow".
+        /// </summary>
+        public string Preset { get; set; } = "veryfast";
+
+        /// <summary>
+        /// Number of threads used by the encoder. 0 for automatic.
+        /// </summary>
+        public int Threads { get; set; } = 0;
+
+        /// <summary>
+        /// Whether the profile encodes every frame independently.
+        /// </summary>
+        public bool IsIntraOnly
+        {
+            get
+            {
+                return Profile == EncoderProfile.MJPEG || Profile == EncoderProfile.H264Intra ||
+                    Profile == EncoderProfile.FFV1 || Profile == EncoderProfile.ProRes;
+            }
+        }
+
+        /// <summary>
+        /// Whether the profile is driven by the constant rate factor and the speed preset.
+        /// </summary>
+        public bool HasRateFactor
+        {
+            get
+            {
+                return Profile == EncoderProfile.H264 || Profile == EncoderProfile.H265 || Profile == EncoderProfile.H264Intra;
+            }
+        }
+        #endregion
+
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        public EncoderSettings()
+        {
+        }
+
+        public EncoderSettings(EncoderProfile profile)
+        {
+            this.Profile = profile;
+        }
+
+        public EncoderSettings Clone()
+        {
+            EncoderSettings clone = new EncoderSettings();
+            clone.Profile = this.Profile;
+            clone.Crf = this.Crf;
+            clone.Preset = this.Preset;
+            clone.Threads = this.Threads;
+            return clone;
+        }
+
+        #region Serialization
+        public void ReadXml(XmlReader r)
+        {
+            r.ReadStartElement();
+
+            while (r.NodeType == XmlNodeType.Element)
+            {
+                switch (r.Name)
+                {
+                    case "Profile":
+                        Profile = XmlHelper.ParseEnum<EncoderProfile>(r.ReadElementContentAsString(), Profile);
+                        break;
+                    case "Crf":
+                        Crf = int.Parse(r.ReadElementContentAsString(), CultureInfo.InvariantCulture);
+                        break;
+                    case "Preset":
+                        Preset = r.ReadElementContentAsString();
+                        break;
+                    case "Threads":
+                        Threads = int.Parse(r.ReadElementContentAsString(), CultureInfo.InvariantCulture);
+                        break;
+                    default:
+                        string outerXml = r.ReadOuterXml();
+                        log.DebugFormat("Unparsed content in XML: {0}", outerXml);
+                        break;
+                }
+            }
+
+            r.ReadEndElement();
+        }
+
+        public void WriteXml(XmlWriter w)
+        {
+            w.WriteElementString("Profile", Profile.ToString());
+            w.WriteElementString("Crf", Crf.ToString(CultureInfo.InvariantCulture));
+            w.WriteElementString("Preset", Preset);
+            w.WriteElementString("Threads", Threads.ToString(CultureInfo.InvariantCulture));
+        }
+        #endregion
+    }
+}
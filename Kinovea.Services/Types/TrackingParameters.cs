@@ -105,6 +105,16 @@ namespace Kinovea.Services
             set { useMask = value; }
         }
 
+        /// <summary>
+        /// Whether to locate the template on reduced images before the full resolution search.
+        /// Much faster on large search windows, may miss very small or thin objects.
+        /// </summary>
+        public bool CoarseToFine
+        {
+            get { return coarseToFine; }
+            set { coarseToFine = value; }
+        }
+
         /// <summary>
         /// HSV filter range.
         /// Used for blob detection.
@@ -145,6 +155,7 @@ namespace Kinovea.Services
                 hash ^= similarityThreshold.GetHashCode();
                 hash ^= templateUpdateThreshold.GetHashCode();
                 hash ^= useMask.GetHashCode();
+                hash ^= coarseToFine.GetHashCode();
                 hash ^= hsvRange.ContentHash;
                 hash ^= dilate.GetHashCode();
                 hash ^= erode.GetHashCode();
@@ -160,6 +171,7 @@ namespace Kinovea.Services
         private double similarityThreshold = 0.5;
         private double templateUpdateThreshold = 0.8; // using CCORR : 0.90 or 0.95, when using CCOEFF : 0.80.
         private bool useMask = false;
+        private bool coarseToFine = false;
         private bool resetOnMove = true;
         private int maxWindowSize = 400;
         private HSVRange hsvRange = new HSVRange();
@@ -181,6 +193,7 @@ namespace Kinovea.Services
             clone.similarityThreshold = this.similarityThreshold;
             clone.templateUpdateThreshold = this.templateUpdateThreshold;
             clone.useMask = this.useMask;
+            clone.coarseToFine = this.coarseToFine;
             clone.hsvRange = this.hsvRange.Clone();
             clone.dilate = this.dilate;
             clone.erode = this.erode;
@@ -196,6 +209,7 @@ namespace Kinovea.Services
             w.WriteElementString("SimilarityThreshold", XmlHelper.WriteFloat((float)similarityThreshold));
             w.WriteElementString("TemplateUpdateThreshold", XmlHelper.WriteFloat((float)templateUpdateThreshold));
             w.WriteElementString("UseMask", XmlHelper.WriteBoolean(useMask));
+            w.WriteElementString("CoarseToFine", XmlHelper.WriteBoolean(coarseToFine));
             w.WriteStartElement("HSVRange");
             hsvRange.WriteXml(w);
             w.WriteEndElement();
@@ -229,6 +243,9 @@ namespace Kinovea.Services
                     case "UseMask":
                         useMask = XmlHelper.ParseBoolean(r.ReadElementContentAsString());
                         break;
+                    case "CoarseToFine":
+                        coarseToFine = XmlHelper.ParseBoolean(r.ReadElementContentAsString());
+                        break;
                     case "HSVRange":
                         hsvRange.ReadXml(r);
                         break;
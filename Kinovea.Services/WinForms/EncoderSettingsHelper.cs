@@ -0,0 +1,52 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+using System.Windows.Forms;
+
+namespace Kinovea.Services
+{
+    /// <summary>
+    /// Fills the controls used to pick an encoder profile and its parameters in the preferences.
+    /// </summary>
+    public static class EncoderSettingsHelper
+    {
+        /// <summary>
+        /// Speed presets of the H.264 and H.265 encoders, from fastest to slowest.
+        /// </summary>
+        public static readonly string[] Presets = { 
+            "ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow" 
+        };
+
+        /// <summary>
+        /// Fills the combo with the encoder profiles, in the order of the enum, and selects the current one.
+        /// </summary>
+        public static void FillProfiles(ComboBox cmb, EncoderProfile selected)
+        {
+            cmb.Items.Clear();
+            cmb.Items.Add("MPEG-4");
+            cmb.Items.Add("Motion JPEG");
+            cmb.Items.Add("H.264");
+            cmb.Items.Add("H.265");
+            cmb.Items.Add("H.264 (intra-only)");
+            cmb.Items.Add("FFV1 (lossless)");
+            cmb.Items.Add("ProRes 422 HQ");
+
+            int index = (int)selected;
+            cmb.SelectedIndex = index < cmb.Items.Count ? index : 0;
+        }
+
+        /// <summary>
+        /// Fills the combo with the speed presets and selects the current one.
+        /// </summary>
+        public static void FillPresets(ComboBox cmb, string selected)
+        {
+            cmb.Items.Clear();
+            cmb.Items.AddRange(Presets);
+
+            int index = Array.IndexOf(Presets, selected);
+            cmb.SelectedIndex = index >= 0 ? index : Array.IndexOf(Presets, "veryfast");
+        }
+    }
+}
@@ -63,6 +63,33 @@ namespace Kinovea.Tests.Kinematics
                 frame.Dispose();*/
         }
 
+        /// <summary>
+        /// Renders a frame in memory with a textured disc moving along the trajectory.
+        /// The disc moves horizontally at the object speed on top of the vertical acceleration.
+        /// Returns the true position of the center of the disc.
+        /// </summary>
+        public PointF RenderFrame(Bitmap bmp, int frame, double fps, double a, MovingObject o)
+        {
+            double t = GetTime(frame, fps);
+            PointF position = GetPosition(t, a);
+            position.X += (float)(o.SpeedX * t);
+
+            using (Graphics g = Graphics.FromImage(bmp))
+            {
+                g.PixelOffsetMode = PixelOffsetMode.Half;
+                g.SmoothingMode = SmoothingMode.HighQuality;
+                g.Clear(Color.White);
+
+                // Alternate quadrants so the disc has structure in both directions, like a tracking marker.
+                RectangleF rect = new RectangleF(position.X - o.Radius, position.Y - o.Radius, o.Radius * 2, o.Radius * 2);
+                g.FillEllipse(Brushes.Black, rect);
+                g.FillPie(Brushes.White, rect.X, rect.Y, rect.Width, rect.Height, 0, 90);
+                g.FillPie(Brushes.White, rect.X, rect.Y, rect.Width, rect.Height, 180, 90);
+            }
+
+            return position;
+        }
+
         private void DrawImage(Graphics g, PointF location, int frame, double t, double a, int width, int height, double duration, double fps, MovingObject o)
         {
             g.InterpolationMode = InterpolationMode.HighQualityBicubic;
@@ -0,0 +1,92 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Runtime.InteropServices;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Synthetic frames and statistics shared by the benchmarks.
+    /// </summary>
+    public static class BenchmarkHelper
+    {
+        /// <summary>
+        /// Number of distinct frames cycled through by the benchmarks, so the encoders don't see the exact same image every time.
+        /// </summary>
+        public const int DistinctFrames = 8;
+
+        /// <summary>
+        /// Value at the given rank (0 to 1) of an array sorted in ascending order.
+        /// </summary>
+        public static double Percentile(double[] sorted, double p)
+        {
+            int index = (int)Math.Ceiling(p * sorted.Length) - 1;
+            return sorted[Math.Max(0, Math.Min(sorted.Length - 1, index))];
+        }
+
+        /// <summary>
+        /// Creates a few distinct raw frames with the given number of bytes per pixel and no row padding.
+        /// </summary>
+        public static List<byte[]> CreateFrames(Size size, int bpp)
+        {
+            List<byte[]> frames = new List<byte[]>();
+            Random random = new Random(0);
+            for (int i = 0; i < DistinctFrames; i++)
+                frames.Add(CreateFrame(size, bpp, i, random));
+
+            return frames;
+        }
+
+        /// <summary>
+        /// Creates a few distinct 32bpp images.
+        /// </summary>
+        public static List<Bitmap> CreateImages(Size size)
+        {
+            List<Bitmap> images = new List<Bitmap>();
+            Random random = new Random(0);
+            for (int i = 0; i < DistinctFrames; i++)
+                images.Add(CreateImage(size, i, random));
+
+            return images;
+        }
+
+        private static byte[] CreateFrame(Size size, int bpp, int seed, Random random)
+        {
+            // Diagonal gradient with some noise, roughly the entropy of a real camera image.
+            int stride = size.Width * bpp;
+            byte[] buffer = new byte[stride * size.Height];
+            for (int y = 0; y < size.Height; y++)
+            {
+                for (int x = 0; x < stride; x++)
+                    buffer[y * stride + x] = (byte)(((x / bpp + y + seed * 16) & 0xFF) ^ (random.Next(16)));
+            }
+
+            return buffer;
+        }
+
+        private static Bitmap CreateImage(Size size, int seed, Random random)
+        {
+            // Gradient with some noise, roughly the entropy of a real video frame.
+            Bitmap bmp = new Bitmap(size.Width, size.Height, PixelFormat.Format32bppPArgb);
+            BitmapData data = bmp.LockBits(new Rectangle(Point.Empty, size), ImageLockMode.WriteOnly, bmp.PixelFormat);
+            byte[] row = new byte[data.Stride];
+            for (int y = 0; y < size.Height; y++)
+            {
+                for (int x = 0; x < size.Width; x++)
+                {
+                    byte value = (byte)(((x + y + seed * 16) & 0xFF) ^ random.Next(16));
+                    row[x * 4 + 0] = value;
+                    row[x * 4 + 1] = (byte)(255 - value);
+                    row[x * 4 + 2] = (byte)(value / 2);
+                    row[x * 4 + 3] = 255;
+                }
+
+                Marshal.Copy(row, 0, data.Scan0 + y * data.Stride, data.Stride);
+            }
+
+            bmp.UnlockBits(data);
+            return bmp;
+        }
+    }
+}
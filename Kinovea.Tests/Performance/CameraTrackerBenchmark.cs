@@ -0,0 +1,143 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Collections.ObjectModel;
+using System.ComponentModel;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using Kinovea.ScreenManager;
+using Kinovea.Services;
+using Kinovea.Video;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Runs the feature detection and matching steps of the camera motion estimation with an increasing number of threads.
+    /// The frames are crops of a random texture panning across the image, so every frame has plenty of features.
+    /// Reports the time of each step, the speedup over a single thread, and checks the results don't depend on the thread count.
+    /// </summary>
+    public class CameraTrackerBenchmark
+    {
+        public static void Test()
+        {
+            int width = 960;
+            int height = 540;
+            int frameCount = 100;
+
+            SyntheticFrames frames = new SyntheticFrames(width, height, frameCount);
+
+            foreach (CameraMotionFeatureType featureType in new CameraMotionFeatureType[] { CameraMotionFeatureType.ORB, CameraMotionFeatureType.SIFT })
+            {
+                Console.WriteLine("{0}, {1} frames of {2}×{3} px:", featureType, frameCount, width, height);
+
+                double baseline = 0;
+                long reference = -1;
+                for (int threads = 1; threads <= Environment.ProcessorCount; threads *= 2)
+                {
+                    CameraMotionParameters parameters = new CameraMotionParameters();
+                    parameters.FeatureType = featureType;
+
+                    CameraTracker tracker = new CameraTracker(parameters);
+                    tracker.MaxDegreeOfParallelism = threads;
+                    BackgroundWorker worker = new BackgroundWorker() { WorkerReportsProgress = true, WorkerSupportsCancellation = true };
+
+                    Stopwatch stopwatch = Stopwatch.StartNew();
+                    tracker.FindFeatures(frames, worker);
+                    double detection = stopwatch.Elapsed.TotalMilliseconds;
+
+                    stopwatch.Restart();
+                    tracker.MatchFeatures(frames, worker);
+                    double matching = stopwatch.Elapsed.TotalMilliseconds;
+
+                    long signature = Signature(tracker, frames);
+                    tracker.Dispose();
+
+                    if (threads == 1)
+                    {
+                        baseline = detection + matching;
+                        reference = signature;
+                    }
+
+                    Console.WriteLine("  {0,2} threads: detection: {1,8:0} ms, matching: {2,8:0} ms, speedup: {3:0.00}×, results: {4}.",
+                        threads, detection, matching, baseline / (detection + matching), signature == reference ? "identical" : "DIFFERENT");
+                }
+            }
+
+            frames.Dispose();
+            Console.ReadKey();
+        }
+
+        /// <summary>
+        /// Number of features and matches per frame folded into a single value, to compare runs.
+        /// </summary>
+        private static long Signature(CameraTracker tracker, SyntheticFrames frames)
+        {
+            long signature = 17;
+            foreach (VideoFrame frame in frames.Frames)
+            {
+                List<PointF> features = tracker.GetFeatures(frame.Timestamp);
+                List<CameraMatch> matches = tracker.GetMatches(frame.Timestamp);
+                signature = signature * 31 + (features == null ? 0 : features.Count);
+                signature = signature * 31 + (matches == null ? 0 : matches.Count);
+            }
+
+            return signature;
+        }
+
+        /// <summary>
+        /// Frames container panning over a random texture.
+        /// </summary>
+        private class SyntheticFrames : IWorkingZoneFramesContainer, IDisposable
+        {
+            public ReadOnlyCollection<VideoFrame> Frames
+            {
+                get { return frames.AsReadOnly(); }
+            }
+
+            public Bitmap Representative
+            {
+                get { return frames[0].Image; }
+            }
+
+            private List<VideoFrame> frames = new List<VideoFrame>();
+
+            public SyntheticFrames(int width, int height, int frameCount)
+            {
+                int dx = 3;
+                int dy = 1;
+                Random random = new Random(0);
+                using (Bitmap texture = new Bitmap(width + frameCount * dx, height + frameCount * dy, PixelFormat.Format24bppRgb))
+                {
+                    using (Graphics g = Graphics.FromImage(texture))
+                    {
+                        g.Clear(Color.Gray);
+                        for (int i = 0; i < 5000; i++)
+                        {
+                            using (SolidBrush brush = new SolidBrush(Color.FromArgb(random.Next(256), random.Next(256), random.Next(256))))
+                            {
+                                int size = random.Next(4, 40);
+                                g.FillEllipse(brush, random.Next(texture.Width), random.Next(texture.Height), size, size * random.Next(1, 3));
+                            }
+                        }
+                    }
+
+                    for (int i = 0; i < frameCount; i++)
+                    {
+                        Bitmap image = texture.Clone(new Rectangle(i * dx, i * dy, width, height), PixelFormat.Format24bppRgb);
+                        frames.Add(new VideoFrame(i * 1000, image));
+                    }
+                }
+            }
+
+            public void Revert()
+            {
+            }
+
+            public void Dispose()
+            {
+                foreach (VideoFrame frame in frames)
+                    frame.Image.Dispose();
+            }
+        }
+    }
+}
@@ -0,0 +1,100 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Diagnostics;
+using Kinovea.Services;
+using Kinovea.Video;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Measures the decoding rate of VideoReaderFFMpeg for each decoder threading mode.
+    /// Also checks that every mode produces the same sequence of timestamps, 
+    /// frame threading adds decoder delay on top of the B-frames reordering and must not shift the frames.
+    /// </summary>
+    public class DecoderThreadingBenchmark
+    {
+        public static void Test(string filePath)
+        {
+            // Use a synthetic H.264 clip if no file is provided, it has B-frames.
+            // Real world H.264/HEVC files will show larger differences between modes.
+            if (string.IsNullOrEmpty(filePath))
+                filePath = SyntheticClip.Create(new Size(1920, 1080), 30, 300, EncoderProfile.H264);
+
+            if (string.IsNullOrEmpty(filePath))
+                return;
+
+            Console.WriteLine("File: {0}", filePath);
+            Dictionary<DecoderThreading, List<long>> results = new Dictionary<DecoderThreading, List<long>>();
+            foreach (DecoderThreading mode in Enum.GetValues(typeof(DecoderThreading)))
+            {
+                List<long> timestamps = TestMode(filePath, mode);
+                if (timestamps != null)
+                    results.Add(mode, timestamps);
+            }
+
+            // Single threaded decoding is the reference.
+            DecoderThreading referenceMode = DecoderThreading.Off;
+            if (results.ContainsKey(referenceMode))
+            {
+                foreach (var pair in results)
+                {
+                    if (pair.Key != referenceMode)
+                        CompareTimestamps(referenceMode, results[referenceMode], pair.Key, pair.Value);
+                }
+            }
+
+            Console.ReadKey();
+        }
+
+        private static List<long> TestMode(string filePath, DecoderThreading mode)
+        {
+            VideoReaderFFMpeg reader = new VideoReaderFFMpeg();
+            reader.Options = new VideoOptions(ImageAspectRatio.Auto, ImageRotation.Rotate0, Demosaicing.None, false, mode);
+            OpenVideoResult result = reader.Open(filePath);
+            if (result != OpenVideoResult.Success)
+            {
+                Console.WriteLine("{0}: file not opened ({1}).", mode, result);
+                return null;
+            }
+
+            // The reader is in on-demand mode after open, each call decodes exactly one frame.
+            int frames = 0;
+            List<long> timestamps = new List<long>();
+            Stopwatch sw = Stopwatch.StartNew();
+            while (reader.MoveNext(0, true))
+            {
+                frames++;
+                timestamps.Add(reader.Current.Timestamp);
+            }
+
+            double elapsed = (double)sw.ElapsedTicks / Stopwatch.Frequency;
+            double fps = frames / elapsed;
+            Console.WriteLine("{0,-6}: {1} frames in {2:0.000} s. {3:0.0} fps.", mode, frames, elapsed, fps);
+
+            reader.Close();
+            return timestamps;
+        }
+
+        private static void CompareTimestamps(DecoderThreading referenceMode, List<long> reference, DecoderThreading mode, List<long> timestamps)
+        {
+            int count = Math.Min(reference.Count, timestamps.Count);
+            for (int i = 0; i < count; i++)
+            {
+                if (timestamps[i] != reference[i])
+                {
+                    Console.WriteLine("{0,-6}: timestamp mismatch at frame {1}: [{2}], {3}: [{4}].", mode, i, timestamps[i], referenceMode, reference[i]);
+                    return;
+                }
+            }
+
+            if (reference.Count != timestamps.Count)
+                Console.WriteLine("{0,-6}: {1} frames, {2}: {3} frames.", mode, timestamps.Count, referenceMode, reference.Count);
+            else
+                Console.WriteLine("{0,-6}: timestamps match {1}.", mode, referenceMode);
+        }
+    }
+}
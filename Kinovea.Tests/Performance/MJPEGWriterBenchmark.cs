@@ -0,0 +1,78 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Diagnostics;
+using System.IO;
+using Kinovea.Services;
+using Kinovea.Video;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Drives MJPEGWriter.SaveFrame with synthetic camera frames and reports the per-frame latency distribution.
+    /// Regression check for the capture recording path: the steady state should not allocate and the tail should stay close to the median.
+    /// </summary>
+    public class MJPEGWriterBenchmark
+    {
+        public static void Test()
+        {
+            int frames = 1000;
+
+            TestFormat(new Size(1920, 1080), ImageFormat.RGB32, false, frames);
+            TestFormat(new Size(1920, 1080), ImageFormat.RGB24, false, frames);
+            TestFormat(new Size(1920, 1080), ImageFormat.Y800, false, frames);
+            TestFormat(new Size(640, 480), ImageFormat.Y800, false, frames);
+            TestFormat(new Size(640, 480), ImageFormat.Y800, true, frames);
+
+            Console.ReadKey();
+        }
+
+        private static void TestFormat(Size size, ImageFormat format, bool uncompressed, int frames)
+        {
+            string filePath = Path.Combine(Path.GetTempPath(), string.Format("mjpegwriter-benchmark-{0}.{1}", format, uncompressed ? "avi" : "mp4"));
+
+            int bpp = format == ImageFormat.RGB32 ? 4 : format == ImageFormat.RGB24 ? 3 : 1;
+            List<byte[]> buffers = BenchmarkHelper.CreateFrames(size, bpp);
+
+            VideoInfo info = new VideoInfo();
+            info.OriginalSize = size;
+            double interval = 1000.0 / 300;
+
+            MJPEGWriter writer = new MJPEGWriter();
+            SaveResult result = writer.OpenSavingContext(filePath, info, uncompressed ? "avi" : "mp4", format, uncompressed, interval, interval, ImageRotation.Rotate0);
+            if (result != SaveResult.Success)
+            {
+                Console.WriteLine("Saving context could not be opened: {0}.", result);
+                return;
+            }
+
+            // Warm up.
+            for (int i = 0; i < 20; i++)
+                writer.SaveFrame(format, buffers[i % buffers.Count], buffers[0].Length, true);
+
+            double[] latencies = new double[frames];
+            int gen0 = GC.CollectionCount(0);
+            Stopwatch sw = new Stopwatch();
+            for (int i = 0; i < frames; i++)
+            {
+                byte[] buffer = buffers[i % buffers.Count];
+                sw.Restart();
+                writer.SaveFrame(format, buffer, buffer.Length, true);
+                latencies[i] = (double)sw.ElapsedTicks / Stopwatch.Frequency * 1000;
+            }
+
+            gen0 = GC.CollectionCount(0) - gen0;
+            writer.CloseSavingContext(true);
+            writer.Dispose();
+            File.Delete(filePath);
+
+            Array.Sort(latencies);
+            Console.WriteLine("{0}x{1} {2}{3}: mean: {4:0.000} ms, p50: {5:0.000} ms, p90: {6:0.000} ms, p99: {7:0.000} ms, max: {8:0.000} ms. Gen0 collections: {9}.",
+                size.Width, size.Height, format, uncompressed ? " (uncompressed)" : "",
+                latencies.Average(), BenchmarkHelper.Percentile(latencies, 0.5), BenchmarkHelper.Percentile(latencies, 0.9), BenchmarkHelper.Percentile(latencies, 0.99), latencies[latencies.Length - 1], gen0);
+        }
+    }
+}
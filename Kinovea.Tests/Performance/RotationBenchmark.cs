@@ -0,0 +1,94 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Drawing.Drawing2D;
+using System.Diagnostics;
+using Kinovea.Services;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Compares Bitmap.RotateFlip with the native rotation used by the video reader and the capture delayer.
+    /// </summary>
+    public class RotationBenchmark
+    {
+        public static void Test()
+        {
+            Console.WriteLine("Rotation kernels: {0}.", ImageRotator.UsesAVX2 ? "AVX2" : "SSE2");
+
+            // Portrait phone footage is stored as landscape 1080p with a rotation flag.
+            Size size = new Size(1920, 1080);
+            int loops = 200;
+
+            TestFormat(size, PixelFormat.Format32bppPArgb, loops);
+            TestFormat(size, PixelFormat.Format24bppRgb, loops);
+
+            Console.ReadKey();
+        }
+
+        private static void TestFormat(Size size, PixelFormat format, int loops)
+        {
+            Bitmap src = CreateBitmap(size, format);
+            Console.WriteLine("{0}x{1}, {2}:", size.Width, size.Height, format);
+
+            foreach (ImageRotation rotation in Enum.GetValues(typeof(ImageRotation)))
+            {
+                if (rotation == ImageRotation.Rotate0)
+                    continue;
+
+                double gdi = TestRotateFlip(src, rotation, loops);
+                double native = TestNative(src, rotation, loops);
+                Console.WriteLine("  {0,-9}: RotateFlip: {1:0.000} ms, native: {2:0.000} ms. Speedup: {3:0.0}x.", rotation, gdi, native, gdi / native);
+            }
+
+            src.Dispose();
+        }
+
+        private static double TestRotateFlip(Bitmap src, ImageRotation rotation, int loops)
+        {
+            // RotateFlip works in place so we need a copy of the source each time, the copy is not measured.
+            RotateFlipType type = rotation == ImageRotation.Rotate90 ? RotateFlipType.Rotate90FlipNone :
+                rotation == ImageRotation.Rotate180 ? RotateFlipType.Rotate180FlipNone : RotateFlipType.Rotate270FlipNone;
+
+            Stopwatch sw = new Stopwatch();
+            for (int i = 0; i < loops; i++)
+            {
+                Bitmap copy = new Bitmap(src);
+                sw.Start();
+                copy.RotateFlip(type);
+                sw.Stop();
+                copy.Dispose();
+            }
+
+            return (double)sw.ElapsedTicks / Stopwatch.Frequency * 1000 / loops;
+        }
+
+        private static double TestNative(Bitmap src, ImageRotation rotation, int loops)
+        {
+            Size rotatedSize = ImageRotator.GetRotatedSize(src.Size, rotation);
+            Bitmap dst = new Bitmap(rotatedSize.Width, rotatedSize.Height, src.PixelFormat);
+
+            Stopwatch sw = Stopwatch.StartNew();
+            for (int i = 0; i < loops; i++)
+                ImageRotator.Rotate(src, dst, rotation, false);
+
+            double result = (double)sw.ElapsedTicks / Stopwatch.Frequency * 1000 / loops;
+            dst.Dispose();
+            return result;
+        }
+
+        private static Bitmap CreateBitmap(Size size, PixelFormat format)
+        {
+            Bitmap bmp = new Bitmap(size.Width, size.Height, format);
+            using (Graphics g = Graphics.FromImage(bmp))
+            using (Brush brush = new LinearGradientBrush(new Point(0, 0), new Point(size.Width, size.Height), Color.Red, Color.Blue))
+                g.FillRectangle(brush, 0, 0, size.Width, size.Height);
+
+            return bmp;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Drawing2D;
+using System.Drawing.Imaging;
+using System.IO;
+using Kinovea.Services;
+using Kinovea.Video;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Creates short video files with moving content to be used as input for decoding benchmarks.
+    /// </summary>
+    public static class SyntheticClip
+    {
+        public static string Create(Size size, double fps, int frameCount)
+        {
+            return Create(size, fps, frameCount, EncoderProfile.MPEG4);
+        }
+
+        /// <summary>
+        /// Creates the clip with a specific encoder profile. 
+        /// The H.264 and H.265 profiles produce B-frames, so the decoder output is delayed relatively to the packets.
+        /// </summary>
+        public static string Create(Size size, double fps, int frameCount, EncoderProfile profile)
+        {
+            string filename = string.Format("synthetic-{0}x{1}-{2}fps-{3}f-{4}.mp4", size.Width, size.Height, fps, frameCount, profile.ToString().ToLower());
+            string filePath = Path.Combine(Path.GetTempPath(), filename);
+            if (File.Exists(filePath))
+                return filePath;
+
+            VideoInfo info = VideoInfo.Empty;
+            info.ReferenceSize = size;
+            info.PixelAspectRatio = 1.0;
+            double interval = 1000.0 / fps;
+
+            VideoFileWriter writer = new VideoFileWriter();
+            writer.Encoder = new EncoderSettings(profile);
+            SaveResult result = writer.OpenSavingContext(filePath, info, "mp4", interval);
+            if (result != SaveResult.Success)
+            {
+                Console.WriteLine("Synthetic clip could not be created: {0}.", result);
+                return null;
+            }
+
+            Random random = new Random(0);
+            Bitmap bmp = new Bitmap(size.Width, size.Height, PixelFormat.Format32bppPArgb);
+            for (int i = 0; i < frameCount; i++)
+            {
+                DrawFrame(bmp, i, random);
+                writer.SaveFrame(bmp);
+            }
+
+            writer.CloseSavingContext(true);
+            bmp.Dispose();
+
+            return filePath;
+        }
+
+        private static void DrawFrame(Bitmap bmp, int frame, Random random)
+        {
+            // Moving gradient with a few random blocks so the encoder has something to work on.
+            using (Graphics g = Graphics.FromImage(bmp))
+            {
+                Rectangle rect = new Rectangle(0, 0, bmp.Width, bmp.Height);
+                float angle = (frame * 3) % 360;
+                using (LinearGradientBrush brush = new LinearGradientBrush(rect, Color.Navy, Color.Orange, angle))
+                    g.FillRectangle(brush, rect);
+
+                for (int i = 0; i < 64; i++)
+                {
+                    Color c = Color.FromArgb(random.Next(256), random.Next(256), random.Next(256));
+                    int x = random.Next(bmp.Width);
+                    int y = random.Next(bmp.Height);
+                    using (SolidBrush brush = new SolidBrush(c))
+                        g.FillRectangle(brush, x, y, 48, 48);
+                }
+
+                int cx = (frame * 8) % bmp.Width;
+                g.FillEllipse(Brushes.White, cx, bmp.Height / 2 - 40, 80, 80);
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using Kinovea.ScreenManager;
+using Kinovea.Services;
+using Kinovea.Tests.Kinematics;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Tracks a synthetic moving disc with the template matching tracker, with and without the coarse-to-fine search.
+    /// Reports the time per tracking step and the error against the known trajectory, for several search window sizes.
+    /// </summary>
+    public class TemplateMatchingBenchmark
+    {
+        public static void Test()
+        {
+            int width = 1024;
+            int height = 1024;
+            double fps = 100;
+            int frameCount = 100;
+            double a = 500;
+            MovingObject o = new MovingObject() { Radius = 8, SpeedX = 200 };
+
+            // Render the whole sequence up front so only the tracking is measured.
+            VideoSynthesizer synthesizer = new VideoSynthesizer();
+            List<Bitmap> images = new List<Bitmap>();
+            List<PointF> truth = new List<PointF>();
+            for (int i = 0; i < frameCount; i++)
+            {
+                Bitmap bmp = new Bitmap(width, height, PixelFormat.Format32bppPArgb);
+                truth.Add(synthesizer.RenderFrame(bmp, i, fps, a, o));
+                images.Add(bmp);
+            }
+
+            Console.WriteLine("Template matching, {0} frames of {1}×{2} px:", frameCount, width, height);
+            foreach (int searchSize in new int[] { 100, 200, 400 })
+            {
+                TestMode(images, truth, searchSize, false);
+                TestMode(images, truth, searchSize, true);
+            }
+
+            foreach (Bitmap image in images)
+                image.Dispose();
+
+            Console.ReadKey();
+        }
+
+        private static void TestMode(List<Bitmap> images, List<PointF> truth, int searchSize, bool coarseToFine)
+        {
+            TrackingParameters parameters = new TrackingParameters();
+            parameters.SearchWindow = new Size(searchSize, searchSize);
+            parameters.BlockWindow = new Size(20, 20);
+            parameters.CoarseToFine = coarseToFine;
+            TrackerTemplateMatching tracker = new TrackerTemplateMatching(parameters);
+
+            List<TimedPoint> timeline = new List<TimedPoint>();
+            TimedPoint reference = new TimedPoint(truth[0].X, truth[0].Y, 0);
+            using (MatView view = new MatView(images[0]))
+                tracker.CreateReferenceTrackPoint(reference, view.Mat);
+
+            timeline.Add(reference);
+
+            Stopwatch stopwatch = new Stopwatch();
+            double sumError = 0;
+            double maxError = 0;
+            int failures = 0;
+            for (int i = 1; i < images.Count; i++)
+            {
+                TimedPoint current;
+                bool matched;
+                using (MatView view = new MatView(images[i]))
+                {
+                    stopwatch.Start();
+                    matched = tracker.TrackStep(timeline, i, view.Mat, out current);
+                    stopwatch.Stop();
+                }
+
+                timeline.Add(current);
+                if (!matched)
+                    failures++;
+
+                double dx = current.X - truth[i].X;
+                double dy = current.Y - truth[i].Y;
+                double error = Math.Sqrt(dx * dx + dy * dy);
+                sumError += error;
+                maxError = Math.Max(maxError, error);
+            }
+
+            tracker.Dispose();
+
+            int steps = images.Count - 1;
+            Console.WriteLine("  Search {0,3} px, {1,-14}: {2:0.000} ms/step, error mean: {3:0.000} px, max: {4:0.000} px, failures: {5}.",
+                searchSize, coarseToFine ? "coarse-to-fine" : "exhaustive", stopwatch.Elapsed.TotalMilliseconds / steps, sumError / steps, maxError, failures);
+        }
+    }
+}
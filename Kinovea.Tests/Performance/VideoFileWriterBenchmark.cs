@@ -0,0 +1,74 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Diagnostics;
+using System.IO;
+using Kinovea.Video;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Drives VideoFileWriter.SaveFrame with synthetic images the way the video exporter does and reports the export rate.
+    /// Run it on both revisions to compare, the numbers are only meaningful on the same machine.
+    /// </summary>
+    public class VideoFileWriterBenchmark
+    {
+        public static void Test()
+        {
+            // Two minutes at 30 fps.
+            int frames = 3600;
+
+            TestSize(new Size(1920, 1080), new Size(1920, 1080), frames);
+            TestSize(new Size(1280, 720), new Size(1280, 720), frames);
+
+            // Decoding size different from the reference size, the scaler also resizes.
+            TestSize(new Size(1920, 1088), new Size(1920, 1080), frames);
+
+            Console.ReadKey();
+        }
+
+        private static void TestSize(Size imageSize, Size referenceSize, int frames)
+        {
+            string filePath = Path.Combine(Path.GetTempPath(), "videofilewriter-benchmark.mp4");
+
+            // A few distinct images cycled through, the exporter also reuses a single bitmap.
+            List<Bitmap> images = BenchmarkHelper.CreateImages(imageSize);
+
+            VideoInfo info = VideoInfo.Empty;
+            info.ReferenceSize = referenceSize;
+            info.PixelAspectRatio = 1.0;
+            double interval = 1000.0 / 30;
+
+            VideoFileWriter writer = new VideoFileWriter();
+            SaveResult result = writer.OpenSavingContext(filePath, info, "mp4", interval);
+            if (result != SaveResult.Success)
+            {
+                Console.WriteLine("Saving context could not be opened: {0}.", result);
+                return;
+            }
+
+            int gen0 = GC.CollectionCount(0);
+            int gen2 = GC.CollectionCount(2);
+            Stopwatch sw = Stopwatch.StartNew();
+            for (int i = 0; i < frames; i++)
+                writer.SaveFrame(images[i % images.Count]);
+
+            sw.Stop();
+            gen0 = GC.CollectionCount(0) - gen0;
+            gen2 = GC.CollectionCount(2) - gen2;
+
+            writer.CloseSavingContext(true);
+            File.Delete(filePath);
+            foreach (Bitmap image in images)
+                image.Dispose();
+
+            double seconds = sw.Elapsed.TotalSeconds;
+            Console.WriteLine("{0}x{1} -> {2}x{3}: {4} frames in {5:0.00} s, {6:0.0} fps, {7:0.000} ms/frame. Gen0 collections: {8}, Gen2 collections: {9}.",
+                imageSize.Width, imageSize.Height, referenceSize.Width, referenceSize.Height,
+                frames, seconds, frames / seconds, sw.Elapsed.TotalMilliseconds / frames, gen0, gen2);
+        }
+    }
+}
@@ -0,0 +1,232 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Kinovea.Pipeline;
+using Kinovea.Pipeline.Consumers;
+using Kinovea.Pipeline.WaitStrategies;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Runs a synthetic camera through the frame pipeline with each consumer wait strategy.
+    /// Reports the CPU time used by the consumer thread and the latency between the frame production and its processing.
+    /// A fast consumer (noop) shows the cost of waiting, a slow consumer shows the strategies make no difference when there is always a frame ready.
+    /// </summary>
+    public class WaitStrategyBenchmark
+    {
+        [DllImport("kernel32.dll")]
+        private static extern IntPtr GetCurrentThread();
+
+        [DllImport("kernel32.dll", SetLastError = true)]
+        private static extern bool GetThreadTimes(IntPtr thread, out long creationTime, out long exitTime, out long kernelTime, out long userTime);
+
+        public static void Test()
+        {
+            double framerate = 100;
+            int duration = 5000;
+            int bufferSize = 640 * 480;
+
+            foreach (bool slow in new bool[] { false, true })
+            {
+                Console.WriteLine("{0} consumer, {1} fps:", slow ? "Slow" : "Noop", framerate);
+                TestStrategy("Busy spin", new BusySpinWaitStrategy(), slow, framerate, duration, bufferSize);
+                TestStrategy("Yield", new YieldingWaitStrategy(), slow, framerate, duration, bufferSize);
+                TestStrategy("Spin then park", new SpinThenParkWaitStrategy(), slow, framerate, duration, bufferSize);
+                TestStrategy("Timed park", new TimedParkWaitStrategy(1), slow, framerate, duration, bufferSize);
+            }
+
+            Console.ReadKey();
+        }
+
+        private static void TestStrategy(string name, IWaitStrategy strategy, bool slow, double framerate, int duration, int bufferSize)
+        {
+            Probe probe = new Probe();
+            AbstractConsumer consumer = slow ? (AbstractConsumer)new ProbedConsumerSlow(probe) : new ProbedConsumerNoop(probe);
+            consumer.WaitStrategy = strategy;
+
+            Thread consumerThread = new Thread(consumer.Run) { IsBackground = true, Name = "Consumer-" + name };
+            consumerThread.Start();
+
+            SyntheticProducer producer = new SyntheticProducer(bufferSize, framerate);
+            FramePipeline pipeline = new FramePipeline(producer, new List<IFrameConsumer>() { consumer }, 8, bufferSize);
+
+            consumer.Activate();
+            producer.Start();
+
+            Thread.Sleep(duration);
+
+            producer.Stop();
+            consumer.Deactivate();
+            while (consumer.Active)
+                Thread.Sleep(1);
+
+            consumer.Stop();
+            consumerThread.Join();
+            pipeline.Teardown();
+
+            double[] latencies = probe.Latencies.ToArray();
+            if (latencies.Length == 0)
+            {
+                Console.WriteLine("  {0,-15}: no frames.", name);
+                return;
+            }
+
+            Array.Sort(latencies);
+            double cpu = probe.CpuMilliseconds / probe.WallMilliseconds * 100;
+            Console.WriteLine("  {0,-15}: CPU: {1,5:0.0}%, latency p50: {2:0.000} ms, p99: {3:0.000} ms, max: {4:0.000} ms. Frames: {5}, drops: {6}.",
+                name, cpu, BenchmarkHelper.Percentile(latencies, 0.5), BenchmarkHelper.Percentile(latencies, 0.99), latencies[latencies.Length - 1], latencies.Length, pipeline.Drops);
+        }
+
+        /// <summary>
+        /// Measures the consumer thread from the inside, CPU times are per thread.
+        /// </summary>
+        private class Probe
+        {
+            public List<double> Latencies { get; } = new List<double>(10000);
+            public double CpuMilliseconds { get; private set; }
+            public double WallMilliseconds { get; private set; }
+
+            private long startCpu;
+            private Stopwatch wall = new Stopwatch();
+
+            public void Start()
+            {
+                startCpu = GetCpuTime();
+                wall.Restart();
+            }
+
+            public void Sample(Frame entry)
+            {
+                // The producer writes its timestamp at the start of the frame.
+                long produced = BitConverter.ToInt64(entry.Buffer, 0);
+                Latencies.Add((double)(Stopwatch.GetTimestamp() - produced) / Stopwatch.Frequency * 1000);
+            }
+
+            public void Stop()
+            {
+                wall.Stop();
+                WallMilliseconds = wall.Elapsed.TotalMilliseconds;
+                CpuMilliseconds = (GetCpuTime() - startCpu) / 10000.0;
+            }
+
+            private static long GetCpuTime()
+            {
+                // Kernel and user times in 100 ns units.
+                long creation, exit, kernel, user;
+                GetThreadTimes(GetCurrentThread(), out creation, out exit, out kernel, out user);
+                return kernel + user;
+            }
+        }
+
+        private class ProbedConsumerNoop : ConsumerNoop
+        {
+            private Probe probe;
+
+            public ProbedConsumerNoop(Probe probe)
+            {
+                this.probe = probe;
+            }
+
+            protected override void BeforeActivate()
+            {
+                probe.Start();
+            }
+
+            protected override void AfterDeactivate()
+            {
+                probe.Stop();
+                base.AfterDeactivate();
+            }
+
+            protected override void ProcessEntry(long position, Frame entry)
+            {
+                probe.Sample(entry);
+            }
+        }
+
+        private class ProbedConsumerSlow : ConsumerSlow
+        {
+            private Probe probe;
+
+            public ProbedConsumerSlow(Probe probe)
+            {
+                this.probe = probe;
+            }
+
+            protected override void BeforeActivate()
+            {
+                probe.Start();
+            }
+
+            protected override void AfterDeactivate()
+            {
+                probe.Stop();
+                base.AfterDeactivate();
+            }
+
+            protected override void ProcessEntry(long position, Frame entry)
+            {
+                probe.Sample(entry);
+                base.ProcessEntry(position, entry);
+            }
+        }
+
+        /// <summary>
+        /// Produces frames at a regular interval on its own thread, like a camera SDK callback.
+        /// </summary>
+        private class SyntheticProducer : IFrameProducer
+        {
+            public event EventHandler<FrameProducedEventArgs> FrameProduced;
+
+            private byte[] buffer;
+            private double interval;
+            private Thread thread;
+            private volatile bool stopAsked;
+
+            public SyntheticProducer(int bufferSize, double framerate)
+            {
+                buffer = new byte[bufferSize];
+                interval = 1000.0 / framerate;
+            }
+
+            public void Start()
+            {
+                thread = new Thread(Produce) { IsBackground = true, Name = "SyntheticProducer" };
+                thread.Start();
+            }
+
+            public void Stop()
+            {
+                stopAsked = true;
+                thread.Join();
+            }
+
+            private void Produce()
+            {
+                Stopwatch sw = Stopwatch.StartNew();
+                long frame = 0;
+                while (!stopAsked)
+                {
+                    // Sleep most of the interval then spin to the exact time, the producer CPU is not measured.
+                    double due = ++frame * interval;
+                    while (due - sw.Elapsed.TotalMilliseconds > 2)
+                        Thread.Sleep(1);
+
+                    while (sw.Elapsed.TotalMilliseconds < due)
+                        Thread.SpinWait(10);
+
+                    long timestamp = Stopwatch.GetTimestamp();
+                    for (int i = 0; i < 8; i++)
+                        buffer[i] = (byte)(timestamp >> (i * 8));
+
+                    if (FrameProduced != null)
+                        FrameProduced(this, new FrameProducedEventArgs(buffer, buffer.Length));
+                }
+            }
+        }
+    }
+}
@@ -21,6 +21,13 @@ namespace Kinovea.Tests
 
             // Performance
             //ImageCopy.Test();
+            //DecoderThreadingBenchmark.Test(@"");
+            //RotationBenchmark.Test();
+            //MJPEGWriterBenchmark.Test();
+            //VideoFileWriterBenchmark.Test();
+            //WaitStrategyBenchmark.Test();
+            //TemplateMatchingBenchmark.Test();
+            //CameraTrackerBenchmark.Test();
         }
         private static void TestKVAFuzzer()
         {
@@ -0,0 +1,182 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "EncoderProfiles.h"
+
+using namespace System::Runtime::InteropServices;
+using namespace Kinovea::Video::FFMpeg;
+
+AVCodec* EncoderProfiles::FindEncoder(EncoderProfile _profile)
+{
+    switch (_profile)
+    {
+    case EncoderProfile::MJPEG:
+        return avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    case EncoderProfile::H264:
+    case EncoderProfile::H264Intra:
+        return avcodec_find_encoder_by_name("libx264");
+    case EncoderProfile::H265:
+        return avcodec_find_encoder_by_name("libx265");
+    case EncoderProfile::FFV1:
+        return avcodec_find_encoder(AV_CODEC_ID_FFV1);
+    case EncoderProfile::ProRes:
+        return avcodec_find_encoder_by_name("prores_ks");
+    case EncoderProfile::MPEG4:
+    default:
+        return avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    }
+}
+
+bool EncoderProfiles::IsSupported(EncoderProfile _profile, AVOutputFormat* _pFormat)
+{
+    AVCodec* pCodec = FindEncoder(_profile);
+    if (pCodec == nullptr)
+        return false;
+
+    // Negative means the muxer doesn't know, let avformat_write_header decide.
+    return avformat_query_codec(_pFormat, pCodec->id, FF_COMPLIANCE_NORMAL) != 0;
+}
+
+bool EncoderProfiles::IsLegacy(EncoderProfile _profile)
+{
+    return _profile == EncoderProfile::MPEG4 || _profile == EncoderProfile::MJPEG;
+}
+
+void EncoderProfiles::Configure(AVCodecContext* _pCodecContext, EncoderSettings^ _settings, AVDictionary** _options)
+{
+    int threads = GetThreadCount(_settings);
+    _pCodecContext->thread_count = threads;
+
+    if (IsLegacy(_settings->Profile))
+    {
+        // The single-call encoding path expects one packet out for each frame in, 
+        // frame threading would delay the packets.
+        _pCodecContext->thread_type = FF_THREAD_SLICE;
+        log->DebugFormat("Encoder profile: {0}, slice threads: {1}.", _settings->Profile, threads);
+        return;
+    }
+
+    _pCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    // Undo the constant quantizer setup of the historical profiles.
+    _pCodecContext->flags &= ~CODEC_FLAG_QSCALE;
+    _pCodecContext->qmin = -1;
+    _pCodecContext->qmax = -1;
+    _pCodecContext->bit_rate = 0;
+    _pCodecContext->me_method = -1;
+    _pCodecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+
+    // One keyframe per second keeps seeking in the player responsive.
+    double fps = (double)_pCodecContext->time_base.den / _pCodecContext->time_base.num;
+    _pCodecContext->gop_size = Math::Max(1, (int)Math::Round(fps));
+
+    String^ crf = _settings->Crf.ToString();
+    switch (_settings->Profile)
+    {
+    case EncoderProfile::H264:
+    case EncoderProfile::H264Intra:
+    case EncoderProfile::H265:
+    {
+        // The player seeks more reliably without B-frames.
+        _pCodecContext->max_b_frames = 0;
+        if (_settings->Profile == EncoderProfile::H264Intra)
+            _pCodecContext->gop_size = 1;
+
+        char* pPreset = static_cast<char*>(Marshal::StringToHGlobalAnsi(_settings->Preset).ToPointer());
+        char* pCrf = static_cast<char*>(Marshal::StringToHGlobalAnsi(crf).ToPointer());
+        av_dict_set(_options, "preset", pPreset, 0);
+        av_dict_set(_options, "crf", pCrf, 0);
+        Marshal::FreeHGlobal(safe_cast<IntPtr>(pPreset));
+        Marshal::FreeHGlobal(safe_cast<IntPtr>(pCrf));
+
+        if (_settings->Profile == EncoderProfile::H265)
+            av_dict_set(_options, "x265-params", "bframes=0", 0);
+        break;
+    }
+    case EncoderProfile::FFV1:
+        // Level 3 is required for slice threading.
+        _pCodecContext->gop_size = 1;
+        _pCodecContext->slices = threads > 1 ? 16 : 4;
+        av_dict_set(_options, "level", "3", 0);
+        break;
+    case EncoderProfile::ProRes:
+        _pCodecContext->pix_fmt = AV_PIX_FMT_YUV422P10;
+        av_dict_set(_options, "profile", "3", 0);
+        break;
+    default:
+        break;
+    }
+
+    log->DebugFormat("Encoder profile: {0}, CRF: {1}, preset: {2}, threads: {3}.", _settings->Profile, _settings->Crf, _settings->Preset, threads);
+}
+
+int EncoderProfiles::EncodeAndWrite(AVFormatContext* _pFormatContext, AVStream* _pStream, AVCodecContext* _pCodecContext, AVFrame* _pFrame)
+{
+    // The encoder allocates the packet. Its worst case size depends on the encoder (FFV1 can exceed the raw frame size),
+    // a preallocated buffer that is too small is an error rather than a reallocation.
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = nullptr;
+    packet.size = 0;
+
+    int gotPacket = 0;
+    int averror = avcodec_encode_video2(_pCodecContext, &packet, _pFrame, &gotPacket);
+    if (averror < 0)
+        return averror;
+
+    if (!gotPacket)
+        return 0;
+
+    av_packet_rescale_ts(&packet, _pCodecContext->time_base, _pStream->time_base);
+    packet.stream_index = _pStream->index;
+    averror = av_write_frame(_pFormatContext, &packet);
+    av_free_packet(&packet);
+
+    return averror < 0 ? averror : 1;
+}
+
+int EncoderProfiles::Flush(AVFormatContext* _pFormatContext, AVStream* _pStream, AVCodecContext* _pCodecContext)
+{
+    if ((_pCodecContext->codec->capabilities & CODEC_CAP_DELAY) == 0)
+        return 0;
+
+    int written = 0;
+    while (true)
+    {
+        int result = EncodeAndWrite(_pFormatContext, _pStream, _pCodecContext, nullptr);
+        if (result <= 0)
+            break;
+
+        written += result;
+    }
+
+    return written;
+}
+
+int EncoderProfiles::GetThreadCount(EncoderSettings^ _settings)
+{
+    if (_settings->Threads > 0)
+        return _settings->Threads;
+
+    // Beyond 16 threads the frame threading delay grows for little gain.
+    return Math::Min(16, Environment::ProcessorCount);
+}
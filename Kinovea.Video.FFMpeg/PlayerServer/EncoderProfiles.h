@@ -0,0 +1,89 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C" 
+{
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+#include <avformat.h>
+#include <avcodec.h>
+#include <dict.h>
+}
+
+using namespace System;
+using namespace System::Reflection;
+using namespace Kinovea::Services;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Encoder selection and configuration for each encoder profile, shared by VideoFileWriter and MJPEGWriter.
+    /// The historical profiles (MPEG-4, MJPEG) go through the single-call encoding path of the writers,
+    /// the others use the packet API, may delay packets and must be flushed before writing the trailer.
+    /// </summary>
+    ref class EncoderProfiles abstract sealed
+    {
+    public:
+        /// <summary>
+        /// Returns the encoder for the profile, or null if it is not part of the FFmpeg build.
+        /// </summary>
+        static AVCodec* FindEncoder(EncoderProfile _profile);
+
+        /// <summary>
+        /// Whether the encoder exists and the container can store its output.
+        /// </summary>
+        static bool IsSupported(EncoderProfile _profile, AVOutputFormat* _pFormat);
+
+        /// <summary>
+        /// Whether the profile goes through the historical single-call encoding path.
+        /// </summary>
+        static bool IsLegacy(EncoderProfile _profile);
+
+        /// <summary>
+        /// Apply the profile on top of the generic codec context setup done by the writer. 
+        /// Sets pixel format, rate control, GOP and threading. Private options are added to _options for avcodec_open2.
+        /// </summary>
+        static void Configure(AVCodecContext* _pCodecContext, EncoderSettings^ _settings, AVDictionary** _options);
+
+        /// <summary>
+        /// Encode a frame with the packet API and write the resulting packet if any. 
+        /// Pass a null frame to drain the delayed packets.
+        /// Returns the number of packets written or a negative error code.
+        /// </summary>
+        static int EncodeAndWrite(AVFormatContext* _pFormatContext, AVStream* _pStream, AVCodecContext* _pCodecContext, AVFrame* _pFrame);
+
+        /// <summary>
+        /// Drain the packets still held by the encoder. Returns the number of packets written.
+        /// </summary>
+        static int Flush(AVFormatContext* _pFormatContext, AVStream* _pStream, AVCodecContext* _pCodecContext);
+
+    private:
+        static int GetThreadCount(EncoderSettings^ _settings);
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
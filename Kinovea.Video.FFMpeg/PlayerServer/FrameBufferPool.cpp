@@ -0,0 +1,134 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include <malloc.h>
+#include <msclr\lock.h>
+#include "FrameBufferPool.h"
+
+using namespace msclr;
+using namespace Kinovea::Video::FFMpeg;
+
+FrameBufferPool::FrameBufferPool()
+{
+    m_Buckets = gcnew Dictionary<int, Stack<IntPtr>^>();
+    m_Rented = gcnew Dictionary<IntPtr, RentedBuffer>();
+    m_Locker = gcnew Object();
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    this->!FrameBufferPool();
+}
+
+FrameBufferPool::!FrameBufferPool()
+{
+    // Only the idle buffers are freed here.
+    // Rented buffers are still referenced by Bitmaps and will be freed when they are returned.
+    Flush();
+}
+
+uint8_t* FrameBufferPool::Rent(int _size)
+{
+    if (_size <= 0)
+        return nullptr;
+
+    lock l(m_Locker);
+
+    uint8_t* buffer = nullptr;
+    Stack<IntPtr>^ bucket = nullptr;
+    if (m_Buckets->TryGetValue(_size, bucket) && bucket->Count > 0)
+    {
+        buffer = (uint8_t*)bucket->Pop().ToPointer();
+        m_Reuses++;
+    }
+    else
+    {
+        buffer = (uint8_t*)_aligned_malloc(_size, Alignment);
+        if (buffer == nullptr)
+            return nullptr;
+
+        m_Allocations++;
+        m_BytesResident += _size;
+    }
+
+    RentedBuffer rented;
+    rented.Size = _size;
+    rented.Generation = m_Generation;
+    m_Rented[IntPtr(buffer)] = rented;
+
+    return buffer;
+}
+
+void FrameBufferPool::Return(uint8_t* _buffer)
+{
+    if (_buffer == nullptr)
+        return;
+
+    lock l(m_Locker);
+
+    IntPtr ptr = IntPtr(_buffer);
+    RentedBuffer rented;
+    if (!m_Rented->TryGetValue(ptr, rented))
+        return;
+
+    m_Rented->Remove(ptr);
+
+    if (rented.Generation != m_Generation)
+    {
+        // The pool was flushed while this buffer was out, its size is likely not in use anymore.
+        _aligned_free(_buffer);
+        m_BytesResident -= rented.Size;
+        return;
+    }
+
+    Stack<IntPtr>^ bucket = nullptr;
+    if (!m_Buckets->TryGetValue(rented.Size, bucket))
+    {
+        bucket = gcnew Stack<IntPtr>();
+        m_Buckets->Add(rented.Size, bucket);
+    }
+
+    bucket->Push(ptr);
+}
+
+void FrameBufferPool::Flush()
+{
+    // Free all idle buffers and mark the rented ones to be freed when they come back.
+    // Called when the decoding size changes.
+    lock l(m_Locker);
+    FreeIdle();
+    m_Generation++;
+}
+
+void FrameBufferPool::FreeIdle()
+{
+    for each (KeyValuePair<int, Stack<IntPtr>^> pair in m_Buckets)
+    {
+        while (pair.Value->Count > 0)
+        {
+            _aligned_free(pair.Value->Pop().ToPointer());
+            m_BytesResident -= pair.Key;
+        }
+    }
+
+    m_Buckets->Clear();
+}
@@ -0,0 +1,91 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// A pool of aligned native buffers holding decoded images.
+    /// Buffers are grouped in buckets by size. A buffer given back to the pool is kept 
+    /// for the next request of the same size instead of being freed.
+    /// Buffers that were rented before a flush are freed when they come back.
+    /// Thread safe: rent and return are called from the decoding thread and the UI thread.
+    /// </summary>
+    public ref class FrameBufferPool
+    {
+    public:
+        /// <summary>
+        /// Number of buffers allocated from the heap.
+        /// </summary>
+        property int64_t Allocations {
+            int64_t get() { return m_Allocations; }
+        }
+        /// <summary>
+        /// Number of requests served by a buffer already in the pool.
+        /// </summary>
+        property int64_t Reuses {
+            int64_t get() { return m_Reuses; }
+        }
+        /// <summary>
+        /// Total size of the buffers owned by the pool, rented or idle.
+        /// </summary>
+        property int64_t BytesResident {
+            int64_t get() { return m_BytesResident; }
+        }
+
+    public:
+        FrameBufferPool();
+        ~FrameBufferPool();
+    protected:
+        !FrameBufferPool();
+
+    public:
+        uint8_t* Rent(int _size);
+        void Return(uint8_t* _buffer);
+        void Flush();
+
+    private:
+        value struct RentedBuffer
+        {
+            int Size;
+            int Generation;
+        };
+
+        void FreeIdle();
+
+    private:
+        static const int Alignment = 64;
+        Dictionary<int, Stack<IntPtr>^>^ m_Buckets;
+        Dictionary<IntPtr, RentedBuffer>^ m_Rented;
+        int m_Generation;
+        int64_t m_Allocations;
+        int64_t m_Reuses;
+        int64_t m_BytesResident;
+        Object^ m_Locker;
+    };
+}}}
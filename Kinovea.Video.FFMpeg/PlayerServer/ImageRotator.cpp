@@ -0,0 +1,368 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include <string.h>
+#include <algorithm>
+#include <intrin.h>
+#include <immintrin.h>
+#include "ImageRotator.h"
+
+using namespace System::Drawing::Imaging;
+using namespace Kinovea::Video::FFMpeg;
+
+#pragma unmanaged
+
+namespace
+{
+    // Side of the blocks, in pixels, for the cache blocked transposes.
+    // A 64x64 block of 32-bit pixels is 16 KB, the source and destination rows of a block stay in L1.
+    const int BlockSize = 64;
+
+    enum SimdLevel
+    {
+        SimdUnknown = -1,
+        SimdSSE2 = 0,
+        SimdAVX2 = 1
+    };
+
+    int simdLevel = SimdUnknown;
+
+    int DetectSimdLevel()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return SimdSSE2;
+
+        // AVX must be supported by the CPU and the OS must save the YMM registers.
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return SimdSSE2;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0 ? SimdAVX2 : SimdSSE2;
+    }
+
+    int GetSimdLevel()
+    {
+        if (simdLevel == SimdUnknown)
+            simdLevel = DetectSimdLevel();
+
+        return simdLevel;
+    }
+
+    inline void CopyPixel(const uint8_t* _src, uint8_t* _dst, int _bpp)
+    {
+        switch (_bpp)
+        {
+        case 4:
+            *(uint32_t*)_dst = *(const uint32_t*)_src;
+            break;
+        case 3:
+            _dst[0] = _src[0];
+            _dst[1] = _src[1];
+            _dst[2] = _src[2];
+            break;
+        default:
+            memcpy(_dst, _src, _bpp);
+            break;
+        }
+    }
+
+    //------------------------------------------------------------------------------------
+    // Sideways rotations.
+    // Destination rows are source columns: dst(x, y) = src(column(y), row(x)), with
+    // column(y) = y or srcWidth - 1 - y, and row(x) = x or srcHeight - 1 - x.
+    // The image is walked in blocks small enough to stay in cache, and each block in 
+    // square tiles transposed in registers: 4x4 pixels with SSE2, 8x8 pixels with AVX2.
+    //------------------------------------------------------------------------------------
+    struct Transpose
+    {
+        const uint8_t* Src;
+        int SrcWidth;
+        int SrcHeight;
+        int SrcStride;
+        uint8_t* Dst;
+        int DstStride;
+        int Bpp;
+        bool ReverseColumns;
+        bool ReverseRows;
+    };
+
+    inline int SourceRow(const Transpose& _t, int _x)
+    {
+        return _t.ReverseRows ? _t.SrcHeight - 1 - _x : _x;
+    }
+
+    inline int DestinationRow(const Transpose& _t, int _y, int _tile, int _j)
+    {
+        // Destination row of the jth source column of the tile starting at destination row _y.
+        return _t.ReverseColumns ? _y + _tile - 1 - _j : _y + _j;
+    }
+
+    void TransposeScalar(const Transpose& _t, int _x0, int _x1, int _y0, int _y1)
+    {
+        for (int y = _y0; y < _y1; y++)
+        {
+            int column = _t.ReverseColumns ? _t.SrcWidth - 1 - y : y;
+            const uint8_t* src = _t.Src + column * _t.Bpp;
+            uint8_t* dst = _t.Dst + y * _t.DstStride;
+            for (int x = _x0; x < _x1; x++)
+                CopyPixel(src + SourceRow(_t, x) * _t.SrcStride, dst + x * _t.Bpp, _t.Bpp);
+        }
+    }
+
+    inline void TransposeTileSSE2(const Transpose& _t, int _x, int _y)
+    {
+        // Load 4 source rows, in destination order, starting at the leftmost source column of the tile.
+        int left = _t.ReverseColumns ? _t.SrcWidth - 4 - _y : _y;
+        const uint8_t* src = _t.Src + left * 4;
+        __m128i r0 = _mm_loadu_si128((const __m128i*)(src + SourceRow(_t, _x + 0) * _t.SrcStride));
+        __m128i r1 = _mm_loadu_si128((const __m128i*)(src + SourceRow(_t, _x + 1) * _t.SrcStride));
+        __m128i r2 = _mm_loadu_si128((const __m128i*)(src + SourceRow(_t, _x + 2) * _t.SrcStride));
+        __m128i r3 = _mm_loadu_si128((const __m128i*)(src + SourceRow(_t, _x + 3) * _t.SrcStride));
+
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+        __m128i c[4];
+        c[0] = _mm_unpacklo_epi64(t0, t1);
+        c[1] = _mm_unpackhi_epi64(t0, t1);
+        c[2] = _mm_unpacklo_epi64(t2, t3);
+        c[3] = _mm_unpackhi_epi64(t2, t3);
+
+        uint8_t* dst = _t.Dst + _x * 4;
+        for (int j = 0; j < 4; j++)
+            _mm_storeu_si128((__m128i*)(dst + DestinationRow(_t, _y, 4, j) * _t.DstStride), c[j]);
+    }
+
+    inline void TransposeTileAVX2(const Transpose& _t, int _x, int _y)
+    {
+        int left = _t.ReverseColumns ? _t.SrcWidth - 8 - _y : _y;
+        const uint8_t* src = _t.Src + left * 4;
+        __m256i r[8];
+        for (int i = 0; i < 8; i++)
+            r[i] = _mm256_loadu_si256((const __m256i*)(src + SourceRow(_t, _x + i) * _t.SrcStride));
+
+        // Transpose 2x2 blocks of pixels, then 2x2 blocks of pairs, within each 128-bit lane.
+        __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+        __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+        __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+        __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+        __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+        // Then swap the 4x4 blocks across lanes.
+        __m256i c[8];
+        c[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        c[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        c[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        c[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        c[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        c[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        c[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        c[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+
+        uint8_t* dst = _t.Dst + _x * 4;
+        for (int j = 0; j < 8; j++)
+            _mm256_storeu_si256((__m256i*)(dst + DestinationRow(_t, _y, 8, j) * _t.DstStride), c[j]);
+    }
+
+    void TransposeBlocked(const Transpose& _t)
+    {
+        int dstWidth = _t.SrcHeight;
+        int dstHeight = _t.SrcWidth;
+
+        // Only 32-bit images have SIMD kernels.
+        int tile = 0;
+        if (_t.Bpp == 4)
+            tile = GetSimdLevel() == SimdAVX2 ? 8 : 4;
+
+        for (int by = 0; by < dstHeight; by += BlockSize)
+        {
+            int byEnd = std::min(by + BlockSize, dstHeight);
+            for (int bx = 0; bx < dstWidth; bx += BlockSize)
+            {
+                int bxEnd = std::min(bx + BlockSize, dstWidth);
+                if (tile == 0)
+                {
+                    TransposeScalar(_t, bx, bxEnd, by, byEnd);
+                    continue;
+                }
+
+                // Full tiles, then the right and bottom borders of the block.
+                int xTiles = bx + ((bxEnd - bx) / tile) * tile;
+                int yTiles = by + ((byEnd - by) / tile) * tile;
+                for (int y = by; y < yTiles; y += tile)
+                {
+                    for (int x = bx; x < xTiles; x += tile)
+                    {
+                        if (tile == 8)
+                            TransposeTileAVX2(_t, x, y);
+                        else
+                            TransposeTileSSE2(_t, x, y);
+                    }
+                }
+
+                TransposeScalar(_t, xTiles, bxEnd, by, yTiles);
+                TransposeScalar(_t, bx, bxEnd, yTiles, byEnd);
+            }
+        }
+
+        if (tile == 8)
+            _mm256_zeroupper();
+    }
+
+    //------------------------------------------------------------------------------------
+    // Upright and upside down.
+    // Rows are copied as is or reversed, optionally starting from the bottom.
+    //------------------------------------------------------------------------------------
+    void CopyRows(const uint8_t* _src, int _width, int _height, int _srcStride, uint8_t* _dst, int _dstStride, int _bpp, bool _reverseRows, bool _reversePixels)
+    {
+        int rowSize = _width * _bpp;
+        for (int y = 0; y < _height; y++)
+        {
+            const uint8_t* src = _src + (_reverseRows ? _height - 1 - y : y) * _srcStride;
+            uint8_t* dst = _dst + y * _dstStride;
+            if (!_reversePixels)
+            {
+                memcpy(dst, src, rowSize);
+                continue;
+            }
+
+            int x = 0;
+            if (_bpp == 4)
+            {
+                for (; x + 4 <= _width; x += 4)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(src + (_width - 4 - x) * 4));
+                    _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+                }
+            }
+
+            for (; x < _width; x++)
+                CopyPixel(src + (_width - 1 - x) * _bpp, dst + x * _bpp, _bpp);
+        }
+    }
+
+    void RotateImage(const uint8_t* _src, int _width, int _height, int _srcStride, uint8_t* _dst, int _dstStride, int _bpp, int _quarterTurns, bool _mirror)
+    {
+        Transpose t;
+        t.Src = _src;
+        t.SrcWidth = _width;
+        t.SrcHeight = _height;
+        t.SrcStride = _srcStride;
+        t.Dst = _dst;
+        t.DstStride = _dstStride;
+        t.Bpp = _bpp;
+
+        switch (_quarterTurns)
+        {
+        case 1:
+            // Clockwise. dst(x, y) = src(y, h - 1 - x). Mirrored: src(y, x).
+            t.ReverseColumns = false;
+            t.ReverseRows = !_mirror;
+            TransposeBlocked(t);
+            break;
+        case 2:
+            CopyRows(_src, _width, _height, _srcStride, _dst, _dstStride, _bpp, true, !_mirror);
+            break;
+        case 3:
+            // Counter clockwise. dst(x, y) = src(w - 1 - y, x). Mirrored: src(w - 1 - y, h - 1 - x).
+            t.ReverseColumns = true;
+            t.ReverseRows = _mirror;
+            TransposeBlocked(t);
+            break;
+        default:
+            CopyRows(_src, _width, _height, _srcStride, _dst, _dstStride, _bpp, false, _mirror);
+            break;
+        }
+    }
+}
+
+#pragma managed
+
+bool ImageRotator::UsesAVX2::get()
+{
+    return GetSimdLevel() == SimdAVX2;
+}
+
+Size ImageRotator::GetRotatedSize(Size _size, ImageRotation _rotation)
+{
+    bool sideways = _rotation == ImageRotation::Rotate90 || _rotation == ImageRotation::Rotate270;
+    return sideways ? Size(_size.Height, _size.Width) : _size;
+}
+
+void ImageRotator::Rotate(IntPtr _src, int _width, int _height, int _srcStride, IntPtr _dst, int _dstStride, int _bytesPerPixel, ImageRotation _rotation, bool _mirror)
+{
+    int quarterTurns = 0;
+    switch (_rotation)
+    {
+    case ImageRotation::Rotate90:
+        quarterTurns = 1;
+        break;
+    case ImageRotation::Rotate180:
+        quarterTurns = 2;
+        break;
+    case ImageRotation::Rotate270:
+        quarterTurns = 3;
+        break;
+    default:
+        break;
+    }
+
+    RotateImage((const uint8_t*)_src.ToPointer(), _width, _height, _srcStride, (uint8_t*)_dst.ToPointer(), _dstStride, _bytesPerPixel, quarterTurns, _mirror);
+}
+
+bool ImageRotator::Rotate(Bitmap^ _src, Bitmap^ _dst, ImageRotation _rotation, bool _mirror)
+{
+    if (_src->PixelFormat != _dst->PixelFormat || _dst->Size != GetRotatedSize(_src->Size, _rotation))
+        return false;
+
+    int bpp = Image::GetPixelFormatSize(_src->PixelFormat) / 8;
+    if (bpp != 3 && bpp != 4)
+        return false;
+
+    BitmapData^ srcData = _src->LockBits(Rectangle(Point::Empty, _src->Size), ImageLockMode::ReadOnly, _src->PixelFormat);
+    BitmapData^ dstData = _dst->LockBits(Rectangle(Point::Empty, _dst->Size), ImageLockMode::WriteOnly, _dst->PixelFormat);
+    
+    Rotate(srcData->Scan0, _src->Width, _src->Height, srcData->Stride, dstData->Scan0, dstData->Stride, bpp, _rotation, _mirror);
+
+    _dst->UnlockBits(dstData);
+    _src->UnlockBits(srcData);
+    return true;
+}
@@ -0,0 +1,67 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+
+using namespace System;
+using namespace System::Drawing;
+using namespace Kinovea::Services;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Rotates images by quarter turns, with optional horizontal mirroring, from one buffer to another.
+    /// The sideways rotations use cache blocked tiled transposes with SSE2 or AVX2 kernels for 32-bit images.
+    /// Used by the video reader for rotated files and by the capture delayer for rotated cameras.
+    /// </summary>
+    public ref class ImageRotator
+    {
+    public:
+        /// <summary>
+        /// Whether the AVX2 kernels are used on this machine.
+        /// </summary>
+        static property bool UsesAVX2 {
+            bool get();
+        }
+
+        /// <summary>
+        /// Returns the size of the image after rotation.
+        /// </summary>
+        static Size GetRotatedSize(Size _size, ImageRotation _rotation);
+
+        /// <summary>
+        /// Rotates the source image into the destination buffer. 
+        /// The width and height are those of the source image, the destination must be large enough for the rotated image.
+        /// Mirroring is applied after the rotation, as in RotateFlipType.RotateXFlipX.
+        /// </summary>
+        static void Rotate(IntPtr _src, int _width, int _height, int _srcStride, IntPtr _dst, int _dstStride, int _bytesPerPixel, ImageRotation _rotation, bool _mirror);
+
+        /// <summary>
+        /// Rotates the source bitmap into the destination bitmap. 
+        /// Both must have the same 24 or 32-bit pixel format and the destination must have the rotated size.
+        /// Returns false if the bitmaps are not compatible.
+        /// </summary>
+        static bool Rotate(Bitmap^ _src, Bitmap^ _dst, ImageRotation _rotation, bool _mirror);
+    };
+}}}
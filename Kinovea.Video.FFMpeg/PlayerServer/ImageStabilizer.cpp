@@ -0,0 +1,216 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <emmintrin.h>
+#include "ImageStabilizer.h"
+
+using namespace Kinovea::Video::FFMpeg;
+
+#pragma unmanaged
+
+namespace
+{
+    // Bilinear weights are stored on 7 bits so the intermediate sums fit in 16-bit lanes.
+    const int WeightBits = 7;
+    const int WeightOne = 1 << WeightBits;
+    const int WeightRound = 1 << (WeightBits - 1);
+
+    inline uint32_t Fetch(const uint8_t* _src, int _width, int _height, int _stride, int _x, int _y)
+    {
+        if (_x < 0 || _y < 0 || _x >= _width || _y >= _height)
+            return 0;
+
+        return *(const uint32_t*)(_src + _y * _stride + _x * 4);
+    }
+
+    inline uint32_t Blend(uint32_t _p00, uint32_t _p10, uint32_t _p01, uint32_t _p11, int _wx, int _wy)
+    {
+        // Same arithmetic as the SIMD path: horizontal pass, rounded back to 8 bits, then vertical pass.
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            int top = ((WeightOne - _wx) * ((_p00 >> shift) & 0xFF) + _wx * ((_p10 >> shift) & 0xFF) + WeightRound) >> WeightBits;
+            int bottom = ((WeightOne - _wx) * ((_p01 >> shift) & 0xFF) + _wx * ((_p11 >> shift) & 0xFF) + WeightRound) >> WeightBits;
+            int value = ((WeightOne - _wy) * top + _wy * bottom + WeightRound) >> WeightBits;
+            result |= (uint32_t)value << shift;
+        }
+
+        return result;
+    }
+
+    inline uint32_t Sample(const uint8_t* _src, int _width, int _height, int _stride, int _x, int _y, int _wx, int _wy)
+    {
+        // Bilinear sample between (x, y) and (x + 1, y + 1). Samples outside the image are transparent.
+        return Blend(
+            Fetch(_src, _width, _height, _stride, _x, _y),
+            Fetch(_src, _width, _height, _stride, _x + 1, _y),
+            Fetch(_src, _width, _height, _stride, _x, _y + 1),
+            Fetch(_src, _width, _height, _stride, _x + 1, _y + 1),
+            _wx, _wy);
+    }
+
+    inline void Split(float _value, int& _integer, int& _weight)
+    {
+        // Integer part and quantized fractional part of a coordinate.
+        float integral = floorf(_value);
+        _integer = (int)integral;
+        _weight = (int)((_value - integral) * WeightOne + 0.5f);
+        if (_weight == WeightOne)
+        {
+            _integer++;
+            _weight = 0;
+        }
+    }
+
+    inline __m128i BlendLanes(__m128i _a, __m128i _b, __m128i _w0, __m128i _w1, __m128i _round)
+    {
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_a, _w0), _mm_mullo_epi16(_b, _w1));
+        return _mm_srli_epi16(_mm_add_epi16(sum, _round), WeightBits);
+    }
+
+    void Translate(const uint8_t* _src, int _width, int _height, int _srcStride, uint8_t* _dst, int _dstStride, float _dx, float _dy)
+    {
+        //------------------------------------------------------------------------------------
+        // For a pure translation the sub-pixel part of the offset is the same for every pixel,
+        // so the bilinear weights are constant and the interior of the image is blended 
+        // 4 pixels at a time. The borders, where some samples fall outside the source, are done per pixel.
+        //------------------------------------------------------------------------------------
+        int ix, wx, iy, wy;
+        Split(_dx, ix, wx);
+        Split(_dy, iy, wy);
+
+        // Second sample offsets. When a weight is zero the second sample is not needed.
+        int ox = wx != 0 ? 1 : 0;
+        int oy = wy != 0 ? 1 : 0;
+
+        // Range of destination columns for which all the samples are inside the source row.
+        int xStart = std::max(0, std::min(_width, -ix));
+        int xEnd = std::max(xStart, std::min(_width, _width - ix - ox));
+
+        __m128i zero = _mm_setzero_si128();
+        __m128i round = _mm_set1_epi16(WeightRound);
+        __m128i wx0 = _mm_set1_epi16((short)(WeightOne - wx));
+        __m128i wx1 = _mm_set1_epi16((short)wx);
+        __m128i wy0 = _mm_set1_epi16((short)(WeightOne - wy));
+        __m128i wy1 = _mm_set1_epi16((short)wy);
+
+        for (int y = 0; y < _height; y++)
+        {
+            uint8_t* dst = _dst + y * _dstStride;
+            int y0 = y + iy;
+            int y1 = y0 + oy;
+
+            if (y0 < -1 || y0 >= _height)
+            {
+                // The whole row is outside the source.
+                memset(dst, 0, _width * 4);
+                continue;
+            }
+
+            if (y0 < 0 || y1 >= _height)
+            {
+                // Top or bottom border.
+                for (int x = 0; x < _width; x++)
+                    *(uint32_t*)(dst + x * 4) = Sample(_src, _width, _height, _srcStride, x + ix, y0, wx, wy);
+
+                continue;
+            }
+
+            const uint8_t* row0 = _src + y0 * _srcStride;
+            const uint8_t* row1 = _src + y1 * _srcStride;
+
+            for (int x = 0; x < xStart; x++)
+                *(uint32_t*)(dst + x * 4) = Sample(_src, _width, _height, _srcStride, x + ix, y0, wx, wy);
+
+            int x = xStart;
+            if (wx == 0 && wy == 0)
+            {
+                // Whole pixel offset.
+                memcpy(dst + x * 4, row0 + (x + ix) * 4, (xEnd - x) * 4);
+                x = xEnd;
+            }
+            else
+            {
+                for (; x + 4 <= xEnd; x += 4)
+                {
+                    __m128i p00 = _mm_loadu_si128((const __m128i*)(row0 + (x + ix) * 4));
+                    __m128i p10 = _mm_loadu_si128((const __m128i*)(row0 + (x + ix + ox) * 4));
+                    __m128i p01 = _mm_loadu_si128((const __m128i*)(row1 + (x + ix) * 4));
+                    __m128i p11 = _mm_loadu_si128((const __m128i*)(row1 + (x + ix + ox) * 4));
+
+                    __m128i topLo = BlendLanes(_mm_unpacklo_epi8(p00, zero), _mm_unpacklo_epi8(p10, zero), wx0, wx1, round);
+                    __m128i topHi = BlendLanes(_mm_unpackhi_epi8(p00, zero), _mm_unpackhi_epi8(p10, zero), wx0, wx1, round);
+                    __m128i bottomLo = BlendLanes(_mm_unpacklo_epi8(p01, zero), _mm_unpacklo_epi8(p11, zero), wx0, wx1, round);
+                    __m128i bottomHi = BlendLanes(_mm_unpackhi_epi8(p01, zero), _mm_unpackhi_epi8(p11, zero), wx0, wx1, round);
+
+                    __m128i lo = BlendLanes(topLo, bottomLo, wy0, wy1, round);
+                    __m128i hi = BlendLanes(topHi, bottomHi, wy0, wy1, round);
+                    _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(lo, hi));
+                }
+            }
+
+            for (; x < _width; x++)
+                *(uint32_t*)(dst + x * 4) = Sample(_src, _width, _height, _srcStride, x + ix, y0, wx, wy);
+        }
+    }
+
+    void Transform(const uint8_t* _src, int _width, int _height, int _srcStride, uint8_t* _dst, int _dstStride, float _dx, float _dy, float _angle)
+    {
+        // General case with rotation. The source position changes linearly along the row.
+        float cosa = cosf(_angle);
+        float sina = sinf(_angle);
+        float cx = _width * 0.5f;
+        float cy = _height * 0.5f;
+
+        for (int y = 0; y < _height; y++)
+        {
+            uint8_t* dst = _dst + y * _dstStride;
+            float sx = cx + cosa * (0 - cx) - sina * (y - cy) + _dx;
+            float sy = cy + sina * (0 - cx) + cosa * (y - cy) + _dy;
+            for (int x = 0; x < _width; x++)
+            {
+                int ix, wx, iy, wy;
+                Split(sx, ix, wx);
+                Split(sy, iy, wy);
+                *(uint32_t*)(dst + x * 4) = Sample(_src, _width, _height, _srcStride, ix, iy, wx, wy);
+                sx += cosa;
+                sy += sina;
+            }
+        }
+    }
+}
+
+#pragma managed
+
+void ImageStabilizer::Stabilize(IntPtr _src, int _width, int _height, int _srcStride, IntPtr _dst, int _dstStride, float _dx, float _dy, float _angle)
+{
+    const uint8_t* src = (const uint8_t*)_src.ToPointer();
+    uint8_t* dst = (uint8_t*)_dst.ToPointer();
+
+    if (_angle == 0)
+        Translate(src, _width, _height, _srcStride, dst, _dstStride, _dx, _dy);
+    else
+        Transform(src, _width, _height, _srcStride, dst, _dstStride, _dx, _dy, _angle);
+}
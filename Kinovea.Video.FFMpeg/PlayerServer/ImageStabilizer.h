@@ -0,0 +1,47 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+
+using namespace System;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Applies the stabilization transform to a 32-bit image, from one buffer to another, in a single pass.
+    /// The source is sampled with bilinear filtering so sub-pixel offsets don't make the image jitter.
+    /// Areas of the destination not covered by the source are transparent.
+    /// </summary>
+    public ref class ImageStabilizer
+    {
+    public:
+        /// <summary>
+        /// Writes the stabilized image into the destination buffer. Both images have the same size.
+        /// dst(x, y) = src(x + dx, y + dy) for a pure translation. 
+        /// If angle is not zero, the destination position is first rotated by this angle (radians, clockwise in image coordinates)
+        /// around the image center.
+        /// </summary>
+        static void Stabilize(IntPtr _src, int _width, int _height, int _srcStride, IntPtr _dst, int _dstStride, float _dx, float _dy, float _angle);
+    };
+}}}
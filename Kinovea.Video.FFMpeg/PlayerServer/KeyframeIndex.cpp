@@ -0,0 +1,218 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+extern "C" {
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <avutil.h>
+}
+
+#include "KeyframeIndex.h"
+
+using namespace Kinovea::Video::FFMpeg;
+
+KeyframeIndex::KeyframeIndex()
+{
+    m_PendingFrames = gcnew List<int64_t>();
+    m_PendingKeyframesPts = gcnew List<int64_t>();
+    m_PendingKeyframesDts = gcnew List<int64_t>();
+}
+
+void KeyframeIndex::Add(int64_t _pts, int64_t _dts, bool _keyframe)
+{
+    // Some containers don't store the presentation timestamp, in this case the decoding timestamp is the best we have.
+    int64_t pts = _pts != AV_NOPTS_VALUE ? _pts : _dts;
+    if (pts == AV_NOPTS_VALUE)
+        return;
+
+    m_PendingFrames->Add(pts);
+
+    if (!_keyframe)
+        return;
+
+    // Demuxers seek on decoding timestamps for most formats.
+    // Since dts <= pts, a backward seek on the dts never lands after the keyframe.
+    m_PendingKeyframesPts->Add(pts);
+    m_PendingKeyframesDts->Add(_dts != AV_NOPTS_VALUE ? _dts : pts);
+}
+
+void KeyframeIndex::Complete()
+{
+    m_Frames = m_PendingFrames->ToArray();
+    Array::Sort(m_Frames);
+
+    m_KeyframesPts = m_PendingKeyframesPts->ToArray();
+    m_KeyframesDts = m_PendingKeyframesDts->ToArray();
+    Array::Sort(m_KeyframesPts, m_KeyframesDts);
+
+    m_PendingFrames = nullptr;
+    m_PendingKeyframesPts = nullptr;
+    m_PendingKeyframesDts = nullptr;
+}
+
+int64_t KeyframeIndex::FindSeekTarget(int64_t _target, int64_t% _keyframePts)
+{
+    _keyframePts = AV_NOPTS_VALUE;
+    if (m_KeyframesPts == nullptr)
+        return AV_NOPTS_VALUE;
+
+    // Last keyframe at or before the target.
+    int index = LowerBound(m_KeyframesPts, _target + 1) - 1;
+    if (index < 0)
+        return AV_NOPTS_VALUE;
+
+    _keyframePts = m_KeyframesPts[index];
+    return m_KeyframesDts[index];
+}
+
+bool KeyframeIndex::FindGroupBounds(int64_t _from, int64_t _to, int64_t% _start, int64_t% _end)
+{
+    _start = AV_NOPTS_VALUE;
+    _end = AV_NOPTS_VALUE;
+    if (m_KeyframesPts == nullptr || m_Frames == nullptr || m_Frames->Length == 0)
+        return false;
+
+    int first = LowerBound(m_KeyframesPts, _from + 1) - 1;
+    if (first < 0)
+        return false;
+
+    _start = m_KeyframesPts[first];
+
+    // The frame before the next keyframe exists since the first keyframe is presented before it.
+    int next = LowerBound(m_KeyframesPts, _to + 1);
+    if (next < m_KeyframesPts->Length)
+        _end = m_Frames[LowerBound(m_Frames, m_KeyframesPts[next]) - 1];
+    else
+        _end = m_Frames[m_Frames->Length - 1];
+
+    return true;
+}
+
+int KeyframeIndex::CountFrames(int64_t _from, int64_t _to)
+{
+    if (m_Frames == nullptr || _to < _from)
+        return 0;
+
+    return LowerBound(m_Frames, _to + 1) - LowerBound(m_Frames, _from);
+}
+
+void KeyframeIndex::Write(BinaryWriter^ _writer)
+{
+    if (m_Frames == nullptr)
+        throw gcnew InvalidOperationException("The keyframe index must be complete before being written.");
+
+    WriteTimestamps(_writer, m_Frames);
+    WriteTimestamps(_writer, m_KeyframesPts);
+    WriteTimestamps(_writer, m_KeyframesDts);
+}
+
+KeyframeIndex^ KeyframeIndex::Read(BinaryReader^ _reader)
+{
+    KeyframeIndex^ index = gcnew KeyframeIndex();
+    index->m_Frames = ReadTimestamps(_reader);
+    index->m_KeyframesPts = ReadTimestamps(_reader);
+    index->m_KeyframesDts = ReadTimestamps(_reader);
+    if (index->m_KeyframesPts->Length != index->m_KeyframesDts->Length)
+        throw gcnew InvalidDataException("Keyframe index: mismatched keyframe tables.");
+
+    index->m_PendingFrames = nullptr;
+    index->m_PendingKeyframesPts = nullptr;
+    index->m_PendingKeyframesDts = nullptr;
+    return index;
+}
+
+void KeyframeIndex::WriteTimestamps(BinaryWriter^ _writer, array<int64_t>^ _values)
+{
+    // Consecutive timestamps are close to each other, the deltas are zigzag-encoded 
+    // and written 7 bits at a time, so a typical frame takes one or two bytes instead of eight.
+    _writer->Write(_values->Length);
+    int64_t previous = 0;
+    for (int i = 0; i < _values->Length; i++)
+    {
+        int64_t delta = _values[i] - previous;
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+        while (zigzag >= 0x80)
+        {
+            _writer->Write((Byte)(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+
+        _writer->Write((Byte)zigzag);
+        previous = _values[i];
+    }
+}
+
+array<int64_t>^ KeyframeIndex::ReadTimestamps(BinaryReader^ _reader)
+{
+    int count = _reader->ReadInt32();
+    int64_t remaining = _reader->BaseStream->Length - _reader->BaseStream->Position;
+    if (count < 0 || count > remaining)
+        throw gcnew InvalidDataException("Keyframe index: invalid table size.");
+
+    array<int64_t>^ values = gcnew array<int64_t>(count);
+    int64_t previous = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t zigzag = 0;
+        int shift = 0;
+        Byte b;
+        do
+        {
+            if (shift > 63)
+                throw gcnew InvalidDataException("Keyframe index: invalid timestamp.");
+
+            b = _reader->ReadByte();
+            zigzag |= (uint64_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while ((b & 0x80) != 0);
+
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        values[i] = previous + delta;
+        previous = values[i];
+    }
+
+    return values;
+}
+
+int KeyframeIndex::LowerBound(array<int64_t>^ _values, int64_t _value)
+{
+    // Index of the first element greater or equal to the value.
+    int first = 0;
+    int count = _values->Length;
+    while (count > 0)
+    {
+        int step = count / 2;
+        int middle = first + step;
+        if (_values[middle] < _value)
+        {
+            first = middle + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    return first;
+}
@@ -0,0 +1,109 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::IO;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Presentation timestamps of all the frames of the video stream, and position of the keyframes.
+    /// Built by scanning the packets of the file without decoding them.
+    /// Timestamps are raw stream timestamps, without the reader timestamp offset.
+    /// Used to seek exactly to the keyframe preceding a target and to know how many frames must be decoded to reach it.
+    /// </summary>
+    public ref class KeyframeIndex
+    {
+    public:
+        /// <summary>
+        /// Number of frames in the index.
+        /// </summary>
+        property int FrameCount {
+            int get() { return m_Frames != nullptr ? m_Frames->Length : m_PendingFrames->Count; }
+        }
+        /// <summary>
+        /// Number of keyframes in the index.
+        /// </summary>
+        property int KeyframeCount {
+            int get() { return m_KeyframesPts != nullptr ? m_KeyframesPts->Length : m_PendingKeyframesPts->Count; }
+        }
+
+    public:
+        KeyframeIndex();
+
+        /// <summary>
+        /// Adds a packet of the video stream. Packets are added in decoding order.
+        /// </summary>
+        void Add(int64_t _pts, int64_t _dts, bool _keyframe);
+
+        /// <summary>
+        /// Sorts the entries in presentation order. Must be called once all the packets have been added, before any query.
+        /// </summary>
+        void Complete();
+
+        /// <summary>
+        /// Finds the last keyframe presented at or before the target.
+        /// Returns the timestamp to pass to the demuxer to seek to it, or AV_NOPTS_VALUE if there is no such keyframe.
+        /// </summary>
+        int64_t FindSeekTarget(int64_t _target, int64_t% _keyframePts);
+
+        /// <summary>
+        /// Finds the smallest run of whole groups of pictures presenting the range [from, to].
+        /// It starts on the last keyframe at or before from, and ends on the last frame presented before the first keyframe after to,
+        /// or on the last frame of the stream. Returns false if there is no keyframe at or before from.
+        /// </summary>
+        bool FindGroupBounds(int64_t _from, int64_t _to, int64_t% _start, int64_t% _end);
+
+        /// <summary>
+        /// Number of frames presented in the range [from, to].
+        /// </summary>
+        int CountFrames(int64_t _from, int64_t _to);
+
+        /// <summary>
+        /// Writes a completed index. Timestamps are delta-encoded as variable-length integers.
+        /// </summary>
+        void Write(BinaryWriter^ _writer);
+
+        /// <summary>
+        /// Reads an index written by Write. The returned index is already complete.
+        /// </summary>
+        static KeyframeIndex^ Read(BinaryReader^ _reader);
+
+    private:
+        static int LowerBound(array<int64_t>^ _values, int64_t _value);
+        static void WriteTimestamps(BinaryWriter^ _writer, array<int64_t>^ _values);
+        static array<int64_t>^ ReadTimestamps(BinaryReader^ _reader);
+
+    private:
+        List<int64_t>^ m_PendingFrames;
+        List<int64_t>^ m_PendingKeyframesPts;
+        List<int64_t>^ m_PendingKeyframesDts;
+        array<int64_t>^ m_Frames;
+        array<int64_t>^ m_KeyframesPts;
+        array<int64_t>^ m_KeyframesDts;
+    };
+}}}
@@ -19,6 +19,7 @@ along with Kinovea. If not, see http://www.gnu.org/licenses/.
 */
 
 #include "MJPEGWriter.h"
+#include <msclr\lock.h>
 
 using namespace System::Diagnostics;
 using namespace System::Drawing;
@@ -28,13 +29,15 @@ using namespace System::Runtime::InteropServices;
 
 using namespace Kinovea::Video;
 using namespace Kinovea::Video::FFMpeg;
+using namespace msclr;
 
 MJPEGWriter::MJPEGWriter()
 {
     av_register_all();
     m_swEncoding = gcnew Stopwatch();
     m_swWrite = gcnew Stopwatch();
-
+    m_writeLocker = gcnew Object();
+    m_releaseLocker = gcnew Object();
 }
 MJPEGWriter::~MJPEGWriter()
 {
@@ -57,6 +60,10 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
 
     SaveResult result = SaveResult::Success;
     m_frame = 0;
+    m_framesWritten = 0;
+    m_nextToWrite = 0;
+    m_framesReleased = 0;
+    m_workerFailed = false;
     m_swEncoding->Start();
     m_swWrite->Start();
 
@@ -118,8 +125,25 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
         }
 
         // 4. Find encoder.
-        AVCodecID codecId = _uncompressed ? AV_CODEC_ID_RAWVIDEO : AV_CODEC_ID_MJPEG;
-        if ((m_SavingContext->pOutputCodec = avcodec_find_encoder(codecId)) == nullptr)
+        // The profile only applies to compressed recording of raw images, JPEG samples are always stored as MJPEG.
+        EncoderSettings^ encoderSettings = m_encoderSettings;
+        if (encoderSettings == nullptr || _uncompressed || _imageFormat == Kinovea::Services::ImageFormat::JPEG)
+            encoderSettings = gcnew EncoderSettings(EncoderProfile::MJPEG);
+
+        if (!EncoderProfiles::IsSupported(encoderSettings->Profile, format))
+        {
+            log->WarnFormat("Encoder profile {0} not supported in this container, falling back to MJPEG.", encoderSettings->Profile);
+            encoderSettings = gcnew EncoderSettings(EncoderProfile::MJPEG);
+        }
+
+        m_SavingContext->encoderProfile = encoderSettings->Profile;
+        
+        if (_uncompressed)
+            m_SavingContext->pOutputCodec = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
+        else
+            m_SavingContext->pOutputCodec = EncoderProfiles::FindEncoder(encoderSettings->Profile);
+        
+        if (m_SavingContext->pOutputCodec == nullptr)
         {
             result = SaveResult::EncoderNotFound;
             log->Error("Encoder not found");
@@ -163,8 +187,20 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
 
         m_SavingContext->pOutputFormatContext->video_codec_id = m_SavingContext->pOutputCodec->id;
 
+        // In parallel mode each worker has its own single-threaded encoder, the main one is only used as a template.
+        bool parallel = m_encoderThreads > 1 && !_uncompressed && m_SavingContext->encoderProfile == EncoderProfile::MJPEG;
+        
+        AVDictionary* encoderOptions = nullptr;
+        if (!_uncompressed)
+        {
+            EncoderProfiles::Configure(m_SavingContext->pOutputCodecContext, encoderSettings, &encoderOptions);
+            if (parallel)
+                m_SavingContext->pOutputCodecContext->thread_count = 1;
+        }
+
         // 7. Open the encoder.
-        averror = avcodec_open2(m_SavingContext->pOutputCodecContext, m_SavingContext->pOutputCodec, nullptr);
+        averror = avcodec_open2(m_SavingContext->pOutputCodecContext, m_SavingContext->pOutputCodec, &encoderOptions);
+        av_dict_free(&encoderOptions);
         if (averror < 0)
         {
             result = SaveResult::EncoderNotOpened;
@@ -179,14 +215,19 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
 
         
         // 9. Open the file.
-        averror = avio_open(&(m_SavingContext->pOutputFormatContext)->pb, m_SavingContext->pFilePath, AVIO_FLAG_WRITE);
-        if (averror < 0) 
+        // The file is written by its own thread so a disk stall doesn't immediately stall the encoding.
+        // The queue holds about a second of data to ride out these stalls.
+        m_output = gcnew WriteBehindStream(WriteBehindChunkSize, ComputeWriteBehindCapacity(_uncompressed, _fFramesInterval));
+        if (!m_output->Open(_filePath)) 
         {
             result = SaveResult::FileNotOpened;
-            LogError("File not opened", averror);
+            log->Error("File not opened");
             break;
         }
 
+        m_SavingContext->pOutputFormatContext->pb = m_output->Context;
+        m_SavingContext->pOutputFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
         SanityCheck(m_SavingContext->pOutputFormatContext);
 
         // 10. Write file header.
@@ -219,10 +260,32 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
         
         SwsContext* scalingContext = sws_getContext(
             m_SavingContext->outputSize.Width, m_SavingContext->outputSize.Height, srcFormat,
-            m_SavingContext->outputSize.Width, m_SavingContext->outputSize.Height, AV_PIX_FMT_YUV420P, flags,
+            m_SavingContext->outputSize.Width, m_SavingContext->outputSize.Height, GetEncoderPixelFormat(m_SavingContext), flags,
             NULL, NULL, NULL);
 
         m_SavingContext->pScalingContext = scalingContext;
+
+        // 13. Allocate the conversion and output buffers (will be reused for each frame).
+        // At high framerates allocating and freeing them for every frame shows up in the encoding time.
+        if (!AllocateFrameBuffers(m_SavingContext))
+        {
+            result = SaveResult::InputFrameNotAllocated;
+            log->Error("Frame buffers not allocated");
+            break;
+        }
+
+        // 14. Start the encoder threads.
+        // JPEG samples are passed through and uncompressed frames are only converted, these stay on the calling thread.
+        // The other profiles are inter-frame or already threaded inside the encoder.
+        if (parallel && _imageFormat != Kinovea::Services::ImageFormat::JPEG)
+        {
+            if (!StartEncoderWorkers(srcFormat))
+            {
+                result = SaveResult::EncoderNotOpened;
+                log->Error("Encoder threads not started");
+                break;
+            }
+        }
     }
     while(false);
 
@@ -274,6 +337,16 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
     log->Debug("Closing the saving context.");
 
     SaveResult result = SaveResult::Success;
+    
+    // Frames still being encoded are written before the trailer.
+    StopEncoderWorkers();
+
+    if (_bEncodingSuccess && m_SavingContext->bEncoderOpened && !m_SavingContext->uncompressed && !EncoderProfiles::IsLegacy(m_SavingContext->encoderProfile))
+    {
+        int flushed = EncoderProfiles::Flush(m_SavingContext->pOutputFormatContext, m_SavingContext->pOutputVideoStream, m_SavingContext->pOutputCodecContext);
+        m_framesWritten += flushed;
+    }
+
     m_swEncoding->Stop();
     m_swWrite->Stop();
 
@@ -298,8 +371,15 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
         av_freep(&(m_SavingContext->pOutputFormatContext)->streams[i]);
     }
 
-    // Close file.
-    avio_close(m_SavingContext->pOutputFormatContext->pb);
+    // Close file. Waits for the pending writes.
+    if (m_output != nullptr)
+    {
+        if (!m_output->Close())
+            result = SaveResult::UnknownError;
+
+        delete m_output;
+        m_output = nullptr;
+    }
 
     // Release muxer parameter object.
     av_free(m_SavingContext->pOutputFormatContext);
@@ -309,7 +389,8 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
     // Release scaling context
     sws_freeContext(m_SavingContext->pScalingContext);
 
-    // Release input frame buffer.
+    // Release the per-frame buffers.
+    FreeFrameBuffers(m_SavingContext);
 
     log->Debug("Saving video completed.");
 
@@ -323,6 +404,27 @@ SaveResult MJPEGWriter::SaveFrame(Kinovea::Services::ImageFormat format, array<S
 
     m_frame++;
 
+    if (m_encodingQueue != nullptr)
+    {
+        // Parallel mode. The frame is converted and encoded by one of the workers and written in order later.
+        // Adding blocks while all the workers are busy and the queue is full. This pushes back on the caller,
+        // which stops consuming, and lets the producer account for the frames it has to drop.
+        EncodingJob job;
+        job.Sequence = m_frame - 1;
+        job.Buffer = buffer;
+        job.TopDown = topDown;
+        m_encodingQueue->Add(job);
+
+        // Errors on previous frames are reported late.
+        if (m_workerFailed)
+        {
+            m_workerFailed = false;
+            result = SaveResult::UnknownError;
+        }
+
+        return result;
+    }
+
     switch (format)
     {
     case Kinovea::Services::ImageFormat::RGB32:
@@ -348,6 +450,28 @@ SaveResult MJPEGWriter::SaveFrame(Kinovea::Services::ImageFormat format, array<S
     return result;
 }
 
+Int64 MJPEGWriter::FramesReleased::get()
+{
+    if (m_encodingQueue == nullptr)
+        return m_frame;
+
+    lock l(m_releaseLocker);
+    return m_framesReleased;
+}
+
+int MJPEGWriter::ComputeWriteBehindCapacity(bool uncompressed, double frameInterval)
+{
+    // Number of chunks for about one second of recording.
+    // Constant quantization JPEG at q=1 is roughly a quarter of the YUV420 size.
+    double frameSize = avpicture_get_size(AV_PIX_FMT_YUV420P, m_SavingContext->outputSize.Width, m_SavingContext->outputSize.Height);
+    if (!uncompressed)
+        frameSize /= 4;
+
+    double fps = frameInterval > 0 ? 1000.0 / frameInterval : 25.0;
+    int chunks = (int)Math::Ceiling(frameSize * fps / WriteBehindChunkSize);
+    return Math::Max(8, Math::Min(64, chunks));
+}
+
 double MJPEGWriter::ComputeBitrate(Size outputSize, double frameInterval)
 {
     // Note that this parameter is not used anyway as we switched to constant quantization.
@@ -553,312 +677,445 @@ bool MJPEGWriter::SetupEncoder(SavingContext^ _SavingContext, Kinovea::Services:
 }
 
 ///<summary>
-/// Encode an RGB32 image into a JPEG and push it to the file.
+/// Allocate the color conversion and output buffers, they are reused for every frame of the recording.
 ///</summary>
-bool MJPEGWriter::EncodeAndWriteVideoFrameRGB32(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+bool MJPEGWriter::AllocateFrameBuffers(SavingContext^ _SavingContext)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
+
+    AVPixelFormat pixelFormat = GetEncoderPixelFormat(_SavingContext);
     
-    do
-    {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
+    if ((_SavingContext->pYUV420Frame = av_frame_alloc()) == nullptr)
+        return false;
+
+    // av_malloc aligns the buffers for the SIMD code paths of swscale and of the encoder.
+    _SavingContext->iYUV420BufferSize = avpicture_get_size(pixelFormat, width, height);
+    _SavingContext->pYUV420Buffer = (uint8_t*)av_malloc(_SavingContext->iYUV420BufferSize);
+    if (_SavingContext->pYUV420Buffer == nullptr)
+        return false;
+
+    avpicture_fill((AVPicture*)_SavingContext->pYUV420Frame, _SavingContext->pYUV420Buffer, pixelFormat, width, height);
+    _SavingContext->pYUV420Frame->width = width;
+    _SavingContext->pYUV420Frame->height = height;
+    _SavingContext->pYUV420Frame->format = pixelFormat;
+
+    if (_SavingContext->uncompressed)
+        return true;
+
+    // Assumes compressed size is always smaller than uncompressed. (Not technically true, keep some headroom).
+    _SavingContext->iOutputBufferSize = _SavingContext->iYUV420BufferSize + FF_MIN_BUFFER_SIZE;
+    _SavingContext->pOutputBuffer = (uint8_t*)av_malloc(_SavingContext->iOutputBufferSize);
+    
+    return _SavingContext->pOutputBuffer != nullptr;
+}
 
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
-        
-        pin_ptr<uint8_t> pRGB32Buffer = &managedBuffer[0];
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pRGB32Buffer, AV_PIX_FMT_BGRA, width, height);
-        
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
-        {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
-        }
+///<summary>
+/// Pixel format of the frames passed to the encoder. Uncompressed frames are stored as YUV420P.
+///</summary>
+AVPixelFormat MJPEGWriter::GetEncoderPixelFormat(SavingContext^ _SavingContext)
+{
+    if (_SavingContext->uncompressed)
+        return AV_PIX_FMT_YUV420P;
+    
+    return _SavingContext->pOutputCodecContext->pix_fmt;
+}
 
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("YUV420P frame not allocated");
-            break;
-        }
+void MJPEGWriter::FreeFrameBuffers(SavingContext^ _SavingContext)
+{
+    if (_SavingContext->pYUV420Frame != nullptr)
+    {
+        AVFrame* pFrame = _SavingContext->pYUV420Frame;
+        av_frame_free(&pFrame);
+        _SavingContext->pYUV420Frame = nullptr;
+    }
 
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
-        }
-        
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
-        
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
-        {
-            log->Error("Color conversion failed");
-            break;
-        }
-        
-        int encodedSize = yuvBufferSize;
-        if (!_SavingContext->uncompressed)
-        {
-            // Allocated JPEG frame buffer. 
-            // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-            int jpegBufferSize = yuvBufferSize;
-            pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-            if (pJpegBuffer == nullptr)
-            {
-                log->Error("output video buffer not allocated");
-                break;
-            }
+    if (_SavingContext->pYUV420Buffer != nullptr)
+    {
+        av_free(_SavingContext->pYUV420Buffer);
+        _SavingContext->pYUV420Buffer = nullptr;
+    }
 
-            // Actual encoding step.
-            encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
-        }
+    if (_SavingContext->pOutputBuffer != nullptr)
+    {
+        av_free(_SavingContext->pOutputBuffer);
+        _SavingContext->pOutputBuffer = nullptr;
+    }
+}
 
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
-        
-        if (encodedSize <= 0)
-            break;
+///<summary>
+/// Encode an RGB32 image into a JPEG and push it to the file.
+///</summary>
+bool MJPEGWriter::EncodeAndWriteVideoFrameRGB32(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+{
+    pin_ptr<uint8_t> pRGB32Buffer = &managedBuffer[0];
+    return ConvertEncodeAndWrite(_SavingContext, pRGB32Buffer, AV_PIX_FMT_BGRA, topDown);
+}
 
-        if (_SavingContext->uncompressed)
-            WriteBuffer(encodedSize, _SavingContext, pYUV420Buffer, true);
-        else
-            WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
+///<summary>
+/// Encode an RGB24 image into a JPEG and push it to the file.
+///</summary>
+bool MJPEGWriter::EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+{
+    pin_ptr<uint8_t> pRGB24Buffer = &managedBuffer[0];
+    return ConvertEncodeAndWrite(_SavingContext, pRGB24Buffer, AV_PIX_FMT_BGR24, topDown);
+}
+
+///<summary>
+/// Encode a monochrome 8 image into a JPEG and push it to the file.
+///</summary>
+bool MJPEGWriter::EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+{
+    pin_ptr<uint8_t> pInputBuffer = &managedBuffer[0];
         
-        written = true;
+    if (!_SavingContext->uncompressed)
+    {
+        // Unfortunately the MJPEG encoder doesn't know how to work directly with Y800/GRAY8 images.
+        // Instead of directly pushing the buffer to the AVFrame we need to use an intermediate YUV420p frame.
+        return ConvertEncodeAndWrite(_SavingContext, pInputBuffer, AV_PIX_FMT_GRAY8, topDown);
     }
-    while(false);
 
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
+    // Special shortcut for uncompressed Y800. 
+    Int64 then = m_swEncoding->ElapsedMilliseconds;
+    
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
+    if (length > _SavingContext->iYUV420BufferSize)
+    {
+        log->Error("Y800 frame larger than the output size");
+        return false;
+    }
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
+    uint8_t* pBuffer = _SavingContext->pYUV420Buffer;
+    if (topDown)
+    {
+        memcpy(pBuffer, pInputBuffer, (size_t)length);
+    }
+    else
+    {
+        for (int i = 0; i < height; i++)
+        {
+            uint8_t* pDst = pBuffer + i * width;
+            uint8_t* pSrc = pInputBuffer + ((height - 1 - i) * width);
+            memcpy(pDst, pSrc, width);
+        }
+    }
 
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
+    m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
 
-    return written;
+    WriteBuffer((int)length, _SavingContext, pBuffer, true);
+    return true;
 }
 
-
 ///<summary>
-/// Encode an RGB24 image into a JPEG and push it to the file.
+/// Convert an image to YUV420P, encode it into a JPEG unless saving uncompressed, and push it to the file.
+/// Works in the buffers of the saving context, nothing is allocated.
 ///</summary>
-bool MJPEGWriter::EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+bool MJPEGWriter::ConvertEncodeAndWrite(SavingContext^ _SavingContext, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool topDown)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
+    Int64 then = m_swEncoding->ElapsedMilliseconds;
+
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
     
-    do
+    avpicture_fill((AVPicture*)_SavingContext->pInputFrame, _pInputBuffer, _inputFormat, width, height);
+    
+    // Alter planes and stride to vertically flip image during conversion.
+    if (!topDown)
     {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
+      _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
+      _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
+    }
 
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
-        
-        pin_ptr<uint8_t> pRGB24Buffer = &managedBuffer[0];
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pRGB24Buffer, AV_PIX_FMT_BGR24, width, height);
+    // Perform the color space conversion.
+    AVFrame* pYUV420Frame = _SavingContext->pYUV420Frame;
+    if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
+    {
+        log->Error("Color conversion failed");
+        return false;
+    }
+    
+    if (!_SavingContext->uncompressed && !EncoderProfiles::IsLegacy(_SavingContext->encoderProfile))
+    {
+        // Packet API. Inter-frame encoders may hold on to the frame and output the packet later.
+        pYUV420Frame->pts = _SavingContext->iFramesEncoded++;
+        int written = EncoderProfiles::EncodeAndWrite(_SavingContext->pOutputFormatContext, _SavingContext->pOutputVideoStream, _SavingContext->pOutputCodecContext, pYUV420Frame);
+        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
         
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
+        if (written < 0)
         {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
+            LogError("Frame not encoded", written);
+            return false;
         }
 
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
+        if (written > 0)
         {
-            log->Error("YUV420P frame not allocated");
-            break;
+            m_framesWritten += written;
+            LogStats();
         }
 
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
-        }
-        
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
-        
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
-        {
-            log->Error("Color conversion failed");
-            break;
-        }
+        return true;
+    }
 
-        int encodedSize = yuvBufferSize;
-        if (!_SavingContext->uncompressed)
-        {
-            // Allocated JPEG frame buffer. 
-            // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-            int jpegBufferSize = yuvBufferSize;
-            pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-            if (pJpegBuffer == nullptr) 
-            {
-                log->Error("output video buffer not allocated");
-                break;
-            }
-        
-            // Actual encoding step.
-            encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
-        }
+    int encodedSize = _SavingContext->iYUV420BufferSize;
+    if (!_SavingContext->uncompressed)
+    {
+        // Actual encoding step.
+        encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, _SavingContext->pOutputBuffer, _SavingContext->iOutputBufferSize, pYUV420Frame);
+    }
 
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
+    m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
+    
+    if (encodedSize <= 0)
+        return false;
 
-        if (encodedSize <= 0)
-            break;
+    if (_SavingContext->uncompressed)
+        WriteBuffer(encodedSize, _SavingContext, _SavingContext->pYUV420Buffer, true);
+    else
+        WriteBuffer(encodedSize, _SavingContext, _SavingContext->pOutputBuffer, true);
+    
+    return true;
+}
 
-        if (_SavingContext->uncompressed)
-            WriteBuffer(encodedSize, _SavingContext, pYUV420Buffer, true);
-        else
-            WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
 
-        written = true;
+///<summary>
+/// Create the per-thread encoders and start the threads of the parallel encoding mode.
+///</summary>
+bool MJPEGWriter::StartEncoderWorkers(AVPixelFormat _inputFormat)
+{
+    log->DebugFormat("Starting {0} encoder threads.", m_encoderThreads);
+
+    m_inputFormat = _inputFormat;
+    m_workerContexts = gcnew List<EncoderWorkerContext^>();
+    for (int i = 0; i < m_encoderThreads; i++)
+    {
+        EncoderWorkerContext^ worker = gcnew EncoderWorkerContext();
+        m_workerContexts->Add(worker);
+        if (!OpenWorkerContext(worker, _inputFormat))
+            return false;
     }
-    while(false);
 
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
+    // One pending frame per worker on top of the ones being encoded. Past that SaveFrame blocks.
+    m_encodingQueue = gcnew BlockingCollection<EncodingJob>(m_encoderThreads);
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
+    // Frames waiting in the queue plus the ones being converted are the only ones not yet released.
+    m_released = gcnew array<bool>(m_encoderThreads * 2 + 1);
 
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
+    m_workerThreads = gcnew List<Thread^>();
+    for (int i = 0; i < m_encoderThreads; i++)
+    {
+        Thread^ thread = gcnew Thread(gcnew ParameterizedThreadStart(this, &MJPEGWriter::EncoderWorker));
+        thread->Name = String::Format("Encoder {0}", i);
+        thread->IsBackground = true;
+        m_workerThreads->Add(thread);
+        thread->Start(m_workerContexts[i]);
+    }
 
-    return written;
+    return true;
 }
 
+void MJPEGWriter::StopEncoderWorkers()
+{
+    // No more frames will come, let the workers flush the queue and exit.
+    if (m_encodingQueue != nullptr)
+    {
+        m_encodingQueue->CompleteAdding();
+        for each (Thread^ thread in m_workerThreads)
+            thread->Join();
+
+        delete m_encodingQueue;
+        m_encodingQueue = nullptr;
+        m_workerThreads = nullptr;
+    }
+
+    if (m_workerContexts != nullptr)
+    {
+        for each (EncoderWorkerContext^ worker in m_workerContexts)
+            CloseWorkerContext(worker);
+
+        m_workerContexts = nullptr;
+    }
+}
 
 ///<summary>
-/// Encode a monochrome 8 image into a JPEG and push it to the file.
+/// Open a private encoder, scaler and buffers for one worker.
+/// The encoder parameters are copied from the main codec context, which is then only used to describe the stream to the muxer.
 ///</summary>
-bool MJPEGWriter::EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+bool MJPEGWriter::OpenWorkerContext(EncoderWorkerContext^ _worker, AVPixelFormat _inputFormat)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
-    
-    do
+    int width = m_SavingContext->outputSize.Width;
+    int height = m_SavingContext->outputSize.Height;
+
+    if ((_worker->pCodecContext = avcodec_alloc_context3(m_SavingContext->pOutputCodec)) == nullptr)
+        return false;
+
+    int averror = avcodec_copy_context(_worker->pCodecContext, m_SavingContext->pOutputCodecContext);
+    if (averror < 0)
     {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
+        LogError("Encoder parameters not copied", averror);
+        return false;
+    }
 
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
+    // Parallelism is at the frame level, the encoder itself must not spawn more threads.
+    _worker->pCodecContext->thread_count = 1;
 
-        pin_ptr<uint8_t> pInputBuffer = &managedBuffer[0];
-        
-        if (_SavingContext->uncompressed)
+    averror = avcodec_open2(_worker->pCodecContext, m_SavingContext->pOutputCodec, nullptr);
+    if (averror < 0)
+    {
+        LogError("Worker encoder not opened", averror);
+        return false;
+    }
+
+    _worker->pScalingContext = sws_getContext(
+        width, height, _inputFormat,
+        width, height, AV_PIX_FMT_YUV420P, SWS_POINT,
+        NULL, NULL, NULL);
+
+    if (_worker->pScalingContext == nullptr)
+        return false;
+
+    if ((_worker->pInputFrame = av_frame_alloc()) == nullptr || (_worker->pYUV420Frame = av_frame_alloc()) == nullptr)
+        return false;
+
+    if ((_worker->pYUV420Buffer = (uint8_t*)av_malloc(m_SavingContext->iYUV420BufferSize)) == nullptr)
+        return false;
+
+    avpicture_fill((AVPicture*)_worker->pYUV420Frame, _worker->pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
+
+    _worker->iOutputBufferSize = m_SavingContext->iOutputBufferSize;
+    _worker->pOutputBuffer = (uint8_t*)av_malloc(_worker->iOutputBufferSize);
+
+    return _worker->pOutputBuffer != nullptr;
+}
+
+void MJPEGWriter::CloseWorkerContext(EncoderWorkerContext^ _worker)
+{
+    if (_worker->pCodecContext != nullptr)
+    {
+        AVCodecContext* pCodecContext = _worker->pCodecContext;
+        avcodec_free_context(&pCodecContext);
+        _worker->pCodecContext = nullptr;
+    }
+
+    sws_freeContext(_worker->pScalingContext);
+    _worker->pScalingContext = nullptr;
+
+    AVFrame* pInputFrame = _worker->pInputFrame;
+    av_frame_free(&pInputFrame);
+    _worker->pInputFrame = nullptr;
+
+    AVFrame* pYUV420Frame = _worker->pYUV420Frame;
+    av_frame_free(&pYUV420Frame);
+    _worker->pYUV420Frame = nullptr;
+
+    av_free(_worker->pYUV420Buffer);
+    _worker->pYUV420Buffer = nullptr;
+
+    av_free(_worker->pOutputBuffer);
+    _worker->pOutputBuffer = nullptr;
+}
+
+void MJPEGWriter::EncoderWorker(Object^ _worker)
+{
+    EncoderWorkerContext^ worker = (EncoderWorkerContext^)_worker;
+    int width = m_SavingContext->outputSize.Width;
+    int height = m_SavingContext->outputSize.Height;
+
+    for each (EncodingJob job in m_encodingQueue->GetConsumingEnumerable())
+    {
+        Int64 then = m_swEncoding->ElapsedMilliseconds;
+        bool released = false;
+        bool written = false;
+
+        try
         {
-            // Special shortcut for uncompressed Y800. 
-            pYUV420Buffer = (uint8_t*)av_malloc(length);
-            if (topDown)
+            pin_ptr<uint8_t> pInputBuffer = &job.Buffer[0];
+            avpicture_fill((AVPicture*)worker->pInputFrame, pInputBuffer, m_inputFormat, width, height);
+            
+            if (!job.TopDown)
             {
-                memcpy(pYUV420Buffer, pInputBuffer, length);
+                worker->pInputFrame->data[0] += worker->pInputFrame->linesize[0] * (height - 1);
+                worker->pInputFrame->linesize[0] = -worker->pInputFrame->linesize[0];
             }
+
+            bool converted = sws_scale(worker->pScalingContext, worker->pInputFrame->data, worker->pInputFrame->linesize, 0, height, worker->pYUV420Frame->data, worker->pYUV420Frame->linesize) >= 0;
+            pInputBuffer = nullptr;
+
+            // From here on the caller is free to reuse the input buffer.
+            ReleaseInput(job.Sequence);
+            released = true;
+
+            int encodedSize = 0;
+            if (converted)
+                encodedSize = avcodec_encode_video(worker->pCodecContext, worker->pOutputBuffer, worker->iOutputBufferSize, worker->pYUV420Frame);
             else
-            {
-                for (int i = 0; i < height; i++)
-                {
-                    uint8_t* pDst = pYUV420Buffer + i * width;
-                    uint8_t* pSrc = pInputBuffer + ((height - 1 - i) * width);
-                    memcpy(pDst, pSrc, width);
-                }
-            }
+                log->Error("Color conversion failed");
 
-            m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
+            Interlocked::Add(m_encodingDurationAccumulator, m_swEncoding->ElapsedMilliseconds - then);
 
-            WriteBuffer((int)length, _SavingContext, pYUV420Buffer, true);
+            WriteInOrder(job.Sequence, encodedSize, worker->pOutputBuffer);
             written = true;
-            break;
         }
-
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pInputBuffer, AV_PIX_FMT_GRAY8, width, height);
-        
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
+        catch (Exception^ e)
         {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
-        }
-        
-        // Unfortunately the MJPEG encoder doesn't know how to work directly with Y800/GRAY8 images.
-        // Instead of directly pushing the buffer to the AVFrame we need to use an intermediate YUV420p frame.
-        
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("YUV420P frame not allocated");
-            break;
-        }
+            log->ErrorFormat("Error while encoding frame {0}. {1}", job.Sequence, e);
+            m_workerFailed = true;
 
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
+            // The other workers and the caller wait on this sequence, it must still be released and written, as an empty packet.
+            if (!released)
+                ReleaseInput(job.Sequence);
+
+            if (!written)
+                WriteInOrder(job.Sequence, 0, nullptr);
         }
+    }
+}
 
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
-        
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0)
+void MJPEGWriter::ReleaseInput(Int64 _sequence)
+{
+    // Conversions complete out of order, only the contiguous run of released frames is counted.
+    lock l(m_releaseLocker);
+    int slots = m_released->Length;
+    m_released[(int)(_sequence % slots)] = true;
+    while (m_released[(int)(m_framesReleased % slots)])
+    {
+        m_released[(int)(m_framesReleased % slots)] = false;
+        m_framesReleased++;
+    }
+}
+
+///<summary>
+/// Reorder stage of the parallel mode. Packets are muxed in capture order.
+/// The packet stays in the worker output buffer while waiting for its turn, so the worker only picks up 
+/// a new frame once its packet has been written.
+///</summary>
+void MJPEGWriter::WriteInOrder(Int64 _sequence, int _iEncodedSize, uint8_t* _pOutputVideoBuffer)
+{
+    Monitor::Enter(m_writeLocker);
+    try
+    {
+        while (m_nextToWrite != _sequence)
+            Monitor::Wait(m_writeLocker);
+
+        if (_iEncodedSize > 0)
         {
-            log->Error("Color conversion failed");
-            break;
+            WriteBuffer(_iEncodedSize, m_SavingContext, _pOutputVideoBuffer, true);
         }
-        
-        int encodedSize = yuvBufferSize;
-        // Allocated JPEG frame buffer. 
-        // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-        int jpegBufferSize = yuvBufferSize;
-        pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-        if (pJpegBuffer == nullptr) 
+        else
         {
-            log->Error("output video buffer not allocated");
-            break;
+            log->Error("error while encoding output frame");
+            m_workerFailed = true;
         }
 
-        // Actual encoding step.
-        encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
-        
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
-
-        if (encodedSize <= 0)
-            break;
-
-        WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
-        written = true;
+        m_nextToWrite++;
+        Monitor::PulseAll(m_writeLocker);
+    }
+    finally
+    {
+        Monitor::Exit(m_writeLocker);
     }
-    while(false);
-
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
-
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
-
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
-    
-    return written;
 }
 
-
 bool MJPEGWriter::EncodeAndWriteVideoFrameJPEG(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length)
 {
     // As the buffer is already a JPEG sample, we bypass the encoding step entirely.
@@ -895,6 +1152,7 @@ bool MJPEGWriter::WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext,
 
     // Commit the packet to the file.
     av_write_frame(_SavingContext->pOutputFormatContext, &OutputPacket);
+    m_framesWritten++;
 
     // Test save to individual file for debugging purposes.
     /*array<System::Byte>^ managedBuffer = gcnew array<System::Byte>(_iEncodedSize);
@@ -921,11 +1179,12 @@ void MJPEGWriter::LogError(String^ context, int error)
 
 void MJPEGWriter::LogStats()
 {
-    if (m_frame % 100 != 0)
+    if (m_framesWritten % 100 != 0)
         return;
     
-    log->DebugFormat("Frame #{0}. Conversion/Encoding: ~{1:0.000} ms. Write: ~{2:0.000} ms.",
-        m_frame, (float)m_encodingDurationAccumulator / 100, (float)m_writeDurationAccumulator / 100);
+    log->DebugFormat("Frame #{0}. Conversion/Encoding: ~{1:0.000} ms. Write: ~{2:0.000} ms. Disk queue: {3}/{4}, {5:0.0} MB/s.",
+        m_framesWritten, (float)m_encodingDurationAccumulator / 100, (float)m_writeDurationAccumulator / 100,
+        WriteQueueDepth, m_output == nullptr ? 0 : m_output->QueueCapacity, WriteThroughput);
 
     m_encodingDurationAccumulator = 0;
     m_writeDurationAccumulator = 0;
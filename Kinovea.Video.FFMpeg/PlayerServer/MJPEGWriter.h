@@ -37,9 +37,12 @@ extern "C"
 }
 
 #include "SavingContext.h"
+#include "WriteBehindStream.h"
+#include "EncoderProfiles.h"
 
 using namespace System;
 using namespace System::Collections::Generic;				
+using namespace System::Collections::Concurrent;
 using namespace System::ComponentModel;
 using namespace System::Diagnostics;
 using namespace System::Drawing;
@@ -62,6 +65,54 @@ namespace Kinovea { namespace Video { namespace FFMpeg
     protected:
         !MJPEGWriter();
 
+    // Public Properties
+    public:
+        /// <summary>
+        /// Number of threads encoding frames concurrently. 
+        /// 0 or 1 encodes on the thread calling SaveFrame. Must be set before opening the saving context.
+        /// </summary>
+        property int EncoderThreads
+        {
+            int get() { return m_encoderThreads; }
+            void set(int value) { m_encoderThreads = value; }
+        }
+
+        /// <summary>
+        /// Encoder profile used for compressed recording. null records MJPEG.
+        /// Ignored for uncompressed recording and when the camera already provides JPEG samples.
+        /// Must be set before opening the saving context.
+        /// </summary>
+        property Kinovea::Services::EncoderSettings^ Encoder
+        {
+            Kinovea::Services::EncoderSettings^ get() { return m_encoderSettings; }
+            void set(Kinovea::Services::EncoderSettings^ value) { m_encoderSettings = value; }
+        }
+
+        /// <summary>
+        /// Number of frames passed to SaveFrame whose input buffer is no longer referenced by the writer.
+        /// In parallel mode SaveFrame returns before the input buffer has been converted.
+        /// </summary>
+        property Int64 FramesReleased
+        {
+            Int64 get();
+        }
+
+        /// <summary>
+        /// Number of chunks of the output file waiting to be written to disk.
+        /// </summary>
+        property int WriteQueueDepth
+        {
+            int get() { return m_output == nullptr ? 0 : m_output->QueueDepth; }
+        }
+
+        /// <summary>
+        /// Disk write throughput of the output file in MB/s.
+        /// </summary>
+        property double WriteThroughput
+        {
+            double get() { return m_output == nullptr ? 0 : m_output->Throughput; }
+        }
+
     // Public Methods
     public:
         SaveResult OpenSavingContext(String^ _FilePath, VideoInfo _info, String^ _formatString, Kinovea::Services::ImageFormat _imageFormat, bool _uncompressed, double _fFramesInterval, double _fFileFramesInterval, ImageRotation rotation);
@@ -71,13 +122,26 @@ namespace Kinovea { namespace Video { namespace FFMpeg
     // Private Methods
     private:
         double ComputeBitrate(Size outputSize, double frameInterval);
+        int ComputeWriteBehindCapacity(bool uncompressed, double frameInterval);
         bool SetupMuxer(SavingContext^ _SavingContext);
         bool SetupEncoder(SavingContext^ _SavingContext, Kinovea::Services::ImageFormat _imageFormat);
+        bool AllocateFrameBuffers(SavingContext^ _SavingContext);
+        void FreeFrameBuffers(SavingContext^ _SavingContext);
+        static AVPixelFormat GetEncoderPixelFormat(SavingContext^ _SavingContext);
         
         bool EncodeAndWriteVideoFrameRGB32(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown);
         bool EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown);
         bool EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown);
         bool EncodeAndWriteVideoFrameJPEG(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length);
+        bool ConvertEncodeAndWrite(SavingContext^ _SavingContext, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool topDown);
+
+        bool StartEncoderWorkers(AVPixelFormat _inputFormat);
+        void StopEncoderWorkers();
+        bool OpenWorkerContext(EncoderWorkerContext^ _worker, AVPixelFormat _inputFormat);
+        void CloseWorkerContext(EncoderWorkerContext^ _worker);
+        void EncoderWorker(Object^ _worker);
+        void ReleaseInput(Int64 _sequence);
+        void WriteInOrder(Int64 _sequence, int _iEncodedSize, uint8_t* _pOutputVideoBuffer);
 
         bool WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool _bForceKeyframe);
         void SanityCheck(AVFormatContext* s);
@@ -91,8 +155,35 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         Stopwatch^ m_swEncoding;
         Stopwatch^ m_swWrite;
         int m_frame;
+        int m_framesWritten;
         Int64 m_encodingDurationAccumulator;
         Int64 m_writeDurationAccumulator;
+
+        // Parallel encoding.
+        value struct EncodingJob
+        {
+            Int64 Sequence;
+            array<System::Byte>^ Buffer;
+            bool TopDown;
+        };
+
+        // Asynchronous output.
+        WriteBehindStream^ m_output;
+        static const int WriteBehindChunkSize = 4 * 1024 * 1024;
+
+        Kinovea::Services::EncoderSettings^ m_encoderSettings;
+        int m_encoderThreads;
+        AVPixelFormat m_inputFormat;
+        BlockingCollection<EncodingJob>^ m_encodingQueue;
+        List<EncoderWorkerContext^>^ m_workerContexts;
+        List<Thread^>^ m_workerThreads;
+        Object^ m_writeLocker;
+        Int64 m_nextToWrite;
+        Object^ m_releaseLocker;
+        array<bool>^ m_released;
+        Int64 m_framesReleased;
+        volatile bool m_workerFailed;
+
         static const double megabyte = 1024 * 1024;
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
     };
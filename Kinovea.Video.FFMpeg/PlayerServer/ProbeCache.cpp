@@ -0,0 +1,249 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "ProbeCache.h"
+
+using namespace System::IO;
+using namespace System::Security::Cryptography;
+using namespace Kinovea::Services;
+using namespace Kinovea::Video::FFMpeg;
+
+ProbeResult^ ProbeCache::Lookup(String^ _filePath)
+{
+    ProbeResult^ result = gcnew ProbeResult();
+    result->FilePath = _filePath;
+    result->FileSize = -1;
+
+    String^ entryPath = GetEntryPath(_filePath);
+    if (entryPath == nullptr)
+        return result;
+
+    try
+    {
+        FileInfo^ info = gcnew FileInfo(_filePath);
+        if (!info->Exists)
+            return result;
+
+        result->FileSize = info->Length;
+        result->LastWriteTicks = info->LastWriteTimeUtc.Ticks;
+
+        if (!File::Exists(entryPath))
+            return result;
+
+        ProbeResult^ cached = Read(entryPath);
+        if (cached == nullptr ||
+            cached->FileSize != result->FileSize ||
+            cached->LastWriteTicks != result->LastWriteTicks ||
+            !String::Equals(cached->FilePath, _filePath, StringComparison::OrdinalIgnoreCase))
+            return result;
+
+        // Size and date match, also check the content in case the file was replaced by another one with the same size and date.
+        result->HeaderHash = HashHeader(_filePath);
+        if (!SameHash(cached->HeaderHash, result->HeaderHash))
+            return result;
+
+        return cached;
+    }
+    catch (Exception^ e)
+    {
+        log->DebugFormat("Probe cache: the entry for {0} could not be read. {1}", Path::GetFileName(_filePath), e->Message);
+        return result;
+    }
+}
+
+void ProbeCache::Save(ProbeResult^ _result)
+{
+    if (_result == nullptr || !_result->HasStreamInfo || _result->FileSize < 0)
+        return;
+
+    String^ entryPath = GetEntryPath(_result->FilePath);
+    if (entryPath == nullptr)
+        return;
+
+    // Write to a temporary file first, so a reader in another screen or instance never sees a partial entry.
+    String^ tempPath = entryPath + "." + Guid::NewGuid().ToString("N") + ".tmp";
+    try
+    {
+        // The stamp was taken when the file was opened. If the file changed since then, 
+        // the hash doesn't match the size and date and the entry will be ignored.
+        if (_result->HeaderHash == nullptr)
+            _result->HeaderHash = HashHeader(_result->FilePath);
+
+        Directory::CreateDirectory(Path::GetDirectoryName(entryPath));
+        Write(tempPath, _result);
+
+        if (File::Exists(entryPath))
+            File::Replace(tempPath, entryPath, nullptr);
+        else
+            File::Move(tempPath, entryPath);
+    }
+    catch (Exception^ e)
+    {
+        log->DebugFormat("Probe cache: the entry for {0} could not be written. {1}", Path::GetFileName(_result->FilePath), e->Message);
+
+        try
+        {
+            if (File::Exists(tempPath))
+                File::Delete(tempPath);
+        }
+        catch (IOException^)
+        {
+        }
+    }
+}
+
+String^ ProbeCache::GetEntryPath(String^ _filePath)
+{
+    if (String::IsNullOrEmpty(Software::CacheDirectory) || String::IsNullOrEmpty(_filePath))
+        return nullptr;
+
+    // Entries are named after a hash of the full path. Paths are case insensitive on Windows.
+    String^ key = Path::GetFullPath(_filePath)->ToUpperInvariant();
+    MD5^ md5 = MD5::Create();
+    try
+    {
+        array<Byte>^ hash = md5->ComputeHash(System::Text::Encoding::UTF8->GetBytes(key));
+        String^ name = BitConverter::ToString(hash)->Replace("-", "")->ToLowerInvariant();
+        return Path::Combine(Software::CacheDirectory, "Probe", name + ".kpr");
+    }
+    finally
+    {
+        delete md5;
+    }
+}
+
+array<Byte>^ ProbeCache::HashHeader(String^ _filePath)
+{
+    // The file may still be written to by a recording, don't lock it.
+    FileStream^ stream = gcnew FileStream(_filePath, FileMode::Open, FileAccess::Read, FileShare::ReadWrite | FileShare::Delete);
+    MD5^ md5 = MD5::Create();
+    try
+    {
+        array<Byte>^ buffer = gcnew array<Byte>(HeaderBytes);
+        int length = 0;
+        int read = 0;
+        while (length < HeaderBytes && (read = stream->Read(buffer, length, HeaderBytes - length)) > 0)
+            length += read;
+
+        return md5->ComputeHash(buffer, 0, length);
+    }
+    finally
+    {
+        delete md5;
+        delete stream;
+    }
+}
+
+bool ProbeCache::SameHash(array<Byte>^ _a, array<Byte>^ _b)
+{
+    if (_a == nullptr || _b == nullptr || _a->Length != _b->Length)
+        return false;
+
+    for (int i = 0; i < _a->Length; i++)
+    {
+        if (_a[i] != _b[i])
+            return false;
+    }
+
+    return true;
+}
+
+ProbeResult^ ProbeCache::Read(String^ _entryPath)
+{
+    BinaryReader^ reader = gcnew BinaryReader(gcnew FileStream(_entryPath, FileMode::Open, FileAccess::Read, FileShare::Read));
+    try
+    {
+        if (reader->ReadInt32() != Magic || reader->ReadInt32() != Version)
+            return nullptr;
+
+        ProbeResult^ result = gcnew ProbeResult();
+        result->FilePath = reader->ReadString();
+        result->FileSize = reader->ReadInt64();
+        result->LastWriteTicks = reader->ReadInt64();
+        result->HeaderHash = reader->ReadBytes(reader->ReadInt32());
+
+        result->VideoStream = reader->ReadInt32();
+        result->CodecId = reader->ReadInt32();
+        result->Width = reader->ReadInt32();
+        result->Height = reader->ReadInt32();
+        result->TimeBaseNum = reader->ReadInt32();
+        result->TimeBaseDen = reader->ReadInt32();
+        result->AverageTimeStampsPerSeconds = reader->ReadDouble();
+        result->FramesPerSeconds = reader->ReadDouble();
+        result->FirstTimeStamp = reader->ReadInt64();
+        result->TimestampOffset = reader->ReadInt64();
+        result->DurationTimeStamps = reader->ReadInt64();
+        result->PixelAspectRatio = reader->ReadDouble();
+        int64_t sarNum = reader->ReadInt64();
+        int64_t sarDen = reader->ReadInt64();
+        result->SampleAspectRatio = Fraction(sarNum, sarDen);
+
+        if (reader->ReadBoolean())
+            result->Keyframes = KeyframeIndex::Read(reader);
+
+        result->HasStreamInfo = true;
+        return result;
+    }
+    finally
+    {
+        delete reader;
+    }
+}
+
+void ProbeCache::Write(String^ _entryPath, ProbeResult^ _result)
+{
+    BinaryWriter^ writer = gcnew BinaryWriter(gcnew FileStream(_entryPath, FileMode::Create, FileAccess::Write, FileShare::None));
+    try
+    {
+        writer->Write(Magic);
+        writer->Write(Version);
+        writer->Write(_result->FilePath);
+        writer->Write(_result->FileSize);
+        writer->Write(_result->LastWriteTicks);
+        writer->Write(_result->HeaderHash->Length);
+        writer->Write(_result->HeaderHash);
+
+        writer->Write(_result->VideoStream);
+        writer->Write(_result->CodecId);
+        writer->Write(_result->Width);
+        writer->Write(_result->Height);
+        writer->Write(_result->TimeBaseNum);
+        writer->Write(_result->TimeBaseDen);
+        writer->Write(_result->AverageTimeStampsPerSeconds);
+        writer->Write(_result->FramesPerSeconds);
+        writer->Write(_result->FirstTimeStamp);
+        writer->Write(_result->TimestampOffset);
+        writer->Write(_result->DurationTimeStamps);
+        writer->Write(_result->PixelAspectRatio);
+        writer->Write(_result->SampleAspectRatio.Numerator);
+        writer->Write(_result->SampleAspectRatio.Denominator);
+
+        KeyframeIndex^ keyframes = _result->Keyframes;
+        writer->Write(keyframes != nullptr);
+        if (keyframes != nullptr)
+            keyframes->Write(writer);
+    }
+    finally
+    {
+        delete writer;
+    }
+}
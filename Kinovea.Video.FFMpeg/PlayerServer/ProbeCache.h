@@ -0,0 +1,106 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+#include "KeyframeIndex.h"
+
+using namespace System;
+using namespace Kinovea::Video;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Results of probing a video file: what avformat_find_stream_info and the frame rate heuristics 
+    /// found about the video stream, and optionally the keyframe index.
+    /// Stamped with the size, last write time and a hash of the header of the file it describes.
+    /// </summary>
+    public ref class ProbeResult
+    {
+    public:
+        /// <summary>
+        /// Whether the stream fields are filled, either from the cache or after a full probe.
+        /// </summary>
+        property bool HasStreamInfo;
+
+        property int VideoStream;
+        property int CodecId;
+        property int Width;
+        property int Height;
+        property int TimeBaseNum;
+        property int TimeBaseDen;
+        property double AverageTimeStampsPerSeconds;
+        property double FramesPerSeconds;
+        property int64_t FirstTimeStamp;
+        property int64_t TimestampOffset;
+        property int64_t DurationTimeStamps;
+        property double PixelAspectRatio;
+        property Fraction SampleAspectRatio;
+
+        /// <summary>
+        /// Keyframe index of the video stream, or null if it wasn't built yet.
+        /// </summary>
+        property KeyframeIndex^ Keyframes;
+
+    internal:
+        String^ FilePath;
+        int64_t FileSize;
+        int64_t LastWriteTicks;
+        array<Byte>^ HeaderHash;
+    };
+
+    /// <summary>
+    /// On-disk cache of probe results, one small binary file per video under the cache directory.
+    /// Re-opening a known file skips the stream probing and the keyframe index scan.
+    /// An entry is only used if the size, last write time and header hash of the file still match, 
+    /// any failure to read or write the cache is logged and otherwise ignored.
+    /// </summary>
+    public ref class ProbeCache abstract sealed
+    {
+    public:
+        /// <summary>
+        /// Returns the cached probe results for the file. 
+        /// If there is no valid entry, returns an empty result stamped with the current state of the file, 
+        /// to be filled by the caller and passed to Save.
+        /// </summary>
+        static ProbeResult^ Lookup(String^ _filePath);
+
+        /// <summary>
+        /// Writes the probe results. Does nothing if the stream fields are not filled.
+        /// </summary>
+        static void Save(ProbeResult^ _result);
+
+    private:
+        static String^ GetEntryPath(String^ _filePath);
+        static array<Byte>^ HashHeader(String^ _filePath);
+        static bool SameHash(array<Byte>^ _a, array<Byte>^ _b);
+        static ProbeResult^ Read(String^ _entryPath);
+        static void Write(String^ _entryPath, ProbeResult^ _result);
+
+    private:
+        static const int Magic = 0x4250564B; // "KVPB"
+        static const int Version = 1;
+        static const int HeaderBytes = 64 * 1024;
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(Reflection::MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
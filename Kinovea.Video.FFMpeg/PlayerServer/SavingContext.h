@@ -41,6 +41,13 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 		AVStream* pOutputDataStream;			// Output stream for meta data.
 		AVFrame* pInputFrame;					// The current incoming frame.
         SwsContext* pScalingContext;            // The scaling context for the RGB -> YUV color conversion.
+
+		// Per-frame buffers, allocated once when opening the context and reused for every frame.
+		AVFrame* pYUV420Frame;					// Color converted frame, points into pYUV420Buffer.
+		uint8_t* pYUV420Buffer;					// Planes of the color converted frame, or raw Y800 samples.
+		int iYUV420BufferSize;
+		uint8_t* pOutputBuffer;					// Encoded JPEG sample.
+		int iOutputBufferSize;
 		
 		double fPixelAspectRatio;				// Used to adapt pixel aspect ratio.
 		bool bInputWasMpeg2;					
@@ -53,6 +60,8 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 		int iBitrate;				
 		Size outputSize;
         bool uncompressed;
+		Kinovea::Services::EncoderProfile encoderProfile;
+		int64_t iFramesEncoded;				// Presentation timestamp of the next frame for the packet API, in codec time base.
 
 		// Control
 		bool bEncoderOpened;
@@ -65,6 +74,24 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 			fPixelAspectRatio = 1.0;		// Default aspect : square pixels.
 			outputSize = Size(720, 576);
             uncompressed = false;
+			encoderProfile = Kinovea::Services::EncoderProfile::MPEG4;
+			iFramesEncoded = 0;
 		}
 	};
+
+	/// <summary>
+	/// Private encoder state of one worker of the parallel encoding mode.
+	/// Each worker has its own codec context, scaler and buffers so frames can be encoded concurrently.
+	/// </summary>
+	ref class EncoderWorkerContext
+	{
+	public:
+		AVCodecContext* pCodecContext;			// Opened copy of the main encoder parameters.
+		SwsContext* pScalingContext;
+		AVFrame* pInputFrame;
+		AVFrame* pYUV420Frame;
+		uint8_t* pYUV420Buffer;
+		uint8_t* pOutputBuffer;
+		int iOutputBufferSize;
+	};
 }}}
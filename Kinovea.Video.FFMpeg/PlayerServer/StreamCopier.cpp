@@ -0,0 +1,322 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "StreamCopier.h"
+
+using namespace System::Diagnostics;
+using namespace System::IO;
+using namespace System::Runtime::InteropServices;
+using namespace Kinovea::Video::FFMpeg;
+
+bool StreamCopier::CanCopy(String^ _sourcePath, int _videoStream, String^ _formatString)
+{
+    av_register_all();
+
+    char* pFormatString = static_cast<char*>(Marshal::StringToHGlobalAnsi(_formatString).ToPointer());
+    AVOutputFormat* format = av_guess_format(pFormatString, nullptr, nullptr);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pFormatString));
+    if (format == nullptr)
+        return false;
+
+    AVFormatContext* pInputCtx = OpenInput(_sourcePath);
+    if (pInputCtx == nullptr)
+        return false;
+
+    bool result = false;
+    if (_videoStream >= 0 && _videoStream < (int)pInputCtx->nb_streams)
+    {
+        // 1: the muxer knows how to store this codec. Negative values (unknown) are treated as a no.
+        AVCodecID codecId = pInputCtx->streams[_videoStream]->codec->codec_id;
+        result = avformat_query_codec(format, codecId, FF_COMPLIANCE_NORMAL) == 1;
+    }
+
+    avformat_close_input(&pInputCtx);
+    return result;
+}
+
+SaveResult StreamCopier::Copy(String^ _sourcePath, int _videoStream, int64_t _start, int64_t _end, KeyframeIndex^ _keyframes,
+    String^ _outputPath, String^ _formatString, int _totalFrames, BackgroundWorker^ _worker)
+{
+    //------------------------------------------------------------------------------------
+    // Seek on the keyframe at the start and copy the packets until the next keyframe after the end.
+    // With frame reordering, packets come in decoding order and presentation timestamps are not monotonic.
+    // The caller makes the section end just before a keyframe in this case, so the packets presented in it
+    // are the ones decoded between the two keyframes. Packets presented outside the section are dropped:
+    // leading frames of an open GOP before the start, frames after the end when there is no reordering.
+    // Uses its own demuxer so the decoding position of the reader is not disturbed.
+    //------------------------------------------------------------------------------------
+    log->DebugFormat("Copying the video stream from {0} to {1}.", _start, _end);
+    Stopwatch^ stopwatch = Stopwatch::StartNew();
+
+    AVFormatContext* pInputCtx = OpenInput(_sourcePath);
+    if (pInputCtx == nullptr)
+        return SaveResult::MovieNotLoaded;
+
+    if (_videoStream < 0 || _videoStream >= (int)pInputCtx->nb_streams)
+    {
+        log->Error("Stream copy: video stream not found.");
+        avformat_close_input(&pInputCtx);
+        return SaveResult::ReadingError;
+    }
+
+    AVFormatContext* pOutputCtx = nullptr;
+    SaveResult result = OpenOutput(pInputCtx, _videoStream, _outputPath, _formatString, &pOutputCtx);
+    if (result != SaveResult::Success)
+    {
+        CloseOutput(pOutputCtx);
+        avformat_close_input(&pInputCtx);
+        return result;
+    }
+
+    AVStream* pInputStream = pInputCtx->streams[_videoStream];
+    AVStream* pOutputStream = pOutputCtx->streams[0];
+
+    // Seek. Without the index we rely on the demuxer landing on a keyframe before the start.
+    int64_t seekTarget = _start;
+    if (_keyframes != nullptr)
+    {
+        int64_t keyframePts;
+        int64_t indexTarget = _keyframes->FindSeekTarget(_start, keyframePts);
+        if (indexTarget != AV_NOPTS_VALUE)
+            seekTarget = indexTarget;
+    }
+
+    int averror = avformat_seek_file(pInputCtx, _videoStream, INT64_MIN, seekTarget, seekTarget, AVSEEK_FLAG_BACKWARD);
+    if (averror < 0)
+        LogError("Stream copy: seek failed, copying from the beginning", averror);
+
+    bool started = false;
+    int64_t origin = 0;
+    int frames = 0;
+    AVPacket packet;
+    while (av_read_frame(pInputCtx, &packet) >= 0)
+    {
+        if (_worker != nullptr && _worker->CancellationPending)
+        {
+            av_free_packet(&packet);
+            result = SaveResult::Cancelled;
+            break;
+        }
+
+        if (packet.stream_index != _videoStream)
+        {
+            av_free_packet(&packet);
+            continue;
+        }
+
+        int64_t dts = packet.dts != AV_NOPTS_VALUE ? packet.dts : packet.pts;
+        int64_t pts = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+
+        // The demuxer may land before the keyframe, nothing presented before the start is copied.
+        bool keyframe = (packet.flags & AV_PKT_FLAG_KEY) != 0;
+        if (!started && (!keyframe || (pts != AV_NOPTS_VALUE && pts < _start)))
+        {
+            av_free_packet(&packet);
+            continue;
+        }
+
+        if (started && keyframe && pts != AV_NOPTS_VALUE && pts > _end)
+        {
+            av_free_packet(&packet);
+            break;
+        }
+
+        if (started && pts != AV_NOPTS_VALUE && (pts < _start || pts > _end))
+        {
+            av_free_packet(&packet);
+            continue;
+        }
+
+        if (!started)
+        {
+            // Shift the timestamps so the output starts at zero.
+            origin = dts != AV_NOPTS_VALUE ? dts : 0;
+            started = true;
+        }
+
+        if (packet.pts != AV_NOPTS_VALUE)
+            packet.pts = av_rescale_q(packet.pts - origin, pInputStream->time_base, pOutputStream->time_base);
+        if (packet.dts != AV_NOPTS_VALUE)
+            packet.dts = av_rescale_q(packet.dts - origin, pInputStream->time_base, pOutputStream->time_base);
+        packet.duration = (int)av_rescale_q(packet.duration, pInputStream->time_base, pOutputStream->time_base);
+        packet.stream_index = 0;
+        packet.pos = -1;
+
+        averror = av_interleaved_write_frame(pOutputCtx, &packet);
+        av_free_packet(&packet);
+        if (averror < 0)
+        {
+            LogError("Stream copy: packet not written", averror);
+            result = SaveResult::UnknownError;
+            break;
+        }
+
+        if (pts != AV_NOPTS_VALUE && pts >= _start)
+            frames++;
+
+        if (_worker != nullptr)
+            _worker->ReportProgress(Math::Min(frames, _totalFrames), _totalFrames);
+    }
+
+    if (!started && result == SaveResult::Success)
+    {
+        log->Error("Stream copy: no keyframe found at the start of the section.");
+        result = SaveResult::ReadingError;
+    }
+
+    if (result == SaveResult::Success)
+        av_write_trailer(pOutputCtx);
+
+    CloseOutput(pOutputCtx);
+    avformat_close_input(&pInputCtx);
+
+    if (result != SaveResult::Success)
+    {
+        log->Debug("Stream copy not completed, deleting the output file.");
+        if (File::Exists(_outputPath))
+            File::Delete(_outputPath);
+    }
+    else
+    {
+        log->DebugFormat("Stream copy: {0} frames copied in {1} ms.", frames, stopwatch->ElapsedMilliseconds);
+    }
+
+    return result;
+}
+
+AVFormatContext* StreamCopier::OpenInput(String^ _sourcePath)
+{
+    AVFormatContext* pInputCtx = nullptr;
+    String^ encFilePath = System::Text::Encoding::Default->GetString(System::Text::Encoding::UTF8->GetBytes(_sourcePath));
+    char* pszFilePath = static_cast<char*>(Marshal::StringToHGlobalAnsi(encFilePath).ToPointer());
+    int averror = avformat_open_input(&pInputCtx, pszFilePath, NULL, NULL);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pszFilePath));
+
+    if (averror != 0)
+    {
+        LogError("Stream copy: the file could not be opened", averror);
+        return nullptr;
+    }
+
+    // Stream indices and codec parameters of some containers are only known after probing.
+    averror = avformat_find_stream_info(pInputCtx, nullptr);
+    if (averror < 0)
+    {
+        LogError("Stream copy: stream info not found", averror);
+        avformat_close_input(&pInputCtx);
+        return nullptr;
+    }
+
+    return pInputCtx;
+}
+
+SaveResult StreamCopier::OpenOutput(AVFormatContext* _pInputCtx, int _videoStream, String^ _outputPath, String^ _formatString, AVFormatContext** _ppOutputCtx)
+{
+    // 1. Muxer selection.
+    char* pFormatString = static_cast<char*>(Marshal::StringToHGlobalAnsi(_formatString).ToPointer());
+    AVOutputFormat* format = av_guess_format(pFormatString, nullptr, nullptr);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pFormatString));
+    if (format == nullptr)
+    {
+        log->Error("Stream copy: muxer not found");
+        return SaveResult::MuxerNotFound;
+    }
+
+    // 2. Allocate muxer context.
+    int averror = avformat_alloc_output_context2(_ppOutputCtx, format, nullptr, nullptr);
+    if (averror < 0)
+    {
+        LogError("Stream copy: muxer parameters object not allocated", averror);
+        return SaveResult::MuxerParametersNotAllocated;
+    }
+
+    AVFormatContext* pOutputCtx = *_ppOutputCtx;
+    AVStream* pInputStream = _pInputCtx->streams[_videoStream];
+
+    // 3. Create the video stream with the parameters of the source stream.
+    AVStream* pOutputStream = avformat_new_stream(pOutputCtx, pInputStream->codec->codec);
+    if (pOutputStream == nullptr)
+    {
+        log->Error("Stream copy: video stream not created");
+        return SaveResult::VideoStreamNotCreated;
+    }
+
+    averror = avcodec_copy_context(pOutputStream->codec, pInputStream->codec);
+    if (averror < 0)
+    {
+        LogError("Stream copy: codec parameters not copied", averror);
+        return SaveResult::EncoderParametersNotSet;
+    }
+
+    // The fourcc of the source container may not be valid in the output one, let the muxer pick.
+    pOutputStream->codec->codec_tag = 0;
+    if (pOutputCtx->oformat->flags & AVFMT_GLOBALHEADER)
+        pOutputStream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    pOutputStream->time_base = pInputStream->time_base;
+    pOutputStream->avg_frame_rate = pInputStream->avg_frame_rate;
+    pOutputStream->r_frame_rate = pInputStream->r_frame_rate;
+    pOutputStream->sample_aspect_ratio = pInputStream->codec->sample_aspect_ratio;
+
+    // Keeps the rotation tag.
+    av_dict_copy(&pOutputStream->metadata, pInputStream->metadata, 0);
+
+    // 4. Open the file.
+    char* pFilePath = static_cast<char*>(Marshal::StringToHGlobalAnsi(_outputPath).ToPointer());
+    averror = avio_open(&pOutputCtx->pb, pFilePath, AVIO_FLAG_WRITE);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pFilePath));
+    if (averror < 0)
+    {
+        LogError("Stream copy: file not opened", averror);
+        return SaveResult::FileNotOpened;
+    }
+
+    // 5. Write file header.
+    averror = avformat_write_header(pOutputCtx, nullptr);
+    if (averror < 0)
+    {
+        LogError("Stream copy: file header not written", averror);
+        return SaveResult::FileHeaderNotWritten;
+    }
+
+    return SaveResult::Success;
+}
+
+void StreamCopier::CloseOutput(AVFormatContext* _pOutputCtx)
+{
+    if (_pOutputCtx == nullptr)
+        return;
+
+    if (_pOutputCtx->pb != nullptr)
+        avio_close(_pOutputCtx->pb);
+
+    // Also releases the stream and its codec parameters.
+    avformat_free_context(_pOutputCtx);
+}
+
+void StreamCopier::LogError(String^ context, int error)
+{
+    char errbuf[256];
+    av_strerror(error, errbuf, sizeof(errbuf));
+    String^ message = Marshal::PtrToStringAnsi((IntPtr)errbuf);
+    log->Error(String::Format("{0}, Error:{1}", context, message));
+}
@@ -0,0 +1,76 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C"
+{
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+#include <avformat.h>
+#include <avcodec.h>
+}
+
+#include "KeyframeIndex.h"
+
+using namespace System;
+using namespace System::ComponentModel;
+using namespace System::Reflection;
+using namespace Kinovea::Video;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Copies the packets of a section of the video stream to a new file, without decoding nor encoding them.
+    /// The section must start on a keyframe. With frame reordering it must also end just before a keyframe or at the end of the stream,
+    /// so every frame it presents can be decoded from the packets copied. The reader computes such a section.
+    /// Other streams are not copied, like in the regular export.
+    /// </summary>
+    public ref class StreamCopier
+    {
+    public:
+        /// <summary>
+        /// Whether the packets of the video stream of this file can be stored in the output format.
+        /// </summary>
+        static bool CanCopy(String^ _sourcePath, int _videoStream, String^ _formatString);
+
+        /// <summary>
+        /// Copies the packets presented in the range [start, end] of the video stream.
+        /// Timestamps are raw stream timestamps. The keyframe index is optional and used to seek exactly on the start.
+        /// </summary>
+        static SaveResult Copy(String^ _sourcePath, int _videoStream, int64_t _start, int64_t _end, KeyframeIndex^ _keyframes,
+            String^ _outputPath, String^ _formatString, int _totalFrames, BackgroundWorker^ _worker);
+
+    private:
+        static AVFormatContext* OpenInput(String^ _sourcePath);
+        static SaveResult OpenOutput(AVFormatContext* _pInputCtx, int _videoStream, String^ _outputPath, String^ _formatString, AVFormatContext** _ppOutputCtx);
+        static void CloseOutput(AVFormatContext* _pOutputCtx);
+        static void LogError(String^ context, int ffmpegError);
+
+    private:
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
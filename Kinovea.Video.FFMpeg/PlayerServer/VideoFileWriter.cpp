@@ -58,28 +58,37 @@ SaveResult VideoFileWriter::Save(SavingSettings^ s, VideoInfo videoInfo, String^
     }
 
     int64_t i = 0;
-    for each (Bitmap^ image in images)
+    try
     {
-        if(worker->CancellationPending)
+        for each (Bitmap^ image in images)
         {
-            delete image;
-            result = SaveResult::Cancelled;
-            break;
-        }
-        
-        result = SaveFrame(image);
-        if(result != SaveResult::Success)
-            log->Error("Frame not saved.");
-        
-        i++;
-        worker->ReportProgress((int)i, s->TotalFrameCount);
+            if(worker->CancellationPending)
+            {
+                delete image;
+                result = SaveResult::Cancelled;
+                break;
+            }
+            
+            result = SaveFrame(image);
+            if(result != SaveResult::Success)
+                log->Error("Frame not saved.");
+            
+            i++;
+            worker->ReportProgress((int)i, s->TotalFrameCount);
 
-        if(result != SaveResult::Success)
-        {
-            delete image;
-            break;
+            if(result != SaveResult::Success)
+            {
+                delete image;
+                break;
+            }
         }
     }
+    catch (Exception^ e)
+    {
+        // The images could not be produced until the end, the file would be cut short.
+        log->ErrorFormat("Error while enumerating the images to save. {0}", e);
+        result = SaveResult::UnknownError;
+    }
 
     CloseSavingContext(true);
 
@@ -186,7 +195,16 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
         }
 
         // 4. Encoder selection
-        if ((m_SavingContext->pOutputCodec = avcodec_find_encoder(CODEC_ID_MPEG4)) == nullptr)
+        // Fall back to MPEG-4 if the encoder is not in the build or can't go in this container (ex: FFV1 in MP4).
+        EncoderSettings^ encoderSettings = m_EncoderSettings != nullptr ? m_EncoderSettings : gcnew EncoderSettings(EncoderProfile::MPEG4);
+        if (!EncoderProfiles::IsSupported(encoderSettings->Profile, format))
+        {
+            log->WarnFormat("Encoder profile {0} not supported in {1}, using MPEG-4.", encoderSettings->Profile, _formatString);
+            encoderSettings = gcnew EncoderSettings(EncoderProfile::MPEG4);
+        }
+
+        m_SavingContext->encoderProfile = encoderSettings->Profile;
+        if ((m_SavingContext->pOutputCodec = EncoderProfiles::FindEncoder(encoderSettings->Profile)) == nullptr)
         {
             result = SaveResult::EncoderNotFound;
             log->Error("Encoder not found");
@@ -212,10 +230,14 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
             break;
         }
 
+        AVDictionary* encoderOptions = nullptr;
+        EncoderProfiles::Configure(m_SavingContext->pOutputCodecContext, encoderSettings, &encoderOptions);
+
         m_SavingContext->pOutputFormatContext->video_codec_id = m_SavingContext->pOutputCodec->id;
 
         // 7. Open the encoder.
-        averror = avcodec_open2(m_SavingContext->pOutputCodecContext, m_SavingContext->pOutputCodec, nullptr);
+        averror = avcodec_open2(m_SavingContext->pOutputCodecContext, m_SavingContext->pOutputCodec, &encoderOptions);
+        av_dict_free(&encoderOptions);
         if (averror < 0)
         {
             result = SaveResult::EncoderNotOpened;
@@ -255,6 +277,15 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
             log->Error("input frame not allocated");
             break;
         }
+
+        // 12. Allocate the conversion and output buffers (will be reused for each frame).
+        // The scaling context depends on the input images and is created with the first frame.
+        if (!AllocateFrameBuffers(m_SavingContext))
+        {
+            result = SaveResult::InputFrameNotAllocated;
+            log->Error("Frame buffers not allocated");
+            break;
+        }
     }
     while(false);
 
@@ -307,6 +338,10 @@ SaveResult VideoFileWriter::CloseSavingContext(bool _bEncodingSuccess)
 
     if(_bEncodingSuccess)
     {
+        // Encoders using frame threading or lookahead still hold the last frames.
+        if (m_SavingContext->bEncoderOpened && !EncoderProfiles::IsLegacy(m_SavingContext->encoderProfile))
+            EncoderProfiles::Flush(m_SavingContext->pOutputFormatContext, m_SavingContext->pOutputVideoStream, m_SavingContext->pOutputCodecContext);
+
         // Write file trailer.		
         av_write_trailer(m_SavingContext->pOutputFormatContext);
     }
@@ -336,6 +371,11 @@ SaveResult VideoFileWriter::CloseSavingContext(bool _bEncodingSuccess)
 
     // release pOutputFormat ?
 
+    // Release scaling context and per-frame buffers.
+    sws_freeContext(m_SavingContext->pScalingContext);
+    m_SavingContext->pScalingContext = nullptr;
+    FreeFrameBuffers(m_SavingContext);
+
     log->Debug("Saving video completed.");
 
     return result;
@@ -580,19 +620,71 @@ bool VideoFileWriter::SetupEncoder(SavingContext^ _SavingContext)
     return true;
 }
 
+///<summary>
+/// Allocate the color conversion and output buffers, they are reused for every frame of the export.
+///</summary>
+bool VideoFileWriter::AllocateFrameBuffers(SavingContext^ _SavingContext)
+{
+    int outWidth = _SavingContext->outputSize.Width;
+    int outHeight = _SavingContext->outputSize.Height;
+
+    // The encoder input format depends on the profile, YUV420P except for ProRes.
+    AVPixelFormat pixelFormat = _SavingContext->pOutputCodecContext->pix_fmt;
+
+    if ((_SavingContext->pYUV420Frame = av_frame_alloc()) == nullptr)
+        return false;
+
+    _SavingContext->iYUV420BufferSize = avpicture_get_size(pixelFormat, outWidth, outHeight);
+    _SavingContext->pYUV420Buffer = (uint8_t*)av_malloc(_SavingContext->iYUV420BufferSize);
+    if (_SavingContext->pYUV420Buffer == nullptr)
+        return false;
+
+    avpicture_fill((AVPicture*)_SavingContext->pYUV420Frame, _SavingContext->pYUV420Buffer, pixelFormat, outWidth, outHeight);
+    _SavingContext->pYUV420Frame->width = outWidth;
+    _SavingContext->pYUV420Frame->height = outHeight;
+    _SavingContext->pYUV420Frame->format = pixelFormat;
+
+    // Assumes compressed size is always smaller than uncompressed. (Not technically true).
+    _SavingContext->iOutputBufferSize = Math::Max(outWidth * outHeight * 4, FF_MIN_BUFFER_SIZE);
+    _SavingContext->pOutputBuffer = (uint8_t*)av_malloc(_SavingContext->iOutputBufferSize);
+
+    return _SavingContext->pOutputBuffer != nullptr;
+}
+
+void VideoFileWriter::FreeFrameBuffers(SavingContext^ _SavingContext)
+{
+    if (_SavingContext->pYUV420Frame != nullptr)
+    {
+        AVFrame* pFrame = _SavingContext->pYUV420Frame;
+        av_frame_free(&pFrame);
+        _SavingContext->pYUV420Frame = nullptr;
+    }
+
+    if (_SavingContext->pYUV420Buffer != nullptr)
+    {
+        av_free(_SavingContext->pYUV420Buffer);
+        _SavingContext->pYUV420Buffer = nullptr;
+    }
+
+    if (_SavingContext->pOutputBuffer != nullptr)
+    {
+        av_free(_SavingContext->pOutputBuffer);
+        _SavingContext->pOutputBuffer = nullptr;
+    }
+}
+
 ///<summary>
 /// VideoFileWriter::EncodeAndWriteVideoFrame
 /// Save a single frame in the video file. Takes a Bitmap as input.
+/// Works in the buffers of the saving context, nothing is allocated.
 ///</summary>
 bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap)
 {
     bool written = false;
     bool isBitmapLocked = false;
     
-    AVFrame* pInputFrame = nullptr;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pOutputBuffer = nullptr;
+    AVFrame* pInputFrame = _SavingContext->pInputFrame;
+    AVFrame* pYUV420Frame = _SavingContext->pYUV420Frame;
     System::Drawing::Imaging::BitmapData^ bitmapData;
 
     AVPixelFormat pixelFormatInput = AV_PIX_FMT_BGRA;
@@ -610,13 +702,6 @@ bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bi
         int outWidth = _SavingContext->outputSize.Width;
         int outHeight = _SavingContext->outputSize.Height;
 
-        // Allocate the input frame that will wrap the bitmap content.
-        if ((pInputFrame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("input frame not allocated");
-            break;
-        }
-        
         // Associate the Bitmap data to the AVFrame
         Rectangle rect = Rectangle(0, 0, inWidth, inHeight);
         bitmapData = _InputBitmap->LockBits(rect, Imaging::ImageLockMode::ReadOnly, _InputBitmap->PixelFormat);
@@ -628,58 +713,48 @@ bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bi
         // -> At that point, pInputFrame holds a non compressed bitmap in the input pixel format (ex: RGB24).
         // This bitmap is still at the decoding size.
 
-        // Prepare the resized / color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("output frame not allocated");
-            break;
-        }
-         
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, outWidth, outHeight);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
+        // Get the scaling context, only recreated if the input size or format changes.
+        _SavingContext->pScalingContext = sws_getCachedContext(_SavingContext->pScalingContext,
+            inWidth, inHeight, pixelFormatInput, 
+            outWidth, outHeight, _SavingContext->pOutputCodecContext->pix_fmt, SWS_BICUBIC,
+            NULL, NULL, NULL);
 
-        if (pYUV420Buffer == nullptr) 
+        if (_SavingContext->pScalingContext == nullptr)
         {
-            log->Error("YUV frame buffer not allocated");
+            log->Error("scaling context not allocated");
             break;
         }
 
-        avpicture_fill((AVPicture *)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, outWidth, outHeight);
-        
         // Perform the color space conversion and resizing.
-        SwsContext* scalingContext = sws_getContext(
-            inWidth, inHeight, pixelFormatInput, 
-            outWidth, outHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC,
-            NULL, NULL, NULL);
-
-        if (sws_scale(scalingContext, pInputFrame->data, pInputFrame->linesize, 0, inHeight, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
+        if (sws_scale(_SavingContext->pScalingContext, pInputFrame->data, pInputFrame->linesize, 0, inHeight, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
         {
             log->Error("scaling failed");
-            sws_freeContext(scalingContext);
             break;
         }
 
-        sws_freeContext(scalingContext);
-
-        // Allocate encoded frame buffer.
-        // Assumes compressed size is always smaller than uncompressed. (Not technically true).
-        int encodedBufferSize = outWidth * outHeight * 4;
-        pOutputBuffer = (uint8_t*)av_malloc(encodedBufferSize);
-        
-        if (pOutputBuffer == nullptr) 
+        if (!EncoderProfiles::IsLegacy(_SavingContext->encoderProfile))
         {
-            log->Error("output video buffer not allocated");
+            // Packet API. The packet may come out several frames later or not at all for this frame.
+            pYUV420Frame->pts = _SavingContext->iFramesEncoded++;
+            int averror = EncoderProfiles::EncodeAndWrite(_SavingContext->pOutputFormatContext, _SavingContext->pOutputVideoStream, _SavingContext->pOutputCodecContext, pYUV420Frame);
+            if (averror < 0)
+            {
+                LogError("Frame not encoded", averror);
+                break;
+            }
+
+            written = true;
             break;
         }
-        
+
         // Actual encoding step.
         // AccessViolationException ? => memalign issue, requires recompiling libavc with the correct gcc.
-        int encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pOutputBuffer, encodedBufferSize, pYUV420Frame);
+        int encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, _SavingContext->pOutputBuffer, _SavingContext->iOutputBufferSize, pYUV420Frame);
         
         // Write the video packet in the output.
         if (encodedSize > 0)
         {   
-            if (!WriteFrame(encodedSize, _SavingContext, pOutputBuffer, true))
+            if (!WriteFrame(encodedSize, _SavingContext, _SavingContext->pOutputBuffer, true))
             {
                 log->Error("problem while writing frame to file");
                 break;
@@ -690,24 +765,9 @@ bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bi
     }
     while(false);
 
-    if (pOutputBuffer)
-        av_free(pOutputBuffer);
-
-    if (pInputFrame != nullptr)
-        av_free(pInputFrame);
-
     if(isBitmapLocked)
         _InputBitmap->UnlockBits(bitmapData);
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
-
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
-
-    // (Temporary) fix to OOM error that sometimes happen with very large image size.
-    GC::Collect();
-
     return written;
 }
 
@@ -45,6 +45,7 @@ extern "C"
 }
 
 #include "SavingContext.h"
+#include "EncoderProfiles.h"
 
 using namespace System;
 using namespace System::Collections::Generic;				
@@ -76,6 +77,15 @@ namespace Kinovea { namespace Video { namespace FFMpeg
             }
         }
 
+        /// <summary>
+        /// Encoder profile and parameters. Must be set before opening the saving context.
+        /// Defaults to MPEG-4 at constant quantizer.
+        /// </summary>
+        property Kinovea::Services::EncoderSettings^ Encoder {
+            Kinovea::Services::EncoderSettings^ get() { return m_EncoderSettings; }
+            void set(Kinovea::Services::EncoderSettings^ value) { m_EncoderSettings = value; }
+        }
+
     // Public Methods
     public:
         SaveResult Save(SavingSettings^ _settings,  VideoInfo _info, String^ _formatString, IEnumerable<Bitmap^>^ _frames, BackgroundWorker^ _worker);
@@ -88,6 +98,8 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         double ComputeBitrate(Size outputSize, double frameInterval);
         bool SetupMuxer(SavingContext^ _SavingContext);
         bool SetupEncoder(SavingContext^ _SavingContext);
+        bool AllocateFrameBuffers(SavingContext^ _SavingContext);
+        void FreeFrameBuffers(SavingContext^ _SavingContext);
         
         bool EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap);
         bool WriteFrame(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool _bForceKeyframe);
@@ -100,5 +112,6 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
         SavingContext^ m_SavingContext;
         String^ m_Filename;
+        Kinovea::Services::EncoderSettings^ m_EncoderSettings;
     };
 }}}
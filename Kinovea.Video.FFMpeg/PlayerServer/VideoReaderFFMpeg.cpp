@@ -22,6 +22,8 @@ along with Kinovea. If not, see http://www.gnu.org/licenses/.
 
 #include <msclr\lock.h>
 #include "VideoReaderFFMpeg.h"
+#include "ImageRotator.h"
+#include "ImageStabilizer.h"
 
 using namespace System::Diagnostics;
 using namespace System::Drawing;
@@ -41,14 +43,19 @@ VideoReaderFFMpeg::VideoReaderFFMpeg()
     av_register_all();
     avfilter_register_all();
     m_Locker = gcnew Object();
+    m_ConversionLocker = gcnew Object();
     m_PreBufferingThreadCanceler = gcnew ThreadCanceler();
 
-    VideoFrameDisposer^ disposer = gcnew VideoFrameDisposer(DisposeFrame);
+    m_BufferPool = gcnew FrameBufferPool();
+    VideoFrameDisposer^ disposer = gcnew VideoFrameDisposer(this, &VideoReaderFFMpeg::DisposeFrame);
     m_SingleFrameContainer = gcnew SingleFrame(disposer);
     m_PreBuffer = gcnew PreBuffer(disposer);
     m_Cache = gcnew Cache(disposer);
     
     m_LoopWatcher = gcnew LoopWatcher();
+    m_pScalingContext = nullptr;
+    m_ScalingContextHits = 0;
+    m_ScalingContextMisses = 0;
     DataInit();
 }
 
@@ -74,6 +81,12 @@ void VideoReaderFFMpeg::DataInit()
     m_TimestampInfo = TimestampInfo::Empty;
     m_WasPrebuffering = false;
     m_CanDrawUnscaled = false;
+    m_KeyframeIndex = nullptr;
+    m_ProbeResult = nullptr;
+    m_SeekExpectedFrames = -1;
+    m_SeekCount = 0;
+    m_SeekFramesDecoded = 0;
+    m_ResyncTimestamp = -1;
 }
 #pragma endregion
 
@@ -82,8 +95,20 @@ OpenVideoResult VideoReaderFFMpeg::Open(String^ filePath)
 {
     OpenVideoResult result = Load(filePath, false);
     if (result == OpenVideoResult::Success)
+    {
         DumpInfo();
 
+        if (m_ProbeResult->Keyframes != nullptr)
+        {
+            m_KeyframeIndex = m_ProbeResult->Keyframes;
+            log->DebugFormat("Keyframe index: {0} frames, {1} keyframes, from the probe cache.", m_KeyframeIndex->FrameCount, m_KeyframeIndex->KeyframeCount);
+        }
+        else
+        {
+            StartKeyframeIndexing();
+        }
+    }
+
     return result;
 }
 
@@ -93,7 +118,10 @@ void VideoReaderFFMpeg::Close()
     if (!m_bIsLoaded)
         return;
 
+    StopKeyframeIndexing();
     DataInit();
+    InvalidateScalingContext();
+    m_BufferPool->Flush();
 
     if (m_pCodecCtx != nullptr)
         avcodec_close(m_pCodecCtx);
@@ -167,6 +195,7 @@ VideoSummary^ VideoReaderFFMpeg::ExtractSummary(String^ _filePath, int _thumbs,
         {
             log->WarnFormat("Thumbnail out of budget after {0} frames in {1} ms. {2}.", 
                 index, m_Stopwatch->ElapsedMilliseconds, Path::GetFileName(_filePath));
+            summary->Truncated = ts + step < m_VideoInfo.DurationTimeStamps;
             break;
         }
     }
@@ -218,8 +247,13 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
         }
         Marshal::FreeHGlobal(safe_cast<IntPtr>(pszFilePath));
 
+        // Results of a previous probing of the same file.
+        // Probing reads and decodes the start of the streams, skip it if the container header still describes the cached stream.
+        ProbeResult^ probe = ProbeCache::Lookup(_filePath);
+        bool fromCache = probe->HasStreamInfo && MatchesProbe(pFormatCtx, probe);
+
         // Info on streams.
-        if (avformat_find_stream_info(pFormatCtx, nullptr) < 0)
+        if (!fromCache && avformat_find_stream_info(pFormatCtx, nullptr) < 0)
         {
             result = OpenVideoResult::StreamInfoNotFound;
             log->Error("The streams Infos were not Found.");
@@ -227,7 +261,7 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
         }
 
         // Video stream.
-        if ((m_iVideoStream = GetStreamIndex(pFormatCtx, AVMEDIA_TYPE_VIDEO)) < 0)
+        if ((m_iVideoStream = fromCache ? probe->VideoStream : GetStreamIndex(pFormatCtx, AVMEDIA_TYPE_VIDEO)) < 0)
         {
             result = OpenVideoResult::VideoStreamNotFound;
             log->Error("No Video stream found in the file. (File is audio only, or video stream is broken.)");
@@ -259,6 +293,14 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
             break;
         }
 
+        // Thumbnails are extracted by several readers in parallel and only decode a handful of frames,
+        // frame threading would only add latency there.
+        SetupDecoderThreading(pCodecCtx, _forSummary ? DecoderThreading::Off : Options->DecoderThreading);
+
+        // Decoded pictures are reference counted so they can outlive the next decoding call.
+        // This lets the prebuffering thread hand them over to the conversion thread without copy.
+        pCodecCtx->refcounted_frames = 1;
+
         if (avcodec_open2(pCodecCtx, pCodec, nullptr) < 0)
         {
             result = OpenVideoResult::CodecNotOpened;
@@ -266,121 +308,46 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
             break;
         }
 
-        // The fundamental unit of time in Kinovea is the timebase of the file.
-        // The timebase unit is the span of time (in seconds) in which the timestamps are expressed.
-        if (m_Verbose)
-            log->DebugFormat("pFormatCtx->streams[m_iVideoStream]->time_base.den: {0}, .num: {1}", pFormatCtx->streams[m_iVideoStream]->time_base.den, pFormatCtx->streams[m_iVideoStream]->time_base.num);
-
-        m_VideoInfo.AverageTimeStampsPerSeconds = (double)pFormatCtx->streams[m_iVideoStream]->time_base.den / (double)pFormatCtx->streams[m_iVideoStream]->time_base.num;
-        double fAvgFrameRate = 0.0;
-        if (pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.den != 0)
-            fAvgFrameRate = (double)pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.num / (double)pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.den;
-
-        // This may be updated after the first actual decoding.
-        long firstTimestamp = (long)((double)((double)pFormatCtx->start_time / (double)AV_TIME_BASE) * m_VideoInfo.AverageTimeStampsPerSeconds);
-        m_VideoInfo.FirstTimeStamp = Math::Max(firstTimestamp, 0);
-
-        // In case of negative start time, we still want to expose 0-based timestamps to the outside.
-        // We keep the offset around and add/remove it to low-level ffmpeg calls.
-        if (firstTimestamp < 0)
-        {
-            m_timestampOffset = firstTimestamp - 1;
-            if (!_forSummary)
-                log->WarnFormat("Negative start time. Applying timestamp offset of {0}.", m_timestampOffset);
-        }
-
-        if (pFormatCtx->duration > 0)
-            m_VideoInfo.DurationTimeStamps = (int64_t)((double)((double)pFormatCtx->duration / (double)AV_TIME_BASE) * m_VideoInfo.AverageTimeStampsPerSeconds);
-        else
-            m_VideoInfo.DurationTimeStamps = 0;
-
-        if (m_VideoInfo.DurationTimeStamps <= 0)
-        {
-            result = OpenVideoResult::StreamInfoNotFound;
-            log->Error("Duration info not found.");
-            break;
-        }
-
-        // Average FPS. Based on the following sources:
-        // - libav in stream info (already in fAvgFrameRate).
-        // - libav in container or stream with duration in frames or microseconds (Rarely available but valid if so).
-        // - stream->time_base	(Often KO, like 90000:1, expresses the timestamps unit)
-        // - codec->time_base (Often OK, but not always).
-        // - some ad-hoc special cases.
-        int iTicksPerFrame = pCodecCtx->ticks_per_frame;
-        m_VideoInfo.FramesPerSeconds = 0;
         bool verbose = !_forSummary;
-        if (fAvgFrameRate != 0)
+        if (fromCache)
         {
-            m_VideoInfo.FramesPerSeconds = fAvgFrameRate;
+            m_VideoInfo.AverageTimeStampsPerSeconds = probe->AverageTimeStampsPerSeconds;
+            m_VideoInfo.FramesPerSeconds = probe->FramesPerSeconds;
+            m_VideoInfo.FirstTimeStamp = probe->FirstTimeStamp;
+            m_VideoInfo.DurationTimeStamps = probe->DurationTimeStamps;
+            m_VideoInfo.OriginalSize = Size(probe->Width, probe->Height);
+            m_VideoInfo.PixelAspectRatio = probe->PixelAspectRatio;
+            m_VideoInfo.SampleAspectRatio = probe->SampleAspectRatio;
+            m_timestampOffset = probe->TimestampOffset;
+
             if (verbose)
-                log->Debug("Average Fps estimation method: libav.");
+                log->Debug("Stream info found in the probe cache.");
         }
         else
         {
-            // 1.a. Durations
-            if ((pFormatCtx->streams[m_iVideoStream]->nb_frames > 0) && (pFormatCtx->duration > 0))
+            if (!ReadStreamInfo(pFormatCtx, pCodecCtx, verbose))
             {
-                m_VideoInfo.FramesPerSeconds = ((double)pFormatCtx->streams[m_iVideoStream]->nb_frames * (double)AV_TIME_BASE) / (double)pFormatCtx->duration;
-
-                if (iTicksPerFrame > 1)
-                    m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
-
-                if (verbose)
-                    log->Debug("Average Fps estimation method: Durations.");
+                result = OpenVideoResult::StreamInfoNotFound;
+                break;
             }
-            else
-            {
-                // 1.b. stream->time_base, consider invalid if >= 1000.
-                m_VideoInfo.FramesPerSeconds = (double)pFormatCtx->streams[m_iVideoStream]->time_base.den / (double)pFormatCtx->streams[m_iVideoStream]->time_base.num;
 
-                if (m_VideoInfo.FramesPerSeconds < 1000)
-                {
-                    if (iTicksPerFrame > 1)
-                        m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
-
-                    if (verbose)
-                        log->Debug("Average Fps estimation method: Stream timebase.");
-                }
-                else
-                {
-                    // 1.c. codec->time_base, consider invalid if >= 1000.
-                    m_VideoInfo.FramesPerSeconds = (double)pCodecCtx->time_base.den / (double)pCodecCtx->time_base.num;
-
-                    if (m_VideoInfo.FramesPerSeconds < 1000)
-                    {
-                        if (iTicksPerFrame > 1)
-                            m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
-
-                        if (verbose)
-                            log->Debug("Average Fps estimation method: Codec timebase.");
-                    }
-                    else if (m_VideoInfo.FramesPerSeconds == 30000)
-                    {
-                        m_VideoInfo.FramesPerSeconds = 29.97;
-                        if (verbose)
-                            log->Debug("Average Fps estimation method: special case detection (30000:1 -> 30000:1001).");
-                    }
-                    else if (m_VideoInfo.FramesPerSeconds == 25000)
-                    {
-                        m_VideoInfo.FramesPerSeconds = 24.975;
-                        if (verbose)
-                            log->Debug("Average Fps estimation method: special case detection (25000:1 -> 25000:1001).");
-                    }
-                    else
-                    {
-                        // Detection failed. Force to 25fps.
-                        m_VideoInfo.FramesPerSeconds = 25;
-                        if (verbose)
-                            log->Debug("Average Fps estimation method: Estimation failed. Fps will be forced to : " + m_VideoInfo.FramesPerSeconds);
-                    }
-                }
-            }
+            probe->VideoStream = m_iVideoStream;
+            probe->CodecId = pCodecCtx->codec_id;
+            probe->Width = pCodecCtx->width;
+            probe->Height = pCodecCtx->height;
+            probe->TimeBaseNum = pFormatCtx->streams[m_iVideoStream]->time_base.num;
+            probe->TimeBaseDen = pFormatCtx->streams[m_iVideoStream]->time_base.den;
+            probe->AverageTimeStampsPerSeconds = m_VideoInfo.AverageTimeStampsPerSeconds;
+            probe->FramesPerSeconds = m_VideoInfo.FramesPerSeconds;
+            probe->FirstTimeStamp = m_VideoInfo.FirstTimeStamp;
+            probe->DurationTimeStamps = m_VideoInfo.DurationTimeStamps;
+            probe->PixelAspectRatio = m_VideoInfo.PixelAspectRatio;
+            probe->SampleAspectRatio = m_VideoInfo.SampleAspectRatio;
+            probe->TimestampOffset = m_timestampOffset;
+            probe->Keyframes = nullptr;
+            probe->HasStreamInfo = true;
         }
 
-        if (verbose)
-            log->Debug("Ticks per frame: " + iTicksPerFrame);
-
         m_VideoInfo.FrameIntervalMilliseconds = 1000.0 / m_VideoInfo.FramesPerSeconds;
         m_VideoInfo.AverageTimeStampsPerFrame = m_VideoInfo.AverageTimeStampsPerSeconds / m_VideoInfo.FramesPerSeconds;
 
@@ -388,45 +355,12 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
             m_VideoInfo.FirstTimeStamp,
             (int64_t)Math::Round(m_VideoInfo.FirstTimeStamp + m_VideoInfo.DurationTimeStamps - m_VideoInfo.AverageTimeStampsPerFrame));
 
-        // Image size
-        m_VideoInfo.OriginalSize = Size(pCodecCtx->width, pCodecCtx->height);
-
-        if (pCodecCtx->sample_aspect_ratio.num != 0 && pCodecCtx->sample_aspect_ratio.num != pCodecCtx->sample_aspect_ratio.den)
-        {
-            // Anamorphic video, non square pixels.
-            if (verbose)
-                log->Debug("Display Aspect Ratio type: Anamorphic");
-
-            if (pCodecCtx->codec_id == CODEC_ID_MPEG2VIDEO)
-            {
-                // If MPEG, sample_aspect_ratio is actually the DAR...
-                // Reference for weird decision tree: mpeg12.c at mpeg_decode_postinit().
-                double fDisplayAspectRatio = (double)pCodecCtx->sample_aspect_ratio.num / (double)pCodecCtx->sample_aspect_ratio.den;
-                m_VideoInfo.PixelAspectRatio = ((double)pCodecCtx->height * fDisplayAspectRatio) / (double)pCodecCtx->width;
-
-                if (m_VideoInfo.PixelAspectRatio < 1.0f)
-                    m_VideoInfo.PixelAspectRatio = fDisplayAspectRatio;
-            }
-            else
-            {
-                m_VideoInfo.PixelAspectRatio = (double)pCodecCtx->sample_aspect_ratio.num / (double)pCodecCtx->sample_aspect_ratio.den;
-            }
-
-            m_VideoInfo.SampleAspectRatio = Fraction(pCodecCtx->sample_aspect_ratio.num, pCodecCtx->sample_aspect_ratio.den);
-        }
-        else
-        {
-            // Assume PAR=1:1.
-            if (verbose)
-                log->Debug("Display Aspect Ratio type: Square Pixels");
-            m_VideoInfo.PixelAspectRatio = 1.0f;
-        }
-
         Options->ImageRotation = m_VideoInfo.ImageRotation;
         UpdateReferenceSizes(Options->ImageAspectRatio, verbose);
         
         m_pFormatCtx = pFormatCtx;
         m_pCodecCtx = pCodecCtx;
+        m_ProbeResult = probe;
 
         m_bIsLoaded = true;
 
@@ -480,6 +414,209 @@ OpenVideoResult VideoReaderFFMpeg::Load(String^ _filePath, bool _forSummary)
     return result;
 }
 
+bool VideoReaderFFMpeg::ReadStreamInfo(AVFormatContext* pFormatCtx, AVCodecContext* pCodecCtx, bool verbose)
+{
+    //------------------------------------------------------------------------------------
+    // Timing, image size and aspect ratio of the video stream, from the probed format context.
+    //------------------------------------------------------------------------------------
+
+    // The fundamental unit of time in Kinovea is the timebase of the file.
+    // The timebase unit is the span of time (in seconds) in which the timestamps are expressed.
+    if (m_Verbose)
+        log->DebugFormat("pFormatCtx->streams[m_iVideoStream]->time_base.den: {0}, .num: {1}", pFormatCtx->streams[m_iVideoStream]->time_base.den, pFormatCtx->streams[m_iVideoStream]->time_base.num);
+
+    m_VideoInfo.AverageTimeStampsPerSeconds = (double)pFormatCtx->streams[m_iVideoStream]->time_base.den / (double)pFormatCtx->streams[m_iVideoStream]->time_base.num;
+    double fAvgFrameRate = 0.0;
+    if (pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.den != 0)
+        fAvgFrameRate = (double)pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.num / (double)pFormatCtx->streams[m_iVideoStream]->avg_frame_rate.den;
+
+    m_timestampOffset = 0;
+
+    // This may be updated after the first actual decoding.
+    long firstTimestamp = (long)((double)((double)pFormatCtx->start_time / (double)AV_TIME_BASE) * m_VideoInfo.AverageTimeStampsPerSeconds);
+    m_VideoInfo.FirstTimeStamp = Math::Max(firstTimestamp, 0);
+
+    // In case of negative start time, we still want to expose 0-based timestamps to the outside.
+    // We keep the offset around and add/remove it to low-level ffmpeg calls.
+    if (firstTimestamp < 0)
+    {
+        m_timestampOffset = firstTimestamp - 1;
+        if (verbose)
+            log->WarnFormat("Negative start time. Applying timestamp offset of {0}.", m_timestampOffset);
+    }
+
+    if (pFormatCtx->duration > 0)
+        m_VideoInfo.DurationTimeStamps = (int64_t)((double)((double)pFormatCtx->duration / (double)AV_TIME_BASE) * m_VideoInfo.AverageTimeStampsPerSeconds);
+    else
+        m_VideoInfo.DurationTimeStamps = 0;
+
+    if (m_VideoInfo.DurationTimeStamps <= 0)
+    {
+        log->Error("Duration info not found.");
+        return false;
+    }
+
+    // Average FPS. Based on the following sources:
+    // - libav in stream info (already in fAvgFrameRate).
+    // - libav in container or stream with duration in frames or microseconds (Rarely available but valid if so).
+    // - stream->time_base	(Often KO, like 90000:1, expresses the timestamps unit)
+    // - codec->time_base (Often OK, but not always).
+    // - some ad-hoc special cases.
+    int iTicksPerFrame = pCodecCtx->ticks_per_frame;
+    m_VideoInfo.FramesPerSeconds = 0;
+    if (fAvgFrameRate != 0)
+    {
+        m_VideoInfo.FramesPerSeconds = fAvgFrameRate;
+        if (verbose)
+            log->Debug("Average Fps estimation method: libav.");
+    }
+    else
+    {
+        // 1.a. Durations
+        if ((pFormatCtx->streams[m_iVideoStream]->nb_frames > 0) && (pFormatCtx->duration > 0))
+        {
+            m_VideoInfo.FramesPerSeconds = ((double)pFormatCtx->streams[m_iVideoStream]->nb_frames * (double)AV_TIME_BASE) / (double)pFormatCtx->duration;
+
+            if (iTicksPerFrame > 1)
+                m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
+
+            if (verbose)
+                log->Debug("Average Fps estimation method: Durations.");
+        }
+        else
+        {
+            // 1.b. stream->time_base, consider invalid if >= 1000.
+            m_VideoInfo.FramesPerSeconds = (double)pFormatCtx->streams[m_iVideoStream]->time_base.den / (double)pFormatCtx->streams[m_iVideoStream]->time_base.num;
+
+            if (m_VideoInfo.FramesPerSeconds < 1000)
+            {
+                if (iTicksPerFrame > 1)
+                    m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
+
+                if (verbose)
+                    log->Debug("Average Fps estimation method: Stream timebase.");
+            }
+            else
+            {
+                // 1.c. codec->time_base, consider invalid if >= 1000.
+                m_VideoInfo.FramesPerSeconds = (double)pCodecCtx->time_base.den / (double)pCodecCtx->time_base.num;
+
+                if (m_VideoInfo.FramesPerSeconds < 1000)
+                {
+                    if (iTicksPerFrame > 1)
+                        m_VideoInfo.FramesPerSeconds /= iTicksPerFrame;
+
+                    if (verbose)
+                        log->Debug("Average Fps estimation method: Codec timebase.");
+                }
+                else if (m_VideoInfo.FramesPerSeconds == 30000)
+                {
+                    m_VideoInfo.FramesPerSeconds = 29.97;
+                    if (verbose)
+                        log->Debug("Average Fps estimation method: special case detection (30000:1 -> 30000:1001).");
+                }
+                else if (m_VideoInfo.FramesPerSeconds == 25000)
+                {
+                    m_VideoInfo.FramesPerSeconds = 24.975;
+                    if (verbose)
+                        log->Debug("Average Fps estimation method: special case detection (25000:1 -> 25000:1001).");
+                }
+                else
+                {
+                    // Detection failed. Force to 25fps.
+                    m_VideoInfo.FramesPerSeconds = 25;
+                    if (verbose)
+                        log->Debug("Average Fps estimation method: Estimation failed. Fps will be forced to : " + m_VideoInfo.FramesPerSeconds);
+                }
+            }
+        }
+    }
+
+    if (verbose)
+        log->Debug("Ticks per frame: " + iTicksPerFrame);
+
+    // Image size
+    m_VideoInfo.OriginalSize = Size(pCodecCtx->width, pCodecCtx->height);
+
+    if (pCodecCtx->sample_aspect_ratio.num != 0 && pCodecCtx->sample_aspect_ratio.num != pCodecCtx->sample_aspect_ratio.den)
+    {
+        // Anamorphic video, non square pixels.
+        if (verbose)
+            log->Debug("Display Aspect Ratio type: Anamorphic");
+
+        if (pCodecCtx->codec_id == CODEC_ID_MPEG2VIDEO)
+        {
+            // If MPEG, sample_aspect_ratio is actually the DAR...
+            // Reference for weird decision tree: mpeg12.c at mpeg_decode_postinit().
+            double fDisplayAspectRatio = (double)pCodecCtx->sample_aspect_ratio.num / (double)pCodecCtx->sample_aspect_ratio.den;
+            m_VideoInfo.PixelAspectRatio = ((double)pCodecCtx->height * fDisplayAspectRatio) / (double)pCodecCtx->width;
+
+            if (m_VideoInfo.PixelAspectRatio < 1.0f)
+                m_VideoInfo.PixelAspectRatio = fDisplayAspectRatio;
+        }
+        else
+        {
+            m_VideoInfo.PixelAspectRatio = (double)pCodecCtx->sample_aspect_ratio.num / (double)pCodecCtx->sample_aspect_ratio.den;
+        }
+
+        m_VideoInfo.SampleAspectRatio = Fraction(pCodecCtx->sample_aspect_ratio.num, pCodecCtx->sample_aspect_ratio.den);
+    }
+    else
+    {
+        // Assume PAR=1:1.
+        if (verbose)
+            log->Debug("Display Aspect Ratio type: Square Pixels");
+        m_VideoInfo.PixelAspectRatio = 1.0f;
+    }
+
+    return true;
+}
+
+bool VideoReaderFFMpeg::MatchesProbe(AVFormatContext* _pFormatCtx, ProbeResult^ _probe)
+{
+    // The header parsed by avformat_open_input must describe the same video stream as the cached entry.
+    // Containers that only know the codec parameters after probing (raw streams, MPEG-TS) never match here.
+    if (_probe->VideoStream < 0 || _probe->VideoStream >= (int)_pFormatCtx->nb_streams)
+        return false;
+
+    AVStream* pStream = _pFormatCtx->streams[_probe->VideoStream];
+    AVCodecContext* pCodecCtx = pStream->codec;
+    return pCodecCtx->codec_type == AVMEDIA_TYPE_VIDEO &&
+        pCodecCtx->codec_id == _probe->CodecId &&
+        pCodecCtx->width == _probe->Width &&
+        pCodecCtx->height == _probe->Height &&
+        pStream->time_base.num == _probe->TimeBaseNum &&
+        pStream->time_base.den == _probe->TimeBaseDen;
+}
+
+void VideoReaderFFMpeg::SetupDecoderThreading(AVCodecContext* _pCodecCtx, DecoderThreading _threading)
+{
+    // Must be called before opening the codec.
+    // A thread count of 0 lets libav pick one thread per core.
+    // The decoder falls back to single threading if it doesn't support the requested type.
+    switch (_threading)
+    {
+    case DecoderThreading::Frame:
+        _pCodecCtx->thread_count = 0;
+        _pCodecCtx->thread_type = FF_THREAD_FRAME;
+        break;
+    case DecoderThreading::Slice:
+        _pCodecCtx->thread_count = 0;
+        _pCodecCtx->thread_type = FF_THREAD_SLICE;
+        break;
+    case DecoderThreading::Off:
+        _pCodecCtx->thread_count = 1;
+        _pCodecCtx->thread_type = 0;
+        break;
+    case DecoderThreading::Auto:
+    default:
+        // Frame threading is preferred when the codec supports it.
+        _pCodecCtx->thread_count = 0;
+        _pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        break;
+    }
+}
+
 int VideoReaderFFMpeg::GetStreamIndex(AVFormatContext* _pFormatCtx, int _iCodecType)
 {
     // Returns the best candidate stream for the specified type, -1 if not found.
@@ -889,6 +1026,7 @@ bool VideoReaderFFMpeg::ChangeAspectRatio(ImageAspectRatio aspectRatio)
 
     Options->ImageAspectRatio = aspectRatio;
     UpdateReferenceSizes(Options->ImageAspectRatio, true);
+    InvalidateScalingContext();
     
     m_FramesContainer->Clear();
     return true;
@@ -930,6 +1068,7 @@ bool VideoReaderFFMpeg::ChangeDemosaicing(Demosaicing demosaicing)
     }
 
     Options->Demosaicing = demosaicing;
+    InvalidateScalingContext();
 
     m_FramesContainer->Clear();
     return true;
@@ -1002,6 +1141,8 @@ bool VideoReaderFFMpeg::ChangeDecodingSize(Size _size)
     StopPreBuffering();
     m_PreBuffer->Clear();
     m_DecodingSize = targetSize;
+    InvalidateScalingContext();
+    m_BufferPool->Flush();
 
     m_CanDrawUnscaled = true;
 
@@ -1046,6 +1187,9 @@ void VideoReaderFFMpeg::ResetDecodingSize()
     // Reset the decoding size to the default.
     // "Aspect ratio size" is the video image size with 
     // custom aspect ratio and padded along rotated width.
+    if (m_DecodingSize != m_VideoInfo.AspectRatioSize)
+        m_BufferPool->Flush();
+
     m_DecodingSize = m_VideoInfo.AspectRatioSize;
 }
 
@@ -1102,6 +1246,59 @@ Size VideoReaderFFMpeg::FixSize(Size _size, bool sideways)
 
 #pragma endregion
 
+#pragma region Stream copy
+
+bool VideoReaderFFMpeg::CanCopySection(VideoSection _section, String^ _formatString)
+{
+    if (!m_bIsLoaded || m_bIsVeryShort)
+        return false;
+
+    // The copy must start on a keyframe, the index is needed to find it. It is only published once complete.
+    if (m_KeyframeIndex == nullptr || GetCopySection(_section).IsEmpty)
+        return false;
+
+    return StreamCopier::CanCopy(m_VideoInfo.FilePath, m_iVideoStream, _formatString);
+}
+
+VideoSection VideoReaderFFMpeg::GetCopySection(VideoSection _section)
+{
+    KeyframeIndex^ index = m_KeyframeIndex;
+    int64_t start;
+    int64_t end;
+    if (!m_bIsLoaded || index == nullptr || !index->FindGroupBounds(_section.Start + m_timestampOffset, _section.End + m_timestampOffset, start, end))
+        return VideoSection::MakeEmpty();
+
+    // Without frame reordering nothing presented after the end is needed, the copy can stop exactly there.
+    if (m_pCodecCtx->has_b_frames == 0)
+        end = _section.End + m_timestampOffset;
+
+    return VideoSection(start - m_timestampOffset, end - m_timestampOffset);
+}
+
+SaveResult VideoReaderFFMpeg::CopySection(SavingSettings^ _settings, String^ _formatString, BackgroundWorker^ _worker)
+{
+    if (!m_bIsLoaded)
+        return SaveResult::MovieNotLoaded;
+
+    int64_t start = _settings->Section.Start + m_timestampOffset;
+    int64_t end = _settings->Section.End + m_timestampOffset;
+    KeyframeIndex^ index = m_KeyframeIndex;
+    int totalFrames = index != nullptr ? index->CountFrames(start, end) : _settings->TotalFrameCount;
+
+    return StreamCopier::Copy(
+        m_VideoInfo.FilePath,
+        m_iVideoStream,
+        start,
+        end,
+        index,
+        _settings->File,
+        _formatString,
+        totalFrames,
+        _worker);
+}
+
+#pragma endregion
+
 #pragma region Low level frame reading
 
 bool VideoReaderFFMpeg::ReadMany(BackgroundWorker^ _bgWorker, VideoSection _section, bool _prepend)
@@ -1248,10 +1445,17 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
         if (iTargetTimeStamp < 0)
             iTargetTimeStamp = 0;
     }
+    else if (iTargetTimeStamp < 0 && _iFramesToDecode > 0 && m_ResyncTimestamp >= 0)
+    {
+        // Frames were dropped when the prebuffering stopped, the decoder is ahead of the last frame we kept.
+        // Seek back to the first dropped frame instead of reading on from the decoder position.
+        iTargetTimeStamp = (int64_t)Math::Round(m_ResyncTimestamp + ((_iFramesToDecode - 1) * m_VideoInfo.AverageTimeStampsPerFrame));
+    }
 
     if (iTargetTimeStamp >= 0)
     {
         seeking = true;
+        m_ResyncTimestamp = -1;
         iFramesToDecode = 1; // We'll use the target timestamp anyway.
         int iSeekRes = SeekTo(iTargetTimeStamp);
         if (iSeekRes < 0)
@@ -1261,24 +1465,21 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
         }
     }
 
-    // Allocate 2 AVFrames, one for the raw decoded frame and one for deinterlaced/rescaled/converted frame.
+    // The decoded picture. Frames are reference counted so the conversion stage can hold on to
+    // a decoded picture while we already decode the next one.
     AVFrame* pDecodingAVFrame = av_frame_alloc();
-    AVFrame* pFinalAVFrame = av_frame_alloc();
-
-    // The buffer holding the actual frame data.
-    int iSizeBuffer = avpicture_get_size(m_PixelFormatFFmpeg, m_DecodingSize.Width, m_DecodingSize.Height);
-    uint8_t* pBuffer = iSizeBuffer > 0 ? new uint8_t[iSizeBuffer] : nullptr;
-
-    if (pDecodingAVFrame == nullptr || pFinalAVFrame == nullptr || pBuffer == nullptr)
+    if (pDecodingAVFrame == nullptr)
         return ReadResult::MemoryNotAllocated;
 
-    // Assigns appropriate parts of buffer to image planes in the AVFrame.
-    avpicture_fill((AVPicture*)pFinalAVFrame, pBuffer, m_PixelFormatFFmpeg, m_DecodingSize.Width, m_DecodingSize.Height);
+    // When running on the prebuffering thread the conversion is done on a separate thread.
+    BlockingCollection<PendingFrame>^ conversionQueue = m_ConversionQueue;
+    bool pipelined = conversionQueue != nullptr && Thread::CurrentThread == m_PreBufferingThread;
 
     m_TimestampInfo.CurrentTimestamp = m_FramesContainer->CurrentFrame == nullptr ? -1 : m_FramesContainer->CurrentFrame->Timestamp;
 
     // Reading/Decoding loop
     bool done = false;
+    bool draining = false;
     bool bFirstPass = true;
     int iReadFrameResult;
     int gotPicturePtr = 0;
@@ -1291,17 +1492,33 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
         // To solve the DTS/PTS issue, we save the timestamps each time we find libav is buffering a frame.
         // And we use the previously saved timestamps.
         // Ref: http://lists.mplayerhq.hu/pipermail/libav-user/2008-August/001069.html
+        //
+        // With frame threading the decoder holds up to one additional frame per thread, 
+        // so the delay between the packet read and the frame output grows accordingly. 
+        // The timestamp is always taken from the frame coming out of the decoder so this is transparent,
+        // but at the end of the file the delayed frames must be drained with empty packets.
 
         // Read next packet
         AVPacket inputPacket;
         iReadFrameResult = av_read_frame(m_pFormatCtx, &inputPacket);
         if (iReadFrameResult < 0)
         {
-            // Reading error. We don't know if the error happened on a video frame or audio one.
-            done = true;
-            delete[] pBuffer;
-            result = ReadResult::FrameNotRead;
-            break;
+            bool canDrain = iReadFrameResult == AVERROR_EOF && (m_pCodecCtx->codec->capabilities & CODEC_CAP_DELAY) != 0;
+            if (!draining && !canDrain)
+            {
+                // Reading error. We don't know if the error happened on a video frame or audio one.
+                // Only the end of file means there is nothing left to read, other errors are not a reason to flush the decoder.
+                done = true;
+                result = ReadResult::FrameNotRead;
+                break;
+            }
+
+            // End of file. Flush the frames still buffered in the decoder.
+            draining = true;
+            av_init_packet(&inputPacket);
+            inputPacket.data = nullptr;
+            inputPacket.size = 0;
+            inputPacket.stream_index = m_iVideoStream;
         }
 
         if (inputPacket.stream_index != m_iVideoStream)
@@ -1312,7 +1529,17 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
 
         // Decode video packet. This is needed even if we're not on the final frame yet.
         // I-Frame data is kept internally by ffmpeg which will need it to build the final frame.
+        // Release our reference on the previous picture first, the conversion stage may still hold its own.
+        av_frame_unref(pDecodingAVFrame);
         avcodec_decode_video2(m_pCodecCtx, pDecodingAVFrame, &gotPicturePtr, &inputPacket);
+        if (gotPicturePtr == 0 && draining)
+        {
+            // The decoder is empty, this is the real end of the file.
+            done = true;
+            result = ReadResult::FrameNotRead;
+            break;
+        }
+        
         if (gotPicturePtr == 0)
         {
             // Buffering frame. libav just read a I or P frame that will be presented later.
@@ -1355,6 +1582,7 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
 
             avformat_seek_file(m_pFormatCtx, m_iVideoStream, iMinTarget + m_timestampOffset, iForceSeekTimestamp + m_timestampOffset, iForceSeekTimestamp + m_timestampOffset, AVSEEK_FLAG_BACKWARD);
             avcodec_flush_buffers(m_pFormatCtx->streams[m_iVideoStream]->codec);
+            draining = false;
 
             // Free the packet that was allocated by av_read_frame
             av_free_packet(&inputPacket);
@@ -1377,94 +1605,49 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
         {
             done = true;
 
-            if (m_Verbose && seeking /* && m_TimestampInfo.CurrentTimestamp != iTargetTimeStamp*/)
+            if (seeking)
             {
-                log->DebugFormat("Seeking to [{0}] completed. Final position:[{1}], decoded: {2} frames.", 
-                    iTargetTimeStamp, m_TimestampInfo.CurrentTimestamp, iFramesDecoded);
+                m_SeekCount++;
+                m_SeekFramesDecoded += iFramesDecoded;
             }
 
-            // Deinterlace + rescale + convert pixel format.
-            bool rescaled = RescaleAndConvert(
-                pFinalAVFrame,
-                pDecodingAVFrame,
-                m_DecodingSize.Width,
-                m_DecodingSize.Height,
-                m_PixelFormatFFmpeg,
-                Options->Deinterlace);
-
-            if (!rescaled)
+            if (m_Verbose && seeking /* && m_TimestampInfo.CurrentTimestamp != iTargetTimeStamp*/)
             {
-                delete[] pBuffer;
-                result = ReadResult::ImageNotConverted;
-                break;
+                log->DebugFormat("Seeking to [{0}] completed. Final position:[{1}], decoded: {2} frames (expected: {3}, average: {4:0.0}).", 
+                    iTargetTimeStamp, m_TimestampInfo.CurrentTimestamp, iFramesDecoded, m_SeekExpectedFrames, FramesDecodedPerSeek);
             }
 
-            try
+            if (pipelined)
             {
-                // Import ffmpeg buffer into a .NET bitmap.
-                int imageStride = pFinalAVFrame->linesize[0];
-                IntPtr scan0 = IntPtr((void*)pFinalAVFrame->data[0]);
-                Bitmap^ bmp = nullptr;
-                if (stabOffsets->ContainsKey(m_TimestampInfo.CurrentTimestamp))
+                // Hand the decoded picture over to the conversion thread and go back to decoding.
+                // The clone only adds a reference to the picture, the data is not copied.
+                // This blocks when the conversion thread is behind.
+                AVFrame* pPendingFrame = av_frame_clone(pDecodingAVFrame);
+                if (pPendingFrame == nullptr)
                 {
-                    // Image stabilization. Paint the image with the offset applied.
-                    // Prepare output bitmap.
-                    bmp = gcnew Bitmap(m_DecodingSize.Width, m_DecodingSize.Height, DecodingPixelFormat);
-
-                    // Get the decoded frame in a bitmap and paint it over the output.
-                    Bitmap^ bmp2 = gcnew Bitmap(m_DecodingSize.Width, m_DecodingSize.Height, imageStride, DecodingPixelFormat, scan0);
-                    Graphics^ g = Graphics::FromImage(bmp);
-                    float dx = stabOffsets[m_TimestampInfo.CurrentTimestamp]->X;
-                    float dy = stabOffsets[m_TimestampInfo.CurrentTimestamp]->Y;
-                    // TODO: handle scaling (decoding size).
-                    g->DrawImageUnscaled(bmp2, (int)(-dx), (int)(-dy));
-                    delete g;
-                    delete bmp2;
+                    result = ReadResult::MemoryNotAllocated;
                 }
                 else
                 {
-                    bmp = gcnew Bitmap(m_DecodingSize.Width, m_DecodingSize.Height, imageStride, DecodingPixelFormat, scan0);
-                }
+                    PendingFrame pending;
+                    pending.Frame = IntPtr((void*)pPendingFrame);
+                    pending.Timestamp = m_TimestampInfo.CurrentTimestamp;
 
-                // Rotation is handled after scaling and aspect ratio fix for simplicity.
-                // In later versions of FFMpeg there are rotation routines built in, that might be simpler and faster.
-                switch (m_VideoInfo.ImageRotation)
-                {
-                case ImageRotation::Rotate90:
-                    bmp->RotateFlip(RotateFlipType::Rotate90FlipNone);
-                    break;
-                case ImageRotation::Rotate180:
-                    bmp->RotateFlip(RotateFlipType::Rotate180FlipNone);
-                    break;
-                case ImageRotation::Rotate270:
-                    bmp->RotateFlip(RotateFlipType::Rotate270FlipNone);
-                    break;
-                default:
-                    break;
+                    m_LoopWatcher->LoopEnd();
+                    conversionQueue->Add(pending);
                 }
-
-                // Store a pointer to the native buffer inside the Bitmap.
-                // We'll be asked to free this resource later when the frame is not used anymore.
-                // It is boxed inside an Object so we can extract it in a type-safe way.
-                IntPtr^ boxedPtr = gcnew IntPtr((void*)pBuffer);
-                bmp->Tag = boxedPtr;
-
-                // Construct the VideoFrame and push it to the current container.
-                VideoFrame^ vf = gcnew VideoFrame();
-                vf->Image = bmp;
-                vf->Timestamp = m_TimestampInfo.CurrentTimestamp;
-
-                m_LoopWatcher->LoopEnd();
-
-                // Finally, add the frame to the container.
-                m_FramesContainer->Add(vf);
             }
-            catch (Exception^ exp)
+            else
             {
-                delete[] pBuffer;
-                result = ReadResult::ImageNotConverted;
-                log->Error("Error while converting AVFrame to Bitmap.");
-                log->Error(exp);
+                VideoFrame^ vf = nullptr;
+                result = ConvertFrame(pDecodingAVFrame, m_TimestampInfo.CurrentTimestamp, vf);
+                if (result == ReadResult::Success)
+                {
+                    m_LoopWatcher->LoopEnd();
+
+                    // Finally, add the frame to the container.
+                    m_FramesContainer->Add(vf);
+                }
             }
         }
 
@@ -1472,9 +1655,8 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
         av_free_packet(&inputPacket);
     } while (!done);
 
-    // Free the AVFrames. (This will not deallocate the data buffers).
-    av_free(pFinalAVFrame);
-    av_free(pDecodingAVFrame);
+    // Free the decoding AVFrame and release our reference on the picture.
+    av_frame_free(&pDecodingAVFrame);
 
 #ifdef INSTRUMENTATION	
     if (m_FramesContainer->Current != nullptr)
@@ -1491,6 +1673,123 @@ ReadResult VideoReaderFFMpeg::ReadFrame(int64_t _iTimeStampToSeekTo, int _iFrame
     return result;
 }
 
+ReadResult VideoReaderFFMpeg::ConvertFrame(AVFrame* _pDecodedFrame, int64_t _timestamp, VideoFrame^% _frame)
+{
+    //------------------------------------------------------------------------------------
+    // Deinterlaces, rescales and converts a decoded picture into a buffer from the pool, 
+    // and wraps it into a VideoFrame ready to be pushed to a frame container.
+    // Rotation and stabilization are applied after the conversion, each pass writing into
+    // a second pooled buffer and swapping it with the first.
+    // Runs on the calling thread for synchronous reads, and on the conversion thread
+    // when prebuffering.
+    //------------------------------------------------------------------------------------
+    lock l(m_ConversionLocker);
+
+    ImageRotation rotation = m_VideoInfo.ImageRotation;
+    bool rotated = rotation != ImageRotation::Rotate0;
+    TimedPoint^ stabOffset = nullptr;
+    bool stabilized = stabOffsets->TryGetValue(_timestamp, stabOffset);
+
+    // The AVFrame for the deinterlaced/rescaled/converted picture.
+    AVFrame* pFinalAVFrame = av_frame_alloc();
+
+    // The buffer holding the actual frame data.
+    // It comes from the pool and goes back to it when the frame is disposed.
+    int iSizeBuffer = avpicture_get_size(m_PixelFormatFFmpeg, m_DecodingSize.Width, m_DecodingSize.Height);
+    uint8_t* pBuffer = m_BufferPool->Rent(iSizeBuffer);
+    uint8_t* pSpare = (rotated || stabilized) ? m_BufferPool->Rent(iSizeBuffer) : nullptr;
+
+    if (pFinalAVFrame == nullptr || pBuffer == nullptr || ((rotated || stabilized) && pSpare == nullptr))
+    {
+        av_frame_free(&pFinalAVFrame);
+        m_BufferPool->Return(pBuffer);
+        m_BufferPool->Return(pSpare);
+        return ReadResult::MemoryNotAllocated;
+    }
+
+    // Assigns appropriate parts of buffer to image planes in the AVFrame.
+    avpicture_fill((AVPicture*)pFinalAVFrame, pBuffer, m_PixelFormatFFmpeg, m_DecodingSize.Width, m_DecodingSize.Height);
+
+    // Deinterlace + rescale + convert pixel format.
+    bool rescaled = RescaleAndConvert(
+        pFinalAVFrame,
+        _pDecodedFrame,
+        m_DecodingSize.Width,
+        m_DecodingSize.Height,
+        m_PixelFormatFFmpeg,
+        Options->Deinterlace);
+
+    Size imageSize = m_DecodingSize;
+    int imageStride = pFinalAVFrame->linesize[0];
+    av_frame_free(&pFinalAVFrame);
+
+    if (!rescaled)
+    {
+        m_BufferPool->Return(pBuffer);
+        m_BufferPool->Return(pSpare);
+        return ReadResult::ImageNotConverted;
+    }
+
+    if (rotated)
+    {
+        // Rotation is handled after scaling and aspect ratio fix for simplicity.
+        Size rotatedSize = ImageRotator::GetRotatedSize(imageSize, rotation);
+        int rotatedStride = rotatedSize.Width * 4;
+        ImageRotator::Rotate(IntPtr((void*)pBuffer), imageSize.Width, imageSize.Height, imageStride, IntPtr((void*)pSpare), rotatedStride, 4, rotation, false);
+
+        uint8_t* pRotated = pSpare;
+        pSpare = pBuffer;
+        pBuffer = pRotated;
+        imageSize = rotatedSize;
+        imageStride = rotatedStride;
+    }
+
+    if (stabilized)
+    {
+        // Image stabilization. Shift the image by the offset of the tracked point at this time.
+        // The offsets are in reference image coordinates, the image may be decoded at a different size.
+        float scaleX = (float)imageSize.Width / m_VideoInfo.ReferenceSize.Width;
+        float scaleY = (float)imageSize.Height / m_VideoInfo.ReferenceSize.Height;
+        ImageStabilizer::Stabilize(IntPtr((void*)pBuffer), imageSize.Width, imageSize.Height, imageStride, IntPtr((void*)pSpare), imageStride, 
+            stabOffset->X * scaleX, stabOffset->Y * scaleY, 0);
+
+        uint8_t* pStabilized = pSpare;
+        pSpare = pBuffer;
+        pBuffer = pStabilized;
+    }
+
+    m_BufferPool->Return(pSpare);
+
+    ReadResult result = ReadResult::Success;
+
+    try
+    {
+        // Import the native buffer into a .NET bitmap.
+        Bitmap^ bmp = gcnew Bitmap(imageSize.Width, imageSize.Height, imageStride, DecodingPixelFormat, IntPtr((void*)pBuffer));
+
+        // Store a pointer to the native buffer inside the Bitmap.
+        // We'll be asked to free this resource later when the frame is not used anymore.
+        // It is boxed inside an Object so we can extract it in a type-safe way.
+        IntPtr^ boxedPtr = gcnew IntPtr((void*)pBuffer);
+        bmp->Tag = boxedPtr;
+
+        // Construct the VideoFrame.
+        VideoFrame^ vf = gcnew VideoFrame();
+        vf->Image = bmp;
+        vf->Timestamp = _timestamp;
+        _frame = vf;
+    }
+    catch (Exception^ exp)
+    {
+        m_BufferPool->Return(pBuffer);
+        result = ReadResult::ImageNotConverted;
+        log->Error("Error while converting AVFrame to Bitmap.");
+        log->Error(exp);
+    }
+
+    return result;
+}
+
 int VideoReaderFFMpeg::SeekTo(int64_t _target)
 {
     // Perform an FFMpeg seek without decoding the frame.
@@ -1499,6 +1798,24 @@ int VideoReaderFFMpeg::SeekTo(int64_t _target)
     int64_t minTs = m_timestampOffset;
     int64_t ts = _target + m_timestampOffset;
     int64_t maxTs = (int64_t)(_target + m_timestampOffset + m_VideoInfo.AverageTimeStampsPerSeconds);
+    m_SeekExpectedFrames = -1;
+
+    // If the keyframe index is ready we know exactly which keyframe precedes the target.
+    // Seeking on it rather than on the target prevents the demuxer from landing after the target,
+    // and tells us how many frames will have to be decoded.
+    KeyframeIndex^ index = m_KeyframeIndex;
+    if (index != nullptr)
+    {
+        int64_t keyframePts;
+        int64_t seekTarget = index->FindSeekTarget(ts, keyframePts);
+        if (seekTarget != AV_NOPTS_VALUE)
+        {
+            ts = seekTarget;
+            maxTs = seekTarget;
+            minTs = Math::Min(minTs, seekTarget);
+            m_SeekExpectedFrames = index->CountFrames(keyframePts, _target + m_timestampOffset);
+        }
+    }
 
     int res = avformat_seek_file(
         m_pFormatCtx,
@@ -1518,7 +1835,6 @@ bool VideoReaderFFMpeg::RescaleAndConvert(AVFrame* _pOutputFrame, AVFrame* _pInp
     //------------------------------------------------------------------------
     // Utility function called by ReadFrame().
     // Take the frame we just decoded and turn it to the right size/deint/fmt.
-    // todo: sws_getContext could be done only once.
     //------------------------------------------------------------------------
     bool bSuccess = true;
     AVPixelFormat srcFormat = m_pCodecCtx->pix_fmt;
@@ -1545,11 +1861,16 @@ bool VideoReaderFFMpeg::RescaleAndConvert(AVFrame* _pOutputFrame, AVFrame* _pInp
         }
     }
 
-    SwsContext* c = sws_getContext(
+    SwsContext* c = GetScalingContext(
         m_pCodecCtx->width, m_pCodecCtx->height, srcFormat,
         _decodingWidth, _decodingHeight, (AVPixelFormat)_outputFmt,
-        DecodingQuality,
-        nullptr, nullptr, nullptr);
+        DecodingQuality);
+
+    if (c == nullptr)
+    {
+        log->Error("RescaleAndConvert Error : scaling context could not be created.");
+        return false;
+    }
 
     uint8_t** srcSlice = nullptr;               // Array containing pointers to planes of source slice.
     int* srcStride = nullptr;                   // Array containing strides for each plane of the source image. 
@@ -1606,26 +1927,172 @@ bool VideoReaderFFMpeg::RescaleAndConvert(AVFrame* _pOutputFrame, AVFrame* _pInp
     }
 
     // Clean Up.
-    sws_freeContext(c);
-
     if (pDeinterlaceBuffer != nullptr)
         delete[] pDeinterlaceBuffer;
 
     return bSuccess;
 }
 
+SwsContext* VideoReaderFFMpeg::GetScalingContext(int _srcWidth, int _srcHeight, AVPixelFormat _srcFormat, int _dstWidth, int _dstHeight, AVPixelFormat _dstFormat, int _flags)
+{
+    // Returns the scaling context matching the parameters, reusing the existing one if possible.
+    // Building the filter tables is expensive so we only do it when the source, destination or quality change.
+    if (m_pScalingContext != nullptr &&
+        m_ScalingSrcWidth == _srcWidth && m_ScalingSrcHeight == _srcHeight && m_ScalingSrcFormat == _srcFormat &&
+        m_ScalingDstWidth == _dstWidth && m_ScalingDstHeight == _dstHeight && m_ScalingDstFormat == _dstFormat &&
+        m_ScalingFlags == _flags)
+    {
+        m_ScalingContextHits++;
+        return m_pScalingContext;
+    }
+
+    InvalidateScalingContext();
+
+    m_pScalingContext = sws_getContext(
+        _srcWidth, _srcHeight, _srcFormat,
+        _dstWidth, _dstHeight, _dstFormat,
+        _flags,
+        nullptr, nullptr, nullptr);
+
+    if (m_pScalingContext == nullptr)
+        return nullptr;
+
+    m_ScalingSrcWidth = _srcWidth;
+    m_ScalingSrcHeight = _srcHeight;
+    m_ScalingSrcFormat = _srcFormat;
+    m_ScalingDstWidth = _dstWidth;
+    m_ScalingDstHeight = _dstHeight;
+    m_ScalingDstFormat = _dstFormat;
+    m_ScalingFlags = _flags;
+    m_ScalingContextMisses++;
+
+    if (m_Verbose)
+        log->DebugFormat("Scaling context created: {0}x{1} -> {2}x{3}. (hits:{4}, misses:{5}).",
+            _srcWidth, _srcHeight, _dstWidth, _dstHeight, m_ScalingContextHits, m_ScalingContextMisses);
+
+    return m_pScalingContext;
+}
+
+void VideoReaderFFMpeg::InvalidateScalingContext()
+{
+    // Called when the decoding size, aspect ratio or demosaicing changes, and on close.
+    // Must not take the main lock: the decoding thread may hold it while waiting on the conversion thread.
+    lock l(m_ConversionLocker);
+
+    if (m_pScalingContext == nullptr)
+        return;
+
+    sws_freeContext(m_pScalingContext);
+    m_pScalingContext = nullptr;
+}
+
 void VideoReaderFFMpeg::DisposeFrame(VideoFrame^ _frame)
 {
-    // Dispose the Bitmap and the native buffer.
+    // Dispose the Bitmap and give the native buffer back to the pool.
     // The pointer to the native buffer was stored in the Tag property.
     IntPtr^ ptr = dynamic_cast<IntPtr^>(_frame->Image->Tag);
     delete _frame->Image;
 
     if (ptr != nullptr)
+        m_BufferPool->Return((uint8_t*)ptr->ToPointer());
+}
+
+#pragma endregion
+
+#pragma region Keyframe index
+
+void VideoReaderFFMpeg::StartKeyframeIndexing()
+{
+    // Very short videos and single images don't need it.
+    if (m_bIsVeryShort || m_VideoInfo.DurationTimeStamps <= 1)
+        return;
+
+    m_KeyframeIndexCanceler = gcnew ThreadCanceler();
+    m_KeyframeIndexThread = gcnew Thread(gcnew ParameterizedThreadStart(this, &VideoReaderFFMpeg::KeyframeIndexWorker));
+    m_KeyframeIndexThread->IsBackground = true;
+    m_KeyframeIndexThread->Priority = ThreadPriority::BelowNormal;
+    m_KeyframeIndexThread->Start(m_KeyframeIndexCanceler);
+}
+
+void VideoReaderFFMpeg::StopKeyframeIndexing()
+{
+    if (m_KeyframeIndexThread == nullptr)
+        return;
+
+    m_KeyframeIndexCanceler->Cancel();
+    m_KeyframeIndexThread->Join();
+    m_KeyframeIndexThread = nullptr;
+}
+
+void VideoReaderFFMpeg::KeyframeIndexWorker(Object^ _canceler)
+{
+    //------------------------------------------------------------------------------------
+    // Scan all the packets of the file without decoding them and record the timestamps 
+    // of the frames and of the keyframes.
+    // Uses its own demuxer so the decoding position of the reader is not disturbed.
+    //------------------------------------------------------------------------------------
+    Thread::CurrentThread->Name = "KeyframeIndex";
+    ThreadCanceler^ canceler = (ThreadCanceler^)_canceler;
+    Stopwatch^ stopwatch = Stopwatch::StartNew();
+
+    AVFormatContext* pFormatCtx = nullptr;
+    String^ encFilePath = System::Text::Encoding::Default->GetString(System::Text::Encoding::UTF8->GetBytes(m_VideoInfo.FilePath));
+    char* pszFilePath = static_cast<char*>(Marshal::StringToHGlobalAnsi(encFilePath).ToPointer());
+    int opened = avformat_open_input(&pFormatCtx, pszFilePath, NULL, NULL);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pszFilePath));
+
+    if (opened != 0)
+    {
+        log->Error("Keyframe index: the file could not be openned.");
+        return;
+    }
+
+    // Stream indices of some containers are only known after probing.
+    int videoStream = -1;
+    if (avformat_find_stream_info(pFormatCtx, nullptr) >= 0)
+        videoStream = GetStreamIndex(pFormatCtx, AVMEDIA_TYPE_VIDEO);
+
+    if (videoStream != m_iVideoStream)
+    {
+        log->Error("Keyframe index: video stream not found.");
+        avformat_close_input(&pFormatCtx);
+        return;
+    }
+
+    KeyframeIndex^ index = gcnew KeyframeIndex();
+    AVPacket packet;
+    while (!canceler->CancellationPending && av_read_frame(pFormatCtx, &packet) >= 0)
+    {
+        if (packet.stream_index == videoStream)
+            index->Add(packet.pts, packet.dts, (packet.flags & AV_PKT_FLAG_KEY) != 0);
+
+        av_free_packet(&packet);
+    }
+
+    avformat_close_input(&pFormatCtx);
+
+    if (canceler->CancellationPending)
+        return;
+
+    index->Complete();
+    if (index->KeyframeCount == 0)
+    {
+        log->Error("Keyframe index: no keyframes found.");
+        return;
+    }
+
+    m_KeyframeIndex = index;
+
+    if (m_Verbose)
+        log->DebugFormat("Keyframe index: {0} frames, {1} keyframes, built in {2} ms.", 
+            index->FrameCount, index->KeyframeCount, stopwatch->ElapsedMilliseconds);
+
+    // Persist the index together with the stream info, the next opening of the file will skip both the probing and this scan.
+    ProbeResult^ probe = m_ProbeResult;
+    if (probe != nullptr)
     {
-        // Fixme: why is the delete [] taking more than 1ms ?
-        uint8_t* pBuf = (uint8_t*)ptr->ToPointer();
-        delete[] pBuf;
+        probe->Keyframes = index;
+        ProbeCache::Save(probe);
     }
 }
 
@@ -1653,6 +2120,15 @@ void VideoReaderFFMpeg::StartPreBuffering()
     if (m_Verbose)
         log->Debug("Starting prebuffering thread.");
 
+    // The conversion stage runs on its own thread so the decoder can move on to the next packet
+    // while the previous picture is being converted. It must be up before the decoding thread starts.
+    StopConversion();
+    m_ConversionQueue = gcnew BlockingCollection<PendingFrame>(ConversionQueueCapacity);
+    m_ConversionThread = gcnew Thread(gcnew ParameterizedThreadStart(this, &VideoReaderFFMpeg::ConversionWorker));
+    m_ConversionThread->Start(m_ConversionQueue);
+
+    m_PreBuffer->ResumeBlocking();
+
     ParameterizedThreadStart^ pts = gcnew ParameterizedThreadStart(this, &VideoReaderFFMpeg::PreBufferingWorker);
     m_PreBufferingThreadCanceler->Reset();
     m_PreBufferingThread = gcnew Thread(pts);
@@ -1662,7 +2138,11 @@ void VideoReaderFFMpeg::StartPreBuffering()
 void VideoReaderFFMpeg::StopPreBuffering()
 {
     if (m_PreBufferingThread == nullptr || !m_PreBufferingThread->IsAlive)
+    {
+        // The decoding thread may have exited on its own.
+        StopConversion();
         return;
+    }
 
     if (m_Verbose)
         log->Debug("Stopping prebuffering thread.");
@@ -1672,13 +2152,29 @@ void VideoReaderFFMpeg::StopPreBuffering()
     // The cancellation will only be effective when we next pass in the 
     // decoding loop and check the cancellation flag. This means that if the thread is in waiting state, 
     // (trying to push a frame to an already full buffer), the cancellation will not proceed.
-    // UnblockAndMakeRoom will force a Pulse, dequeing a frame if necessary.
-    // However, if we just make room for one frame and it's the UI thread that is doing the Add,
-    // it will be blocked after the addition since the buffer will again be full. 
-    // We must actually make sure the next Read operation won't block.
+    // UnblockAndMakeRoom will force a Pulse and make the buffer non-blocking, so neither the conversion thread 
+    // nor the UI thread doing the next Read operation can get stuck on a full buffer.
+    // The frames already decoded and waiting for conversion are dropped by the conversion thread,
+    // the next sequential read will seek back to the first of them.
     m_PreBuffer->UnblockAndMakeRoom();
 
     m_PreBufferingThread->Join();
+
+    StopConversion();
+}
+
+void VideoReaderFFMpeg::StopConversion()
+{
+    // Must be called after the decoding thread has exited. 
+    // No more frames will come, let the conversion thread flush the queue and exit.
+    if (m_ConversionQueue == nullptr)
+        return;
+
+    m_ConversionQueue->CompleteAdding();
+    m_ConversionThread->Join();
+    delete m_ConversionQueue;
+    m_ConversionQueue = nullptr;
+    m_ConversionThread = nullptr;
 }
 
 void VideoReaderFFMpeg::PreBufferingWorker(Object^ _canceler)
@@ -1712,7 +2208,11 @@ void VideoReaderFFMpeg::PreBufferingWorker(Object^ _canceler)
         if (m_TimestampInfo.CurrentTimestamp > m_WorkingZone.End)
         {
             if (m_Verbose)
+            {
                 log->DebugFormat("Average prebuffering loop time: {0:0.000}ms. (Budget: {1:0.000}ms).", m_LoopWatcher->Average, m_VideoInfo.FrameIntervalMilliseconds);
+                log->DebugFormat("Frame buffer pool: allocations:{0}, reuses:{1}, resident:{2:0.0} MB.", 
+                    m_BufferPool->Allocations, m_BufferPool->Reuses, (double)m_BufferPool->BytesResident / 1048576);
+            }
             
             m_LoopWatcher->Restart();
             ReadFrame(m_WorkingZone.Start, 1, false);
@@ -1738,6 +2238,44 @@ void VideoReaderFFMpeg::PreBufferingWorker(Object^ _canceler)
     log->DebugFormat("Exiting PreBuffering thread.");
 }
 
+void VideoReaderFFMpeg::ConversionWorker(Object^ _queue)
+{
+    Thread::CurrentThread->Name = "Conversion";
+    BlockingCollection<PendingFrame>^ queue = (BlockingCollection<PendingFrame>^)_queue;
+
+    // Convert the decoded pictures in order and push them to the prebuffer.
+    // Adding to the prebuffer blocks when it is full, which in turn blocks the decoding thread.
+    for each (PendingFrame pending in queue->GetConsumingEnumerable())
+    {
+        AVFrame* pDecodedFrame = (AVFrame*)pending.Frame.ToPointer();
+
+        if (m_PreBufferingThreadCanceler->CancellationPending)
+        {
+            // The prebuffering is being stopped, don't push frames the buffer has no room for.
+            // Remember where the decoder really was so the next sequential read doesn't skip them.
+            if (m_ResyncTimestamp < 0)
+                m_ResyncTimestamp = pending.Timestamp;
+
+            av_frame_free(&pDecodedFrame);
+            continue;
+        }
+        
+        VideoFrame^ vf = nullptr;
+        ReadResult res = ConvertFrame(pDecodedFrame, pending.Timestamp, vf);
+        av_frame_free(&pDecodedFrame);
+
+        if (res != ReadResult::Success)
+        {
+            log->ErrorFormat("Error while converting frame [{0}]: {1}.", pending.Timestamp, res);
+            continue;
+        }
+
+        m_PreBuffer->Add(vf);
+    }
+
+    log->DebugFormat("Exiting Conversion thread.");
+}
+
 #pragma endregion
 
 #pragma region Debug dumps
@@ -1767,10 +2305,13 @@ void VideoReaderFFMpeg::DumpInfo()
     log->Debug("Average Frame Interval (ms): " + m_VideoInfo.FrameIntervalMilliseconds);
     log->Debug("Average Timestamps per frame: " + m_VideoInfo.AverageTimeStampsPerFrame);
     log->DebugFormat("[Codec] - Has B Frames: {0}", m_pCodecCtx->has_b_frames);
+    log->DebugFormat("[Codec] - Threading: {0}, threads: {1}, active type: {2}", 
+        Options->DecoderThreading, m_pCodecCtx->thread_count, 
+        m_pCodecCtx->active_thread_type == FF_THREAD_FRAME ? "frame" : m_pCodecCtx->active_thread_type == FF_THREAD_SLICE ? "slice" : "none");
     log->Debug("[Codec] - Width (pixels): " + m_pCodecCtx->width);
     log->Debug("[Codec] - Height (pixels): " + m_pCodecCtx->height);
     log->Debug("Pixel Aspect Ratio: " + m_VideoInfo.PixelAspectRatio);
-    log->Debug("Image rotation: " + m_VideoInfo.ImageRotation.ToString());
+    log->Debug("Image rotation: " + m_VideoInfo.ImageRotation.ToString() + (ImageRotator::UsesAVX2 ? " (AVX2)" : " (SSE2)"));
     log->Debug("---------------------------------------------------");
 }
 
@@ -68,9 +68,14 @@ extern "C" {
 #include "ReadResult.h"
 #include "TimestampInfo.h"
 #include "SavingContext.h"
+#include "FrameBufferPool.h"
+#include "KeyframeIndex.h"
+#include "ProbeCache.h"
+#include "StreamCopier.h"
 
 using namespace System;
 using namespace System::Collections::Generic;
+using namespace System::Collections::Concurrent;
 using namespace System::ComponentModel;
 using namespace System::Reflection;
 using namespace System::Threading;
@@ -145,6 +150,45 @@ namespace Kinovea { namespace Video { namespace FFMpeg
             }
         }
 
+    // Properties (Instrumentation).
+    public:
+        /// <summary>
+        /// Number of frames converted with an already existing scaling context.
+        /// </summary>
+        property int64_t ScalingContextHits {
+            int64_t get() { return m_ScalingContextHits; }
+        }
+        /// <summary>
+        /// Number of times the scaling context had to be (re)created.
+        /// </summary>
+        property int64_t ScalingContextMisses {
+            int64_t get() { return m_ScalingContextMisses; }
+        }
+        /// <summary>
+        /// Pool of native buffers backing the decoded frames. Exposes allocation statistics.
+        /// </summary>
+        property FrameBufferPool^ BufferPool {
+            FrameBufferPool^ get() { return m_BufferPool; }
+        }
+        /// <summary>
+        /// Index of the keyframes of the video stream. Null until the background scan started after opening the file completes.
+        /// </summary>
+        property KeyframeIndex^ Keyframes {
+            KeyframeIndex^ get() { return m_KeyframeIndex; }
+        }
+        /// <summary>
+        /// Number of seeks performed since the file was opened.
+        /// </summary>
+        property int64_t Seeks {
+            int64_t get() { return m_SeekCount; }
+        }
+        /// <summary>
+        /// Average number of frames decoded to land on the target of a seek.
+        /// </summary>
+        property double FramesDecodedPerSeek {
+            double get() { return m_SeekCount > 0 ? (double)m_SeekFramesDecoded / m_SeekCount : 0; }
+        }
+
     // Construction / Destruction.
     public:
         VideoReaderFFMpeg();
@@ -183,6 +227,37 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         virtual bool ChangeDecodingSize(Size _size) override;
         virtual void DisableCustomDecodingSize() override;
 
+        // Stream copy
+        /// <summary>
+        /// Whether the video stream can be copied to the output format without re-encoding.
+        /// Needs the completed keyframe index. The section to copy is given by GetCopySection.
+        /// </summary>
+        bool CanCopySection(VideoSection _section, String^ _formatString);
+        /// <summary>
+        /// Returns the section that can actually be copied to present the passed section.
+        /// It starts on the keyframe at or before the start. With B-frames it also ends just before the next keyframe after the end,
+        /// since frames presented after the end may be references for frames inside the section.
+        /// Returns an empty section if there is no such keyframe.
+        /// </summary>
+        VideoSection GetCopySection(VideoSection _section);
+        /// <summary>
+        /// Copies the packets of the section to a new file without decoding them.
+        /// Only valid if CanCopySection returned true, and for a section returned by GetCopySection.
+        /// </summary>
+        SaveResult CopySection(SavingSettings^ _settings, String^ _formatString, BackgroundWorker^ _worker);
+
+    // Types
+    private:
+        /// <summary>
+        /// A decoded picture waiting to be converted by the conversion thread.
+        /// Frame is an AVFrame* holding its own reference on the picture.
+        /// </summary>
+        value struct PendingFrame
+        {
+            IntPtr Frame;
+            int64_t Timestamp;
+        };
+
     // Members
     private:
         // General
@@ -191,6 +266,15 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         bool m_bFirstFrameRead;
         VideoInfo m_VideoInfo;
         Dictionary<int64_t, TimedPoint^>^ stabOffsets = gcnew Dictionary<int64_t, TimedPoint^>();
+
+        // Keyframe index & seek metrics.
+        ProbeResult^ m_ProbeResult;
+        KeyframeIndex^ m_KeyframeIndex;
+        Thread^ m_KeyframeIndexThread;
+        ThreadCanceler^ m_KeyframeIndexCanceler;
+        int m_SeekExpectedFrames;
+        int64_t m_SeekCount;
+        int64_t m_SeekFramesDecoded;
         
         // Decoding mode & working zone.
         int64_t m_timestampOffset = 0;
@@ -209,6 +293,7 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         SingleFrame^ m_SingleFrameContainer;
         PreBuffer^ m_PreBuffer;
         Cache^ m_Cache;
+        FrameBufferPool^ m_BufferPool;
         
         // FFMpeg specifics
         int m_iVideoStream;
@@ -219,12 +304,29 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         static const enum AVPixelFormat m_PixelFormatFFmpeg = AV_PIX_FMT_BGRA;
         static const int DecodingQuality = SWS_FAST_BILINEAR;
 
+        // Scaling context. Kept alive across frames and rebuilt when any part of its key changes.
+        SwsContext* m_pScalingContext;
+        int m_ScalingSrcWidth;
+        int m_ScalingSrcHeight;
+        AVPixelFormat m_ScalingSrcFormat;
+        int m_ScalingDstWidth;
+        int m_ScalingDstHeight;
+        AVPixelFormat m_ScalingDstFormat;
+        int m_ScalingFlags;
+        int64_t m_ScalingContextHits;
+        int64_t m_ScalingContextMisses;
+
         // Others
         Object^ m_Locker;
         bool m_WasPrebuffering;
         LoopWatcher^ m_LoopWatcher;
         Thread^ m_PreBufferingThread;
         ThreadCanceler^ m_PreBufferingThreadCanceler;
+        Thread^ m_ConversionThread;
+        BlockingCollection<PendingFrame>^ m_ConversionQueue;
+        Object^ m_ConversionLocker;
+        static const int ConversionQueueCapacity = 3;
+        int64_t m_ResyncTimestamp;
         Stopwatch^ m_Stopwatch = gcnew Stopwatch();
         bool m_Verbose = true;
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
@@ -235,7 +337,15 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         
         // Open/Close.
         OpenVideoResult Load(String^ _filePath, bool _forSummary);
+        bool ReadStreamInfo(AVFormatContext* pFormatCtx, AVCodecContext* pCodecCtx, bool verbose);
+        static bool MatchesProbe(AVFormatContext* _pFormatCtx, ProbeResult^ _probe);
         static int GetStreamIndex(AVFormatContext* _pFormatCtx, int _iCodecType);
+        static void SetupDecoderThreading(AVCodecContext* _pCodecCtx, DecoderThreading _threading);
+
+        // Keyframe index.
+        void StartKeyframeIndexing();
+        void StopKeyframeIndexing();
+        void KeyframeIndexWorker(Object^ _canceler);
         
         // Decoding size.
         void ResetDecodingSize();
@@ -246,8 +356,11 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         bool ReadMany(BackgroundWorker^ _bgWorker, VideoSection _section, bool _prepend);
         ReadResult ReadFrame(int64_t _iTimeStampToSeekTo, int _iFramesToDecode, bool _approximate);
         int SeekTo(int64_t _target);
+        ReadResult ConvertFrame(AVFrame* _pDecodedFrame, int64_t _timestamp, VideoFrame^% _frame);
         bool RescaleAndConvert(AVFrame* _pOutputFrame, AVFrame* _pInputFrame, int _decodingWidth, int _decodingHeight, int _outputFmt, bool _deinterlace);
-        static void DisposeFrame(VideoFrame^ _frame);
+        SwsContext* GetScalingContext(int _srcWidth, int _srcHeight, AVPixelFormat _srcFormat, int _dstWidth, int _dstHeight, AVPixelFormat _dstFormat, int _flags);
+        void InvalidateScalingContext();
+        void DisposeFrame(VideoFrame^ _frame);
         
         // Decoding mode.
         void SwitchDecodingMode(VideoDecodingMode _mode);
@@ -259,6 +372,8 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         void StartPreBuffering();
         void StopPreBuffering();
         void PreBufferingWorker(Object^ _canceler);
+        void StopConversion();
+        void ConversionWorker(Object^ _queue);
 
         // Degug dumps.
         void DumpInfo();
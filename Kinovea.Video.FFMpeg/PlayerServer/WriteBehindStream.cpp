@@ -0,0 +1,312 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "WriteBehindStream.h"
+#include <errno.h>
+#include <msclr\lock.h>
+
+using namespace System::Runtime::InteropServices;
+using namespace Kinovea::Video::FFMpeg;
+using namespace msclr;
+
+// AVIO callbacks. The opaque pointer is a handle on the managed stream.
+static int WriteBehindWritePacket(void* opaque, uint8_t* buf, int buf_size)
+{
+    gcroot<WriteBehindStream^>* handle = (gcroot<WriteBehindStream^>*)opaque;
+    return (*handle)->Write(buf, buf_size);
+}
+
+static int64_t WriteBehindSeek(void* opaque, int64_t offset, int whence)
+{
+    gcroot<WriteBehindStream^>* handle = (gcroot<WriteBehindStream^>*)opaque;
+    return (*handle)->Seek(offset, whence);
+}
+
+WriteBehindStream::WriteBehindStream(int _chunkSize, int _capacity)
+{
+    m_chunkSize = _chunkSize;
+    m_capacity = _capacity;
+    m_drainLocker = gcnew Object();
+    m_stopwatch = Stopwatch::StartNew();
+}
+
+WriteBehindStream::~WriteBehindStream()
+{
+    if (m_queue != nullptr || m_stream != nullptr)
+        Close();
+
+    this->!WriteBehindStream();
+}
+
+WriteBehindStream::!WriteBehindStream()
+{
+    FreeContext();
+}
+
+///<summary>
+/// Create the output file, the AVIO context and start the writing thread.
+///</summary>
+bool WriteBehindStream::Open(String^ _filePath)
+{
+    try
+    {
+        // Writes are always larger than the internal buffer of the FileStream, the chunks are the buffering.
+        m_stream = gcnew FileStream(_filePath, FileMode::Create, FileAccess::Write, FileShare::Read, 4096, FileOptions::SequentialScan);
+    }
+    catch (Exception^ e)
+    {
+        log->Error(String::Format("Could not create the output file {0}.", _filePath), e);
+        return false;
+    }
+
+    unsigned char* pAvioBuffer = (unsigned char*)av_malloc(AvioBufferSize);
+    if (pAvioBuffer == nullptr)
+        return false;
+
+    m_pHandle = new gcroot<WriteBehindStream^>(this);
+    m_pContext = avio_alloc_context(pAvioBuffer, AvioBufferSize, 1, m_pHandle, nullptr, &WriteBehindWritePacket, &WriteBehindSeek);
+    if (m_pContext == nullptr)
+    {
+        av_free(pAvioBuffer);
+        return false;
+    }
+
+    m_queue = gcnew BlockingCollection<Chunk>(m_capacity);
+    m_freeChunks = gcnew ConcurrentQueue<array<Byte>^>();
+    m_current = GetFreeChunk();
+    m_currentLength = 0;
+
+    m_thread = gcnew Thread(gcnew ThreadStart(this, &WriteBehindStream::IOWorker));
+    m_thread->Name = "WriteBehind";
+    m_thread->IsBackground = true;
+    m_thread->Start();
+
+    return true;
+}
+
+///<summary>
+/// Write everything still pending and close the file.
+/// Returns false if any write failed.
+///</summary>
+bool WriteBehindStream::Close()
+{
+    if (m_pContext != nullptr)
+        avio_flush(m_pContext);
+
+    if (m_queue != nullptr)
+    {
+        Enqueue();
+        m_queue->CompleteAdding();
+        m_thread->Join();
+        delete m_queue;
+        m_queue = nullptr;
+        m_thread = nullptr;
+    }
+
+    if (m_stream != nullptr)
+    {
+        try
+        {
+            m_stream->Close();
+        }
+        catch (Exception^ e)
+        {
+            log->Error("Error while closing the output file.", e);
+            m_failed = true;
+        }
+
+        m_stream = nullptr;
+    }
+
+    FreeContext();
+
+    log->DebugFormat("Output file closed. {0:0.0} MB written at {1:0.0} MB/s. Peak queue: {2}/{3} chunks. Muxer blocked for {4} ms.",
+        BytesWritten / (1024.0 * 1024.0), Throughput, m_peakPendingChunks, m_capacity, m_blockedMilliseconds);
+
+    return !m_failed;
+}
+
+double WriteBehindStream::Throughput::get()
+{
+    Int64 ticks = Interlocked::Read(m_writeTicks);
+    if (ticks == 0)
+        return 0;
+
+    double seconds = (double)ticks / Stopwatch::Frequency;
+    return (BytesWritten / (1024.0 * 1024.0)) / seconds;
+}
+
+///<summary>
+/// Called by the muxer through the AVIO context when its buffer is full or flushed.
+///</summary>
+int WriteBehindStream::Write(uint8_t* _buffer, int _size)
+{
+    if (m_failed)
+        return AVERROR(EIO);
+
+    int offset = 0;
+    while (offset < _size)
+    {
+        int count = Math::Min(_size - offset, m_chunkSize - m_currentLength);
+        Marshal::Copy(IntPtr(_buffer + offset), m_current, m_currentLength, count);
+        m_currentLength += count;
+        offset += count;
+
+        if (m_currentLength == m_chunkSize)
+            Enqueue();
+    }
+
+    return _size;
+}
+
+///<summary>
+/// Called by the muxer through the AVIO context to patch headers and indexes.
+/// Everything written so far must be on disk before the file position moves.
+///</summary>
+int64_t WriteBehindStream::Seek(int64_t _offset, int _whence)
+{
+    Drain();
+
+    if (m_failed)
+        return AVERROR(EIO);
+
+    try
+    {
+        switch (_whence & ~AVSEEK_FORCE)
+        {
+        case AVSEEK_SIZE:
+            return m_stream->Length;
+        case SEEK_SET:
+            return m_stream->Seek(_offset, SeekOrigin::Begin);
+        case SEEK_CUR:
+            return m_stream->Seek(_offset, SeekOrigin::Current);
+        case SEEK_END:
+            return m_stream->Seek(_offset, SeekOrigin::End);
+        default:
+            return AVERROR(EINVAL);
+        }
+    }
+    catch (Exception^ e)
+    {
+        log->Error("Error while seeking in the output file.", e);
+        return AVERROR(EIO);
+    }
+}
+
+///<summary>
+/// Push the current chunk to the writing thread and start a new one.
+/// Blocks if the queue is full.
+///</summary>
+void WriteBehindStream::Enqueue()
+{
+    if (m_currentLength == 0)
+        return;
+
+    Chunk chunk;
+    chunk.Data = m_current;
+    chunk.Length = m_currentLength;
+
+    {
+        lock l(m_drainLocker);
+        m_pendingChunks++;
+        m_peakPendingChunks = Math::Max(m_peakPendingChunks, m_pendingChunks);
+    }
+
+    if (!m_queue->TryAdd(chunk))
+    {
+        // The disk doesn't keep up. From here on the stall propagates to the encoder.
+        Int64 then = m_stopwatch->ElapsedMilliseconds;
+        m_queue->Add(chunk);
+        Int64 blocked = m_stopwatch->ElapsedMilliseconds - then;
+        m_blockedMilliseconds += blocked;
+        log->WarnFormat("Output queue full, muxer blocked for {0} ms.", blocked);
+    }
+
+    m_current = GetFreeChunk();
+    m_currentLength = 0;
+}
+
+void WriteBehindStream::Drain()
+{
+    Enqueue();
+
+    lock l(m_drainLocker);
+    while (m_pendingChunks > 0)
+        Monitor::Wait(m_drainLocker);
+}
+
+array<Byte>^ WriteBehindStream::GetFreeChunk()
+{
+    // Chunks are recycled, at most the queue capacity plus the one being written plus the current one are alive.
+    array<Byte>^ chunk;
+    if (m_freeChunks->TryDequeue(chunk))
+        return chunk;
+
+    return gcnew array<Byte>(m_chunkSize);
+}
+
+void WriteBehindStream::IOWorker()
+{
+    for each (Chunk chunk in m_queue->GetConsumingEnumerable())
+    {
+        if (!m_failed)
+        {
+            Int64 then = m_stopwatch->ElapsedTicks;
+            try
+            {
+                m_stream->Write(chunk.Data, 0, chunk.Length);
+                Interlocked::Add(m_bytesWritten, chunk.Length);
+            }
+            catch (Exception^ e)
+            {
+                // Keep consuming so the muxer never blocks on a dead queue, the error is reported on the next write.
+                log->Error("Error while writing to the output file.", e);
+                m_failed = true;
+            }
+
+            Interlocked::Add(m_writeTicks, m_stopwatch->ElapsedTicks - then);
+        }
+
+        m_freeChunks->Enqueue(chunk.Data);
+
+        lock l(m_drainLocker);
+        m_pendingChunks--;
+        Monitor::PulseAll(m_drainLocker);
+    }
+}
+
+void WriteBehindStream::FreeContext()
+{
+    if (m_pContext != nullptr)
+    {
+        // The muxer may have replaced the buffer we gave it.
+        av_free(m_pContext->buffer);
+        av_free(m_pContext);
+        m_pContext = nullptr;
+    }
+
+    if (m_pHandle != nullptr)
+    {
+        delete m_pHandle;
+        m_pHandle = nullptr;
+    }
+}
@@ -0,0 +1,159 @@
+﻿#pragma region License
+/*
+Copyright © Joan Charmant 2024.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C" 
+{
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+#include <avformat.h>
+}
+
+#include <vcclr.h>
+
+using namespace System;
+using namespace System::Collections::Concurrent;
+using namespace System::Diagnostics;
+using namespace System::IO;
+using namespace System::Reflection;
+using namespace System::Threading;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Output file behind a custom AVIOContext, written asynchronously by a dedicated thread.
+    /// The muxer writes into large chunks that are queued and written to disk sequentially,
+    /// so a disk stall only stalls the muxer once the queue is full.
+    /// Seeking (headers, trailers, RIFF boundaries) waits until the queue is drained.
+    /// Internal to this assembly, the native context is not meant to be handed out to other modules.
+    /// </summary>
+    ref class WriteBehindStream
+    {
+    public:
+        /// <summary>
+        /// AVIO context to give to the muxer. Valid between Open and Close.
+        /// </summary>
+        property AVIOContext* Context
+        {
+            AVIOContext* get() { return m_pContext; }
+        }
+
+        /// <summary>
+        /// Number of chunks waiting to be written to disk.
+        /// </summary>
+        property int QueueDepth
+        {
+            int get() { return m_pendingChunks; }
+        }
+
+        /// <summary>
+        /// Highest number of chunks waiting to be written since the stream was opened.
+        /// </summary>
+        property int PeakQueueDepth
+        {
+            int get() { return m_peakPendingChunks; }
+        }
+
+        property int QueueCapacity
+        {
+            int get() { return m_capacity; }
+        }
+
+        property Int64 BytesWritten
+        {
+            Int64 get() { return Interlocked::Read(m_bytesWritten); }
+        }
+
+        /// <summary>
+        /// Disk write throughput in MB/s, measured on the time actually spent writing.
+        /// </summary>
+        property double Throughput
+        {
+            double get();
+        }
+
+        /// <summary>
+        /// Total time the muxer was blocked because the queue was full, in milliseconds.
+        /// </summary>
+        property Int64 BlockedMilliseconds
+        {
+            Int64 get() { return m_blockedMilliseconds; }
+        }
+
+    public:
+        WriteBehindStream(int _chunkSize, int _capacity);
+        ~WriteBehindStream();
+        !WriteBehindStream();
+
+        bool Open(String^ _filePath);
+        bool Close();
+
+    internal:
+        int Write(uint8_t* _buffer, int _size);
+        int64_t Seek(int64_t _offset, int _whence);
+
+    private:
+        value struct Chunk
+        {
+            array<Byte>^ Data;
+            int Length;
+        };
+
+        void Enqueue();
+        void Drain();
+        array<Byte>^ GetFreeChunk();
+        void IOWorker();
+        void FreeContext();
+
+    private:
+        static const int AvioBufferSize = 64 * 1024;
+
+        FileStream^ m_stream;
+        AVIOContext* m_pContext;
+        gcroot<WriteBehindStream^>* m_pHandle;
+        Thread^ m_thread;
+
+        int m_chunkSize;
+        int m_capacity;
+        BlockingCollection<Chunk>^ m_queue;
+        ConcurrentQueue<array<Byte>^>^ m_freeChunks;
+        array<Byte>^ m_current;
+        int m_currentLength;
+
+        Object^ m_drainLocker;
+        int m_pendingChunks;
+        int m_peakPendingChunks;
+        volatile bool m_failed;
+
+        Int64 m_bytesWritten;
+        Int64 m_writeTicks;
+        Int64 m_blockedMilliseconds;
+        Stopwatch^ m_stopwatch;
+
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
@@ -71,6 +71,7 @@ namespace Kinovea.Video
         private VideoSection m_Segment = VideoSection.MakeEmpty();
         private VideoSection m_WorkingZone = VideoSection.MakeEmpty();
         private int m_CurrentIndex = -1;
+        private bool m_Blocking = true;
         private VideoFrame m_Current;
         private readonly object m_Locker = new object();
 
@@ -191,7 +192,7 @@ namespace Kinovea.Video
                 
                 m_Frames.Add(_frame);
                 UpdateSegment();
-                while (m_Frames.Count >= m_TotalCapacity)
+                while (m_Frames.Count >= m_TotalCapacity && m_Blocking)
                 {
                     // Will release its lock and freeze until there is a pulse.
                     // We do this after the actual Add so the decoding thread, when woken up,
@@ -241,14 +242,17 @@ namespace Kinovea.Video
             {
                 // This is used to temporarily deactivate the prebuffering thread without 
                 // completely clearing it. The decoding thread is potentially waiting on a full buffer,
-                // so we must discard at least one frame to make it run again and check for cancellation.
-                // However, the next Add is assumed to run on the UI thread, so it must not block.
-                // So we actually need to have two empty slots: one to push the read,
-                // and one to make that push non-blocking.
+                // so we must wake it up to make it run again and check for cancellation.
+                // The next Add is assumed to run on the UI thread, so it must not block either.
+                // We try to make room by discarding old frames, but the current frame and the ones after it
+                // may be on screen or about to be, so they are never discarded. Instead, additions stop blocking
+                // until the prebuffering is restarted, the buffer may temporarily go over capacity.
                 log.DebugFormat("Unblocking prebuffering thread and making room for a non blocking addition. {0} ({1} frames).",
                     m_Segment, m_Frames.Count);
                 
-                while(m_Frames.Count > m_TotalCapacity - 2)
+                m_Blocking = false;
+
+                while(m_CurrentIndex > 0 && m_Frames.Count > m_TotalCapacity - 2)
                 {
                     //log.DebugFormat("Removing frame with ts: {0}.", m_Frames[0].Timestamp);
                     DisposeFrame(m_Frames[0]);
@@ -260,6 +264,15 @@ namespace Kinovea.Video
                 Monitor.Pulse(m_Locker);
             }
         }
+
+        /// <summary>
+        /// Restore the blocking behavior of Add when the buffer is full, after a call to UnblockAndMakeRoom.
+        /// </summary>
+        public void ResumeBlocking()
+        {
+            lock (m_Locker)
+                m_Blocking = true;
+        }
         
         /// <summary>
         /// The working zone was updated from the outside.
@@ -29,17 +29,19 @@ namespace Kinovea.Video
         public ImageRotation ImageRotation { get; set; }
         public Demosaicing Demosaicing { get; set; }
         public bool Deinterlace { get; set; }
+        public DecoderThreading DecoderThreading { get; set; }
 
-        public VideoOptions(ImageAspectRatio aspect, ImageRotation rotation, Demosaicing demosaicing, bool deinterlace)
+        public VideoOptions(ImageAspectRatio aspect, ImageRotation rotation, Demosaicing demosaicing, bool deinterlace, DecoderThreading decoderThreading = DecoderThreading.Auto)
         {
             ImageAspectRatio = aspect;
             ImageRotation = rotation;
             Demosaicing = demosaicing;
             Deinterlace = deinterlace;
+            DecoderThreading = decoderThreading;
         }
         
         public static VideoOptions Default {
-            get { return new VideoOptions(ImageAspectRatio.Auto, ImageRotation.Rotate0, Demosaicing.None, false);}
+            get { return new VideoOptions(ImageAspectRatio.Auto, ImageRotation.Rotate0, Demosaicing.None, false, DecoderThreading.Auto);}
         }
     }
 }
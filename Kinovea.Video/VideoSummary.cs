@@ -42,6 +42,11 @@ namespace Kinovea.Video
         public long DurationMilliseconds { get; set; }
         public double Framerate { get; set; }
         public List<Bitmap> Thumbs { get; private set; }
+
+        /// <summary>
+        /// True if the extraction stopped before all the thumbnails were read, for example when out of time.
+        /// </summary>
+        public bool Truncated { get; set; }
         #endregion
 
         private static readonly VideoSummary invalid = new VideoSummary("");
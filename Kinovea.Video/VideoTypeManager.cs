@@ -131,6 +131,23 @@ namespace Kinovea.Video
             return reader;
         }
 
+        /// <summary>
+        /// Instanciate a new video reader of the same type as an existing one.
+        /// This is used to open a second reader on the file of a player.
+        /// </summary>
+        public static VideoReader GetVideoReader(VideoReader model)
+        {
+            if (model == null)
+                return null;
+
+            VideoReader reader = null;
+            ConstructorInfo ci = model.GetType().GetConstructor(System.Type.EmptyTypes);
+            if (ci != null)
+                reader = (VideoReader)Activator.CreateInstance(model.GetType(), null);
+
+            return reader;
+        }
+
         public static VideoReader GetImageSequenceReader()
         {
             // Ask specifically for the FFMpeg video reader.
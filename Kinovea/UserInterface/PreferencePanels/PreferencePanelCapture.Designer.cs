@@ -68,6 +68,13 @@ namespace Kinovea.Root
       this.lblMemoryBuffer = new System.Windows.Forms.Label();
       this.trkMemoryBuffer = new System.Windows.Forms.TrackBar();
       this.tabRecording = new System.Windows.Forms.TabPage();
+      this.tabCompression = new System.Windows.Forms.TabPage();
+      this.lblRecordingEncoder = new System.Windows.Forms.Label();
+      this.cmbRecordingEncoder = new System.Windows.Forms.ComboBox();
+      this.lblRecordingCrf = new System.Windows.Forms.Label();
+      this.nudRecordingCrf = new System.Windows.Forms.NumericUpDown();
+      this.lblRecordingPreset = new System.Windows.Forms.Label();
+      this.cmbRecordingPreset = new System.Windows.Forms.ComboBox();
       this.grpAnnotations = new System.Windows.Forms.GroupBox();
       this.chkExportCalibration = new System.Windows.Forms.CheckBox();
       this.chkExportDrawings = new System.Windows.Forms.CheckBox();
@@ -142,6 +149,8 @@ namespace Kinovea.Root
       ((System.ComponentModel.ISupportInitialize)(this.nudReplacementFramerate)).BeginInit();
       ((System.ComponentModel.ISupportInitialize)(this.nudReplacementThreshold)).BeginInit();
       this.grpRecordingMode.SuspendLayout();
+      this.tabCompression.SuspendLayout();
+      ((System.ComponentModel.ISupportInitialize)(this.nudRecordingCrf)).BeginInit();
       this.tabPaths.SuspendLayout();
       this.grpCaptureFolderDetails.SuspendLayout();
       this.grpCaptureFolders.SuspendLayout();
@@ -161,6 +170,7 @@ namespace Kinovea.Root
       this.tabSubPages.Controls.Add(this.tabGeneral);
       this.tabSubPages.Controls.Add(this.tabMemory);
       this.tabSubPages.Controls.Add(this.tabRecording);
+      this.tabSubPages.Controls.Add(this.tabCompression);
       this.tabSubPages.Controls.Add(this.tabPaths);
       this.tabSubPages.Controls.Add(this.tabFiles);
       this.tabSubPages.Controls.Add(this.tabTrigger);
@@ -372,6 +382,87 @@ namespace Kinovea.Root
       this.tabRecording.Text = "Recording";
       this.tabRecording.UseVisualStyleBackColor = true;
       // 
+      // tabCompression
+      // 
+      this.tabCompression.Controls.Add(this.lblRecordingEncoder);
+      this.tabCompression.Controls.Add(this.cmbRecordingEncoder);
+      this.tabCompression.Controls.Add(this.lblRecordingCrf);
+      this.tabCompression.Controls.Add(this.nudRecordingCrf);
+      this.tabCompression.Controls.Add(this.lblRecordingPreset);
+      this.tabCompression.Controls.Add(this.cmbRecordingPreset);
+      this.tabCompression.Location = new System.Drawing.Point(4, 22);
+      this.tabCompression.Name = "tabCompression";
+      this.tabCompression.Padding = new System.Windows.Forms.Padding(3);
+      this.tabCompression.Size = new System.Drawing.Size(482, 296);
+      this.tabCompression.TabIndex = 8;
+      this.tabCompression.Text = "Compression";
+      this.tabCompression.UseVisualStyleBackColor = true;
+      // 
+      // lblRecordingEncoder
+      // 
+      this.lblRecordingEncoder.AutoSize = true;
+      this.lblRecordingEncoder.Location = new System.Drawing.Point(19, 20);
+      this.lblRecordingEncoder.Name = "lblRecordingEncoder";
+      this.lblRecordingEncoder.Size = new System.Drawing.Size(53, 13);
+      this.lblRecordingEncoder.TabIndex = 0;
+      this.lblRecordingEncoder.Text = "Encoder :";
+      // 
+      // cmbRecordingEncoder
+      // 
+      this.cmbRecordingEncoder.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+      this.cmbRecordingEncoder.FormattingEnabled = true;
+      this.cmbRecordingEncoder.Location = new System.Drawing.Point(262, 17);
+      this.cmbRecordingEncoder.Name = "cmbRecordingEncoder";
+      this.cmbRecordingEncoder.Size = new System.Drawing.Size(201, 21);
+      this.cmbRecordingEncoder.TabIndex = 1;
+      this.cmbRecordingEncoder.SelectedIndexChanged += new System.EventHandler(this.cmbRecordingEncoder_SelectedIndexChanged);
+      // 
+      // lblRecordingCrf
+      // 
+      this.lblRecordingCrf.AutoSize = true;
+      this.lblRecordingCrf.Location = new System.Drawing.Point(19, 52);
+      this.lblRecordingCrf.Name = "lblRecordingCrf";
+      this.lblRecordingCrf.Size = new System.Drawing.Size(110, 13);
+      this.lblRecordingCrf.TabIndex = 2;
+      this.lblRecordingCrf.Text = "Constant rate factor :";
+      // 
+      // nudRecordingCrf
+      // 
+      this.nudRecordingCrf.Location = new System.Drawing.Point(262, 50);
+      this.nudRecordingCrf.Maximum = new decimal(new int[] {
+            51,
+            0,
+            0,
+            0});
+      this.nudRecordingCrf.Name = "nudRecordingCrf";
+      this.nudRecordingCrf.Size = new System.Drawing.Size(45, 20);
+      this.nudRecordingCrf.TabIndex = 3;
+      this.nudRecordingCrf.Value = new decimal(new int[] {
+            18,
+            0,
+            0,
+            0});
+      this.nudRecordingCrf.ValueChanged += new System.EventHandler(this.nudRecordingCrf_ValueChanged);
+      // 
+      // lblRecordingPreset
+      // 
+      this.lblRecordingPreset.AutoSize = true;
+      this.lblRecordingPreset.Location = new System.Drawing.Point(19, 84);
+      this.lblRecordingPreset.Name = "lblRecordingPreset";
+      this.lblRecordingPreset.Size = new System.Drawing.Size(43, 13);
+      this.lblRecordingPreset.TabIndex = 4;
+      this.lblRecordingPreset.Text = "Preset :";
+      // 
+      // cmbRecordingPreset
+      // 
+      this.cmbRecordingPreset.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+      this.cmbRecordingPreset.FormattingEnabled = true;
+      this.cmbRecordingPreset.Location = new System.Drawing.Point(262, 81);
+      this.cmbRecordingPreset.Name = "cmbRecordingPreset";
+      this.cmbRecordingPreset.Size = new System.Drawing.Size(201, 21);
+      this.cmbRecordingPreset.TabIndex = 5;
+      this.cmbRecordingPreset.SelectedIndexChanged += new System.EventHandler(this.cmbRecordingPreset_SelectedIndexChanged);
+      // 
       // grpAnnotations
       // 
       this.grpAnnotations.Controls.Add(this.chkExportCalibration);
@@ -1197,6 +1288,9 @@ namespace Kinovea.Root
       ((System.ComponentModel.ISupportInitialize)(this.nudReplacementThreshold)).EndInit();
       this.grpRecordingMode.ResumeLayout(false);
       this.grpRecordingMode.PerformLayout();
+      this.tabCompression.ResumeLayout(false);
+      this.tabCompression.PerformLayout();
+      ((System.ComponentModel.ISupportInitialize)(this.nudRecordingCrf)).EndInit();
       this.tabPaths.ResumeLayout(false);
       this.grpCaptureFolderDetails.ResumeLayout(false);
       this.grpCaptureFolderDetails.PerformLayout();
@@ -1299,5 +1393,12 @@ namespace Kinovea.Root
         private System.Windows.Forms.Label lblDefaultFileName;
         private System.Windows.Forms.TextBox tbDefaultFileName;
         private System.Windows.Forms.RichTextBox rtbAutomation;
+        private System.Windows.Forms.TabPage tabCompression;
+        private System.Windows.Forms.Label lblRecordingEncoder;
+        private System.Windows.Forms.ComboBox cmbRecordingEncoder;
+        private System.Windows.Forms.Label lblRecordingCrf;
+        private System.Windows.Forms.NumericUpDown nudRecordingCrf;
+        private System.Windows.Forms.Label lblRecordingPreset;
+        private System.Windows.Forms.ComboBox cmbRecordingPreset;
     }
 }
@@ -59,6 +59,7 @@ namespace Kinovea.Root
             PreferenceTab.Capture_General, 
             PreferenceTab.Capture_Memory, 
             PreferenceTab.Capture_Recording,
+            PreferenceTab.Capture_Compression,
             PreferenceTab.Capture_Paths,
             PreferenceTab.Capture_Files,
             PreferenceTab.Capture_Trigger,
@@ -79,6 +80,9 @@ namespace Kinovea.Root
         private float replacementFramerate;
         private KVAExportFlags exportFlags = KVAExportFlags.DefaultCaptureRecording;
 
+        // Compression
+        private EncoderSettings recordingEncoderSettings = new EncoderSettings();
+
         // Folders
         private CapturePathConfiguration capturePathConfiguration = new CapturePathConfiguration();
         private CaptureFolder selectedCaptureFolder;
@@ -164,6 +168,9 @@ namespace Kinovea.Root
             replacementFramerate = PreferencesManager.CapturePreferences.HighspeedRecordingFramerateOutput;
             exportFlags = PreferencesManager.CapturePreferences.ExportFlags;
 
+            // Compression
+            recordingEncoderSettings = PreferencesManager.CapturePreferences.RecordingEncoderSettings;
+
             // Folders
             capturePathConfiguration = PreferencesManager.CapturePreferences.CapturePathConfiguration.Clone();
 
@@ -198,6 +205,7 @@ namespace Kinovea.Root
             InitTabGeneral();
             InitTabMemory();
             InitTabRecording();
+            InitTabCompression();
             InitTabFolders();
             InitTabFiles();
             InitTabTrigger();
@@ -278,6 +286,20 @@ namespace Kinovea.Root
             chkExportDrawings.Checked = (exportFlags & KVAExportFlags.Drawings) != 0;
         }
 
+        private void InitTabCompression()
+        {
+            tabCompression.Text = "Compression";
+            lblRecordingEncoder.Text = "Encoder :";
+            lblRecordingCrf.Text = "Constant rate factor :";
+            lblRecordingPreset.Text = "Preset :";
+
+            EncoderSettingsHelper.FillProfiles(cmbRecordingEncoder, recordingEncoderSettings.Profile);
+            EncoderSettingsHelper.FillPresets(cmbRecordingPreset, recordingEncoderSettings.Preset);
+            nudRecordingCrf.Value = Math.Max(nudRecordingCrf.Minimum, Math.Min(nudRecordingCrf.Maximum, recordingEncoderSettings.Crf));
+            NudHelper.FixNudScroll(nudRecordingCrf);
+            UpdateRecordingRateFactorControls();
+        }
+
         private void InitTabFolders()
         {
             tabPaths.Text = Kinovea.Root.Languages.RootLang.prefPanelCapture_Folders;
@@ -694,6 +716,31 @@ namespace Kinovea.Root
         }
         #endregion
 
+        #region Tab Compression
+        private void cmbRecordingEncoder_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            recordingEncoderSettings.Profile = (EncoderProfile)cmbRecordingEncoder.SelectedIndex;
+            UpdateRecordingRateFactorControls();
+        }
+        private void nudRecordingCrf_ValueChanged(object sender, EventArgs e)
+        {
+            recordingEncoderSettings.Crf = (int)nudRecordingCrf.Value;
+        }
+        private void cmbRecordingPreset_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            recordingEncoderSettings.Preset = (string)cmbRecordingPreset.SelectedItem;
+        }
+        private void UpdateRecordingRateFactorControls()
+        {
+            // The rate factor and the preset only apply to the x264 and x265 based profiles.
+            bool enabled = recordingEncoderSettings.HasRateFactor;
+            lblRecordingCrf.Enabled = enabled;
+            nudRecordingCrf.Enabled = enabled;
+            lblRecordingPreset.Enabled = enabled;
+            cmbRecordingPreset.Enabled = enabled;
+        }
+        #endregion
+
         #region Tab Files
         private void tbDefaultFileName_TextChanged(object sender, EventArgs e)
         {
@@ -981,6 +1028,9 @@ namespace Kinovea.Root
             PreferencesManager.CapturePreferences.HighspeedRecordingFramerateOutput = replacementFramerate;
             PreferencesManager.CapturePreferences.ExportFlags = exportFlags;
 
+            // Compression
+            PreferencesManager.CapturePreferences.RecordingEncoderSettings = recordingEncoderSettings;
+
             // Folders
             PreferencesManager.CapturePreferences.CapturePathConfiguration = capturePathConfiguration;
 
@@ -66,11 +66,20 @@ namespace Kinovea.Root
       this.lblAspectRatio = new System.Windows.Forms.Label();
       this.chkDeinterlace = new System.Windows.Forms.CheckBox();
       this.chkInteractiveTracker = new System.Windows.Forms.CheckBox();
+      this.tabExport = new System.Windows.Forms.TabPage();
+      this.lblExportEncoder = new System.Windows.Forms.Label();
+      this.cmbExportEncoder = new System.Windows.Forms.ComboBox();
+      this.lblExportCrf = new System.Windows.Forms.Label();
+      this.nudExportCrf = new System.Windows.Forms.NumericUpDown();
+      this.lblExportPreset = new System.Windows.Forms.Label();
+      this.cmbExportPreset = new System.Windows.Forms.ComboBox();
       ((System.ComponentModel.ISupportInitialize)(this.trkMemoryBuffer)).BeginInit();
+      ((System.ComponentModel.ISupportInitialize)(this.nudExportCrf)).BeginInit();
       this.tabSubPages.SuspendLayout();
       this.tabGeneral.SuspendLayout();
       this.tabMemory.SuspendLayout();
       this.tabImage.SuspendLayout();
+      this.tabExport.SuspendLayout();
       this.SuspendLayout();
       // 
       // trkMemoryBuffer
@@ -102,6 +111,7 @@ namespace Kinovea.Root
       this.tabSubPages.Controls.Add(this.tabGeneral);
       this.tabSubPages.Controls.Add(this.tabMemory);
       this.tabSubPages.Controls.Add(this.tabImage);
+      this.tabSubPages.Controls.Add(this.tabExport);
       this.tabSubPages.Dock = System.Windows.Forms.DockStyle.Fill;
       this.tabSubPages.Location = new System.Drawing.Point(0, 0);
       this.tabSubPages.Name = "tabSubPages";
@@ -277,6 +287,84 @@ namespace Kinovea.Root
       this.chkInteractiveTracker.UseVisualStyleBackColor = true;
       this.chkInteractiveTracker.CheckedChanged += new System.EventHandler(this.chkInteractiveTracker_CheckedChanged);
       // 
+      // tabExport
+      // 
+      this.tabExport.Controls.Add(this.lblExportEncoder);
+      this.tabExport.Controls.Add(this.cmbExportEncoder);
+      this.tabExport.Controls.Add(this.lblExportCrf);
+      this.tabExport.Controls.Add(this.nudExportCrf);
+      this.tabExport.Controls.Add(this.lblExportPreset);
+      this.tabExport.Controls.Add(this.cmbExportPreset);
+      this.tabExport.Location = new System.Drawing.Point(4, 22);
+      this.tabExport.Name = "tabExport";
+      this.tabExport.Size = new System.Drawing.Size(482, 296);
+      this.tabExport.TabIndex = 3;
+      this.tabExport.Text = "Export";
+      this.tabExport.UseVisualStyleBackColor = true;
+      // 
+      // lblExportEncoder
+      // 
+      this.lblExportEncoder.AutoSize = true;
+      this.lblExportEncoder.Location = new System.Drawing.Point(21, 35);
+      this.lblExportEncoder.Name = "lblExportEncoder";
+      this.lblExportEncoder.Size = new System.Drawing.Size(53, 13);
+      this.lblExportEncoder.TabIndex = 31;
+      this.lblExportEncoder.Text = "Encoder :";
+      // 
+      // cmbExportEncoder
+      // 
+      this.cmbExportEncoder.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+      this.cmbExportEncoder.Location = new System.Drawing.Point(264, 32);
+      this.cmbExportEncoder.Name = "cmbExportEncoder";
+      this.cmbExportEncoder.Size = new System.Drawing.Size(201, 21);
+      this.cmbExportEncoder.TabIndex = 32;
+      this.cmbExportEncoder.SelectedIndexChanged += new System.EventHandler(this.cmbExportEncoder_SelectedIndexChanged);
+      // 
+      // lblExportCrf
+      // 
+      this.lblExportCrf.AutoSize = true;
+      this.lblExportCrf.Location = new System.Drawing.Point(21, 67);
+      this.lblExportCrf.Name = "lblExportCrf";
+      this.lblExportCrf.Size = new System.Drawing.Size(110, 13);
+      this.lblExportCrf.TabIndex = 33;
+      this.lblExportCrf.Text = "Constant rate factor :";
+      // 
+      // nudExportCrf
+      // 
+      this.nudExportCrf.Location = new System.Drawing.Point(264, 65);
+      this.nudExportCrf.Maximum = new decimal(new int[] {
+            51,
+            0,
+            0,
+            0});
+      this.nudExportCrf.Name = "nudExportCrf";
+      this.nudExportCrf.Size = new System.Drawing.Size(45, 20);
+      this.nudExportCrf.TabIndex = 34;
+      this.nudExportCrf.Value = new decimal(new int[] {
+            18,
+            0,
+            0,
+            0});
+      this.nudExportCrf.ValueChanged += new System.EventHandler(this.nudExportCrf_ValueChanged);
+      // 
+      // lblExportPreset
+      // 
+      this.lblExportPreset.AutoSize = true;
+      this.lblExportPreset.Location = new System.Drawing.Point(21, 99);
+      this.lblExportPreset.Name = "lblExportPreset";
+      this.lblExportPreset.Size = new System.Drawing.Size(43, 13);
+      this.lblExportPreset.TabIndex = 35;
+      this.lblExportPreset.Text = "Preset :";
+      // 
+      // cmbExportPreset
+      // 
+      this.cmbExportPreset.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+      this.cmbExportPreset.Location = new System.Drawing.Point(264, 96);
+      this.cmbExportPreset.Name = "cmbExportPreset";
+      this.cmbExportPreset.Size = new System.Drawing.Size(201, 21);
+      this.cmbExportPreset.TabIndex = 36;
+      this.cmbExportPreset.SelectedIndexChanged += new System.EventHandler(this.cmbExportPreset_SelectedIndexChanged);
+      // 
       // PreferencePanelPlayer
       // 
       this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
@@ -286,6 +374,7 @@ namespace Kinovea.Root
       this.Name = "PreferencePanelPlayer";
       this.Size = new System.Drawing.Size(490, 322);
       ((System.ComponentModel.ISupportInitialize)(this.trkMemoryBuffer)).EndInit();
+      ((System.ComponentModel.ISupportInitialize)(this.nudExportCrf)).EndInit();
       this.tabSubPages.ResumeLayout(false);
       this.tabGeneral.ResumeLayout(false);
       this.tabGeneral.PerformLayout();
@@ -293,6 +382,8 @@ namespace Kinovea.Root
       this.tabMemory.PerformLayout();
       this.tabImage.ResumeLayout(false);
       this.tabImage.PerformLayout();
+      this.tabExport.ResumeLayout(false);
+      this.tabExport.PerformLayout();
       this.ResumeLayout(false);
 
         }
@@ -314,5 +405,12 @@ namespace Kinovea.Root
         private System.Windows.Forms.ComboBox cmbImageFormats;
         private System.Windows.Forms.Label lblAspectRatio;
         private System.Windows.Forms.CheckBox chkDeinterlace;
+        private System.Windows.Forms.TabPage tabExport;
+        private System.Windows.Forms.Label lblExportEncoder;
+        private System.Windows.Forms.ComboBox cmbExportEncoder;
+        private System.Windows.Forms.Label lblExportCrf;
+        private System.Windows.Forms.NumericUpDown nudExportCrf;
+        private System.Windows.Forms.Label lblExportPreset;
+        private System.Windows.Forms.ComboBox cmbExportPreset;
     }
 }
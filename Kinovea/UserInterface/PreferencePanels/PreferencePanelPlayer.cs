@@ -61,7 +61,8 @@ namespace Kinovea.Root
         private List<PreferenceTab> tabs = new List<PreferenceTab> { 
             PreferenceTab.Player_General, 
             PreferenceTab.Player_Memory,
-            PreferenceTab.Player_Image
+            PreferenceTab.Player_Image,
+            PreferenceTab.Player_Export
         };
 
         private bool detectImageSequences;
@@ -74,6 +75,7 @@ namespace Kinovea.Root
         private bool enablePixelFiltering;
         private ImageAspectRatio imageAspectRatio;
         private bool deinterlaceByDefault;
+        private EncoderSettings exportEncoderSettings = new EncoderSettings();
         #endregion
         
         #region Construction & Initialization
@@ -114,12 +116,14 @@ namespace Kinovea.Root
             imageAspectRatio = PreferencesManager.PlayerPreferences.AspectRatio;
             deinterlaceByDefault = PreferencesManager.PlayerPreferences.DeinterlaceByDefault;
             memoryBuffer = PreferencesManager.PlayerPreferences.WorkingZoneMemory;
+            exportEncoderSettings = PreferencesManager.PlayerPreferences.ExportEncoderSettings;
         }
         private void InitPage()
         {
             InitPageGeneral();
             InitPageMemory();
             InitPageImage();
+            InitPageExport();
         }
 
         private void InitPageGeneral()
@@ -177,6 +181,20 @@ namespace Kinovea.Root
             chkDeinterlace.Text = RootLang.dlgPreferences_Player_DeinterlaceByDefault;
             chkDeinterlace.Checked = deinterlaceByDefault;
         }
+
+        private void InitPageExport()
+        {
+            tabExport.Text = "Export";
+            lblExportEncoder.Text = "Encoder :";
+            lblExportCrf.Text = "Constant rate factor :";
+            lblExportPreset.Text = "Preset :";
+
+            EncoderSettingsHelper.FillProfiles(cmbExportEncoder, exportEncoderSettings.Profile);
+            EncoderSettingsHelper.FillPresets(cmbExportPreset, exportEncoderSettings.Preset);
+            nudExportCrf.Value = Math.Max(nudExportCrf.Minimum, Math.Min(nudExportCrf.Maximum, exportEncoderSettings.Crf));
+            NudHelper.FixNudScroll(nudExportCrf);
+            UpdateExportRateFactorControls();
+        }
         #endregion
 
         #region Handlers
@@ -258,6 +276,31 @@ namespace Kinovea.Root
         }
         #endregion
 
+        #region Export
+        private void cmbExportEncoder_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            exportEncoderSettings.Profile = (EncoderProfile)cmbExportEncoder.SelectedIndex;
+            UpdateExportRateFactorControls();
+        }
+        private void nudExportCrf_ValueChanged(object sender, EventArgs e)
+        {
+            exportEncoderSettings.Crf = (int)nudExportCrf.Value;
+        }
+        private void cmbExportPreset_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            exportEncoderSettings.Preset = (string)cmbExportPreset.SelectedItem;
+        }
+        private void UpdateExportRateFactorControls()
+        {
+            // The rate factor and the preset only apply to the x264 and x265 based profiles.
+            bool enabled = exportEncoderSettings.HasRateFactor;
+            lblExportCrf.Enabled = enabled;
+            nudExportCrf.Enabled = enabled;
+            lblExportPreset.Enabled = enabled;
+            cmbExportPreset.Enabled = enabled;
+        }
+        #endregion
+
         #endregion
 
         public void CommitChanges()
@@ -274,6 +317,7 @@ namespace Kinovea.Root
             PreferencesManager.PlayerPreferences.EnablePixelFiltering = enablePixelFiltering;
             PreferencesManager.PlayerPreferences.DeinterlaceByDefault = deinterlaceByDefault;
             PreferencesManager.PlayerPreferences.AspectRatio = imageAspectRatio;
+            PreferencesManager.PlayerPreferences.ExportEncoderSettings = exportEncoderSettings;
         }
     }
 }